@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+// Replaces the global operator new to count heap allocations per thread, in
+// every build: the count is one thread-local increment on top of malloc, and
+// release builds are the ones whose allocation figures matter to the
+// benchmarks. Debug builds additionally assert that hot paths allocate nothing.
+uint64_t threadAllocationCount();
@@ -0,0 +1,91 @@
+#include "Analysis.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+Analysis::Analysis() {
+    search.setHashSize(64);
+    // Leave a core for the GUI thread
+    search.setThreads(std::max(1, int(std::thread::hardware_concurrency()) / 2));
+    search.onInfo = [this](const SearchInfo& info) { onInfo(info); };
+}
+
+Analysis::~Analysis() {
+    stop();
+}
+
+// Search thread: copy the line into plain data and hand it over without waiting
+void Analysis::onInfo(const SearchInfo& info) {
+    AnalysisLine line;
+    line.generation = generation;
+    line.multiPv = info.multiPv;
+    line.depth = info.depth;
+    line.score = root.sideToMove() == Color::White ? info.score : -info.score;
+    line.nodes = info.nodes;
+    line.pvLength = std::min((int)info.pv.size(), MaxAnalysisPv);
+    std::copy(info.pv.begin(), info.pv.begin() + line.pvLength, line.pv);
+    if (!channel.push(line)) dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Analysis::start(const Position& pos) {
+    // The old search must be gone before the generation changes, so none of
+    // its lines can be mistaken for lines of the new position
+    stop();
+    root = pos;
+    generation++;
+    shown = 0;
+    search.setMultiPv(lines);
+    SearchLimits limits;
+    limits.infinite = true;
+    search.start(root, limits);
+    running = true;
+}
+
+void Analysis::stop() {
+    search.stop();
+    search.wait();
+    running = false;
+}
+
+void Analysis::setLineCount(int count) {
+    lines = std::max(1, std::min(count, MaxMultiPv));
+}
+
+static std::string formatEval(int score) {
+    if (std::abs(score) >= MateInMaxPly) {
+        int moves = (MateScore - std::abs(score) + 1) / 2;
+        return (score > 0 ? "#" : "-#") + std::to_string(moves);
+    }
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%+.2f", score / 100.0);
+    return buffer;
+}
+
+bool Analysis::poll() {
+    // Coalesce: only the newest version of each line survives to the redraw
+    bool changed[MaxMultiPv] = {};
+    bool any = false;
+    AnalysisLine line;
+    while (channel.pop(line)) {
+        if (line.generation != generation || line.multiPv < 1 || line.multiPv > MaxMultiPv) continue;
+        current[line.multiPv - 1] = line;
+        changed[line.multiPv - 1] = true;
+        shown = std::max(shown, line.multiPv);
+        any = true;
+    }
+
+    // SAN needs the position, so the text is built here once per changed line
+    for (int i = 0; i < shown; i++) {
+        if (!changed[i]) continue;
+        const AnalysisLine& l = current[i];
+        Position pos = root;
+        std::string san;
+        for (int ply = 0; ply < l.pvLength; ply++) {
+            san += (ply ? " " : "") + pos.moveToSan(l.pv[ply]);
+            pos.makeMove(l.pv[ply]);
+        }
+        text[i] = formatEval(l.score) + "  d" + std::to_string(l.depth) + "  " + san;
+    }
+    return any;
+}
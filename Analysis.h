@@ -0,0 +1,63 @@
+#pragma once
+#include "Position.h"
+#include "Search.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+const int MaxAnalysisPv = 12;
+
+// One line of the background search, plain data so it goes through the
+// channel without allocating
+struct AnalysisLine {
+    uint32_t generation = 0;            // which start() the line belongs to
+    int multiPv = 1;
+    int depth = 0;
+    int score = 0;                      // from White's point of view
+    uint64_t nodes = 0;
+    int pvLength = 0;
+    PackedMove pv[MaxAnalysisPv];
+};
+
+// Infinite multi-PV search of the game position on a background thread. The
+// search thread only pushes lines into a lock-free channel; the GUI drains it
+// once per frame, so any number of updates between frames costs one redraw.
+class Analysis {
+public:
+    Analysis();
+    ~Analysis();
+
+    // Restarts on a new position; the transposition table is kept, so the
+    // search picks up whatever it already knows about the new position
+    void start(const Position& pos);
+    void stop();
+    bool isRunning() const { return running; }
+
+    void setLineCount(int count);
+    void setTablebases(const Tablebases* tables) { search.setTablebases(tables); }   // while stopped
+    int lineCount() const { return lines; }
+
+    // GUI thread: applies everything received since the last call, true if anything changed
+    bool poll();
+
+    int shownLines() const { return shown; }
+    const AnalysisLine& line(int i) const { return current[i]; }
+    const std::string& lineText(int i) const { return text[i]; }
+    uint64_t droppedUpdates() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void onInfo(const SearchInfo& info);
+
+    Search search;
+    SpscQueue<AnalysisLine, 256> channel;
+    uint32_t generation = 0;            // written only while the search is stopped
+    Position root;
+    bool running = false;
+    int lines = 3;
+
+    AnalysisLine current[MaxMultiPv];
+    std::string text[MaxMultiPv];
+    int shown = 0;
+    std::atomic<uint64_t> dropped{ 0 };  // updates lost to a full channel
+};
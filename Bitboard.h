@@ -0,0 +1,177 @@
+#pragma once
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef uint64_t Bitboard;
+
+// Square index = row * 8 + col, row 0 is White's back rank (same layout as ChessGame::board)
+constexpr int makeSquare(int col, int row) { return row * 8 + col; }
+constexpr int squareCol(int sq) { return sq & 7; }
+constexpr int squareRow(int sq) { return sq >> 3; }
+constexpr Bitboard squareBB(int sq) { return Bitboard(1) << sq; }
+
+constexpr Bitboard FileABB = 0x0101010101010101ULL;
+constexpr Bitboard FileHBB = FileABB << 7;
+constexpr Bitboard Rank1BB = 0xFFULL;
+constexpr Bitboard Rank8BB = Rank1BB << 56;
+constexpr Bitboard LightSquaresBB = 0x55AA55AA55AA55AAULL;
+constexpr Bitboard DarkSquaresBB = ~LightSquaresBB;
+
+enum Direction {
+    North, East, NorthEast, NorthWest,  // increasing square index
+    South, West, SouthEast, SouthWest   // decreasing square index
+};
+
+// Attack tables are generated by the compiler: nothing is built at startup
+
+constexpr Bitboard offsetBB(int col, int row) {
+    return (col < 0 || col > 7 || row < 0 || row > 7) ? 0 : squareBB(makeSquare(col, row));
+}
+
+struct LeaperTables {
+    Bitboard knight[64] = {};
+    Bitboard king[64] = {};
+    Bitboard pawn[2][64] = {};
+};
+
+constexpr LeaperTables buildLeaperTables() {
+    LeaperTables t;
+    const int knightSteps[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+    for (int sq = 0; sq < 64; sq++) {
+        int col = squareCol(sq);
+        int row = squareRow(sq);
+        for (int i = 0; i < 8; i++) {
+            t.knight[sq] |= offsetBB(col + knightSteps[i][0], row + knightSteps[i][1]);
+        }
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if (dx != 0 || dy != 0) t.king[sq] |= offsetBB(col + dx, row + dy);
+            }
+        }
+        t.pawn[0][sq] = offsetBB(col - 1, row + 1) | offsetBB(col + 1, row + 1);
+        t.pawn[1][sq] = offsetBB(col - 1, row - 1) | offsetBB(col + 1, row - 1);
+    }
+    return t;
+}
+
+// Column / row step of each Direction
+constexpr int RaySteps[8][2] = { {0, 1}, {1, 0}, {1, 1}, {-1, 1}, {0, -1}, {-1, 0}, {1, -1}, {-1, -1} };
+constexpr int OppositeDirection[8] = { South, West, SouthWest, SouthEast, North, East, NorthWest, NorthEast };
+
+struct RayTables {
+    Bitboard ray[8][64] = {};
+};
+
+constexpr RayTables buildRayTables() {
+    RayTables t;
+    for (int sq = 0; sq < 64; sq++) {
+        for (int dir = 0; dir < 8; dir++) {
+            int c = squareCol(sq) + RaySteps[dir][0];
+            int r = squareRow(sq) + RaySteps[dir][1];
+            while (c >= 0 && c < 8 && r >= 0 && r < 8) {
+                t.ray[dir][sq] |= squareBB(makeSquare(c, r));
+                c += RaySteps[dir][0];
+                r += RaySteps[dir][1];
+            }
+        }
+    }
+    return t;
+}
+
+struct LineTables {
+    Bitboard between[64][64] = {};
+    Bitboard line[64][64] = {};
+};
+
+// Walks each ray once instead of testing all 4096 square pairs
+constexpr LineTables buildLineTables(const RayTables& rays) {
+    LineTables t;
+    for (int from = 0; from < 64; from++) {
+        for (int dir = 0; dir < 8; dir++) {
+            Bitboard line = rays.ray[dir][from] | rays.ray[OppositeDirection[dir]][from] | squareBB(from);
+            int c = squareCol(from) + RaySteps[dir][0];
+            int r = squareRow(from) + RaySteps[dir][1];
+            while (c >= 0 && c < 8 && r >= 0 && r < 8) {
+                int to = makeSquare(c, r);
+                t.between[from][to] = rays.ray[dir][from] ^ rays.ray[dir][to] ^ squareBB(to);
+                t.line[from][to] = line;
+                c += RaySteps[dir][0];
+                r += RaySteps[dir][1];
+            }
+        }
+    }
+    return t;
+}
+
+inline constexpr LeaperTables Leapers = buildLeaperTables();
+inline constexpr RayTables Rays = buildRayTables();
+inline constexpr LineTables Lines = buildLineTables(Rays);
+
+inline constexpr const Bitboard (&knightAttacks)[64] = Leapers.knight;
+inline constexpr const Bitboard (&kingAttacks)[64] = Leapers.king;
+inline constexpr const Bitboard (&pawnAttacks)[2][64] = Leapers.pawn;
+inline constexpr const Bitboard (&rayAttacks)[8][64] = Rays.ray;
+inline constexpr const Bitboard (&betweenBB)[64][64] = Lines.between;  // squares strictly between two aligned squares
+inline constexpr const Bitboard (&lineBB)[64][64] = Lines.line;        // full line through two aligned squares, 0 if not aligned
+
+inline int popCount(Bitboard b) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(b);
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+inline int lsb(Bitboard b) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, b);
+    return (int)idx;
+#else
+    return __builtin_ctzll(b);
+#endif
+}
+
+inline int msb(Bitboard b) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, b);
+    return (int)idx;
+#else
+    return 63 - __builtin_clzll(b);
+#endif
+}
+
+inline int popLsb(Bitboard& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+// Slider attacks from classical rays: stop at the first blocker in each direction
+inline Bitboard slidingRay(int dir, int sq, Bitboard occ) {
+    Bitboard attacks = rayAttacks[dir][sq];
+    Bitboard blockers = attacks & occ;
+    if (blockers) {
+        int blocker = dir < South ? lsb(blockers) : msb(blockers);
+        attacks ^= rayAttacks[dir][blocker];
+    }
+    return attacks;
+}
+
+inline Bitboard rookAttacks(int sq, Bitboard occ) {
+    return slidingRay(North, sq, occ) | slidingRay(South, sq, occ)
+         | slidingRay(East, sq, occ) | slidingRay(West, sq, occ);
+}
+
+inline Bitboard bishopAttacks(int sq, Bitboard occ) {
+    return slidingRay(NorthEast, sq, occ) | slidingRay(NorthWest, sq, occ)
+         | slidingRay(SouthEast, sq, occ) | slidingRay(SouthWest, sq, occ);
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occ) {
+    return rookAttacks(sq, occ) | bishopAttacks(sq, occ);
+}
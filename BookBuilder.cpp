@@ -0,0 +1,372 @@
+#include "BookBuilder.h"
+#include "Pgn.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <streambuf>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(BookStatsRecord) == 24, "statistics records are written as is");
+
+static const char StatsMagic[8] = { 'B', 'O', 'O', 'K', 'S', 'T', 'A', 'T' };
+static const size_t StatsHeaderSize = 16;
+static const size_t SliceBytes = 4 << 20;
+
+struct SampleKey {
+    uint64_t key;
+    uint16_t move;
+
+    bool operator==(const SampleKey& other) const { return key == other.key && move == other.move; }
+};
+
+struct SampleKeyHash {
+    size_t operator()(const SampleKey& sample) const {
+        return size_t(sample.key ^ (uint64_t(sample.move) * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+struct SampleCounts {
+    uint32_t wins = 0;
+    uint32_t draws = 0;
+    uint32_t losses = 0;
+};
+
+typedef std::unordered_map<SampleKey, SampleCounts, SampleKeyHash> SampleMap;
+
+// Node, bucket and allocator overhead of one map entry, roughly
+static const size_t BytesPerSample = sizeof(SampleMap::value_type) + 40;
+
+static bool recordLess(const BookStatsRecord& a, const BookStatsRecord& b) {
+    return a.key != b.key ? a.key < b.key : a.move < b.move;
+}
+
+// Lets readPgnGame parse a slice of a mapped file without copying it
+struct MemoryBuffer : std::streambuf {
+    MemoryBuffer(const char* begin, const char* end) {
+        setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+    }
+};
+
+struct BookBuilder::ThreadResult {
+    int id = 0;
+    SampleMap samples;
+    size_t maxSamples = 0;
+    std::vector<std::string> runPaths;
+    std::vector<BookStatsRecord> rest;     // the map's contents at the end, sorted
+    uint64_t games = 0;
+    uint64_t skippedGames = 0;
+    uint64_t positions = 0;
+    bool failed = false;
+};
+
+static std::vector<BookStatsRecord> sortedRecords(const SampleMap& samples) {
+    std::vector<BookStatsRecord> records;
+    records.reserve(samples.size());
+    for (const auto& sample : samples) {
+        records.push_back({ sample.first.key, sample.first.move, 0,
+                            sample.second.wins, sample.second.draws, sample.second.losses });
+    }
+    std::sort(records.begin(), records.end(), recordLess);
+    return records;
+}
+
+BookBuilder::BookBuilder(const BookBuildConfig& config) : config(config) {
+    if (this->config.statsPath.empty()) this->config.statsPath = config.bookPath + ".stats";
+}
+
+BookBuilder::~BookBuilder() {
+    for (auto& mapping : mappings) munmap(mapping.first, mapping.second);
+}
+
+// Each file is cut into slices of about SliceBytes, always in front of an
+// [Event tag, so that every game lies in exactly one slice
+bool BookBuilder::mapInputs() {
+    static const char marker[] = "\n[Event ";
+    for (const std::string& path : config.pgnPaths) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd == -1 || fstat(fd, &info) == -1) {
+            std::cerr << "Cannot open " << path << std::endl;
+            if (fd != -1) close(fd);
+            return false;
+        }
+        size_t size = size_t(info.st_size);
+        if (size == 0) {
+            close(fd);
+            continue;
+        }
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            std::cerr << "Cannot map " << path << std::endl;
+            return false;
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+        mappings.emplace_back(data, size);
+
+        const char* begin = (const char*)data;
+        const char* end = begin + size;
+        while (begin < end) {
+            const char* cut = end;
+            if (size_t(end - begin) > SliceBytes) {
+                cut = std::search(begin + SliceBytes, end, marker, marker + sizeof(marker) - 1);
+                if (cut != end) cut++;
+            }
+            slices.push_back({ begin, cut });
+            begin = cut;
+        }
+    }
+    return true;
+}
+
+void BookBuilder::replaySlices(ThreadResult& result) {
+    Position pos;
+    PgnGame game;
+    size_t index;
+    while ((index = nextSlice++) < slices.size()) {
+        MemoryBuffer buffer(slices[index].begin, slices[index].end);
+        std::istream in(&buffer);
+        while (readPgnGame(in, game, config.maxPly)) {
+            std::string outcome = game.tag("Result");
+            int whitePoints = outcome == "1-0" ? 2 : outcome == "1/2-1/2" ? 1 : outcome == "0-1" ? 0 : -1;
+            if (whitePoints < 0 || game.moves.empty() || !pos.setFromFen(game.fen)) {
+                result.skippedGames++;
+                continue;
+            }
+            for (PackedMove move : game.moves) {
+                int points = pos.sideToMove() == Color::White ? whitePoints : 2 - whitePoints;
+                SampleCounts& counts = result.samples[{ hasher.key(pos), toPolyglotMove(move) }];
+                if (points == 2) counts.wins++;
+                else if (points == 1) counts.draws++;
+                else counts.losses++;
+                pos.makeMove(move);
+            }
+            result.positions += game.moves.size();
+            result.games++;
+            if (result.samples.size() >= result.maxSamples && !spill(result)) {
+                result.failed = true;
+                return;
+            }
+        }
+    }
+}
+
+// Writes the thread's map as a sorted run and starts it over
+bool BookBuilder::spill(ThreadResult& result) {
+    std::vector<BookStatsRecord> records = sortedRecords(result.samples);
+    std::string path = config.bookPath + ".run" + std::to_string(result.id) + "-" + std::to_string(result.runPaths.size());
+    std::ofstream run(path, std::ios::binary);
+    run.write((const char*)records.data(), records.size() * sizeof(BookStatsRecord));
+    if (!run) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    result.runPaths.push_back(path);
+    SampleMap().swap(result.samples);
+    return true;
+}
+
+// Reduce: k-way merge of the sorted runs and what was left in memory. Equal
+// (key, move) pairs are summed; each position's moves are then weighted for the book.
+bool BookBuilder::merge(std::vector<ThreadResult>& results) {
+    struct Source {
+        std::ifstream file;
+        std::vector<BookStatsRecord> buffer;
+        size_t index = 0;
+
+        bool next(BookStatsRecord& record) {
+            if (index == buffer.size()) {
+                if (!file.is_open()) return false;
+                buffer.resize(4096);
+                file.read((char*)buffer.data(), buffer.size() * sizeof(BookStatsRecord));
+                buffer.resize(size_t(file.gcount()) / sizeof(BookStatsRecord));
+                index = 0;
+                if (buffer.empty()) return false;
+            }
+            record = buffer[index++];
+            return true;
+        }
+    };
+
+    std::vector<std::unique_ptr<Source>> sources;
+    for (ThreadResult& result : results) {
+        for (const std::string& path : result.runPaths) {
+            sources.push_back(std::make_unique<Source>());
+            sources.back()->file.open(path, std::ios::binary);
+        }
+        sources.push_back(std::make_unique<Source>());
+        sources.back()->buffer.swap(result.rest);
+    }
+
+    std::ofstream book(config.bookPath, std::ios::binary);
+    std::ofstream statsFile(config.statsPath, std::ios::binary);
+    if (!book || !statsFile) {
+        std::cerr << "Cannot write " << (book ? config.statsPath : config.bookPath) << std::endl;
+        return false;
+    }
+    uint8_t header[StatsHeaderSize] = {};
+    std::memcpy(header, StatsMagic, sizeof(StatsMagic));
+    uint32_t flags = BookStatsPolyglotKeys;
+    std::memcpy(header + 8, &flags, 4);
+    std::memcpy(header + 12, &config.maxPly, 4);
+    statsFile.write((const char*)header, sizeof(header));
+
+    std::vector<BookStatsRecord> position;
+    std::vector<PolyglotEntry> entries;
+    auto writePosition = [&]() {
+        if (position.empty()) return;
+        statsFile.write((const char*)position.data(), position.size() * sizeof(BookStatsRecord));
+        stats.entries += position.size();
+
+        // Polyglot weights: two per win and one per draw, scaled into 16 bits
+        uint64_t maxWeight = 0;
+        for (const BookStatsRecord& record : position) {
+            if (record.games() >= config.minGames) maxWeight = std::max<uint64_t>(maxWeight, 2ull * record.wins + record.draws);
+        }
+        entries.clear();
+        for (const BookStatsRecord& record : position) {
+            if (record.games() < config.minGames || maxWeight == 0) continue;
+            uint64_t weight = 2ull * record.wins + record.draws;
+            if (maxWeight > 0xFFFF) weight = weight * 0xFFFF / maxWeight;
+            if (weight == 0) continue;   // only ever lost
+            PolyglotEntry entry;
+            entry.key = record.key;
+            entry.move = record.move;
+            entry.weight = uint16_t(weight);
+            entries.push_back(entry);
+        }
+        std::stable_sort(entries.begin(), entries.end(), [](const PolyglotEntry& a, const PolyglotEntry& b) {
+            return a.weight > b.weight;
+        });
+        for (const PolyglotEntry& entry : entries) {
+            uint8_t bytes[PolyglotEntrySize];
+            writePolyglotEntry(bytes, entry);
+            book.write((const char*)bytes, sizeof(bytes));
+        }
+        stats.bookEntries += entries.size();
+        if (!entries.empty()) stats.bookPositions++;
+        position.clear();
+    };
+
+    typedef std::pair<BookStatsRecord, size_t> HeapItem;
+    auto heapOrder = [](const HeapItem& a, const HeapItem& b) { return recordLess(b.first, a.first); };
+    std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(heapOrder)> heap(heapOrder);
+    BookStatsRecord record;
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources[i]->next(record)) heap.push({ record, i });
+    }
+    while (!heap.empty()) {
+        HeapItem top = heap.top();
+        heap.pop();
+        if (sources[top.second]->next(record)) heap.push({ record, top.second });
+
+        if (!position.empty() && position.back().key == top.first.key && position.back().move == top.first.move) {
+            position.back().wins += top.first.wins;
+            position.back().draws += top.first.draws;
+            position.back().losses += top.first.losses;
+            continue;
+        }
+        if (!position.empty() && position.back().key != top.first.key) writePosition();
+        position.push_back(top.first);
+    }
+    writePosition();
+
+    sources.clear();
+    for (const ThreadResult& result : results) {
+        for (const std::string& path : result.runPaths) std::remove(path.c_str());
+    }
+    if (!book || !statsFile) {
+        std::cerr << "Write error in " << config.bookPath << " or " << config.statsPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BookBuilder::build() {
+    if (!config.randomPath.empty() && !hasher.loadRandom(config.randomPath)) return false;
+    if (!mapInputs()) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    int threadCount = std::max(1, config.threads);
+    std::vector<ThreadResult> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        results[t].id = t;
+        results[t].maxSamples = std::max<size_t>(1024, config.memoryMb * 1024 * 1024 / threadCount / BytesPerSample);
+        threads.emplace_back(&BookBuilder::replaySlices, this, std::ref(results[t]));
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    // Sorting what is left is part of the map phase, so it runs on the threads too
+    threads.clear();
+    for (ThreadResult& result : results) {
+        threads.emplace_back([&result] {
+            result.rest = sortedRecords(result.samples);
+            SampleMap().swap(result.samples);
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    auto replayed = std::chrono::steady_clock::now();
+
+    bool failed = false;
+    for (const ThreadResult& result : results) {
+        stats.games += result.games;
+        stats.skippedGames += result.skippedGames;
+        stats.positions += result.positions;
+        stats.runs += result.runPaths.size();
+        failed = failed || result.failed;
+    }
+    bool merged = !failed && merge(results);
+    auto end = std::chrono::steady_clock::now();
+    stats.replayMs = std::chrono::duration_cast<std::chrono::milliseconds>(replayed - start).count();
+    stats.mergeMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - replayed).count();
+    if (failed) {
+        for (const ThreadResult& result : results) {
+            for (const std::string& path : result.runPaths) std::remove(path.c_str());
+        }
+    }
+    return merged;
+}
+
+bool readBookStats(const std::string& path, uint64_t key, std::vector<BookStatsRecord>& records, bool* polyglotKeys) {
+    records.clear();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    int64_t size = file.tellg();
+    char header[StatsHeaderSize];
+    file.seekg(0);
+    if (size < int64_t(StatsHeaderSize) || !file.read(header, sizeof(header)) || std::memcmp(header, StatsMagic, 8) != 0) {
+        return false;
+    }
+    uint32_t flags;
+    std::memcpy(&flags, header + 8, 4);
+    if (polyglotKeys) *polyglotKeys = (flags & BookStatsPolyglotKeys) != 0;
+
+    // Binary search for the first record of the key
+    auto readAt = [&](int64_t index, BookStatsRecord& record) {
+        file.seekg(StatsHeaderSize + index * sizeof(BookStatsRecord));
+        return bool(file.read((char*)&record, sizeof(record)));
+    };
+    int64_t low = 0, high = (size - int64_t(StatsHeaderSize)) / int64_t(sizeof(BookStatsRecord));
+    BookStatsRecord record;
+    while (low < high) {
+        int64_t middle = (low + high) / 2;
+        if (!readAt(middle, record)) return false;
+        if (record.key < key) low = middle + 1;
+        else high = middle;
+    }
+    file.clear();
+    file.seekg(StatsHeaderSize + low * sizeof(BookStatsRecord));
+    while (file.read((char*)&record, sizeof(record)) && record.key == key) records.push_back(record);
+    return true;
+}
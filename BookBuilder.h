@@ -0,0 +1,86 @@
+#pragma once
+#include "Polyglot.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Opening book builder: replays PGN games in parallel up to a ply limit and
+// counts wins / draws / losses of every (position, move) for the side that
+// played it. Each thread aggregates into its own hash map; a map that grows
+// past its share of the memory cap is written out as a sorted run. The
+// reduce step merges all runs into a weighted Polyglot .bin and a statistics
+// file of the raw counts.
+
+struct BookBuildConfig {
+    std::vector<std::string> pgnPaths;
+    std::string bookPath = "book.bin";
+    std::string statsPath;             // default: bookPath + ".stats"
+    std::string randomPath;            // Random64 table replacing the built-in one
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int maxPly = 24;
+    size_t memoryMb = 512;             // all threads' hash maps together
+    uint32_t minGames = 1;             // moves played fewer times stay out of the .bin
+};
+
+struct BookBuildStats {
+    uint64_t games = 0;
+    uint64_t skippedGames = 0;         // no result or no moves
+    uint64_t positions = 0;            // (position, move) samples counted
+    uint64_t entries = 0;              // distinct (position, move) pairs
+    uint64_t bookEntries = 0;
+    uint64_t bookPositions = 0;
+    uint64_t runs = 0;                 // sorted runs written to disk
+    int64_t replayMs = 0;
+    int64_t mergeMs = 0;
+};
+
+// Statistics file: 16-byte header ("BOOKSTAT", u32 flags, u32 max ply) and
+// records sorted by key and move. Counts are for the side to move.
+const uint32_t BookStatsPolyglotKeys = 1;
+
+struct BookStatsRecord {
+    uint64_t key;
+    uint16_t move;                     // Polyglot encoding
+    uint16_t unused;
+    uint32_t wins;
+    uint32_t draws;
+    uint32_t losses;
+
+    uint64_t games() const { return uint64_t(wins) + draws + losses; }
+};
+
+// Every record of one position from a statistics file; false if the file
+// cannot be read. polyglotKeys receives the header flag so the caller can hash to match.
+bool readBookStats(const std::string& path, uint64_t key, std::vector<BookStatsRecord>& records, bool* polyglotKeys = nullptr);
+
+class BookBuilder {
+public:
+    explicit BookBuilder(const BookBuildConfig& config);
+    ~BookBuilder();
+
+    bool build();
+    const BookBuildStats& statistics() const { return stats; }
+
+private:
+    struct ThreadResult;
+    struct Slice {                     // whole games of one memory-mapped PGN file
+        const char* begin;
+        const char* end;
+    };
+
+    bool mapInputs();
+    void replaySlices(ThreadResult& result);
+    bool spill(ThreadResult& result);
+    bool merge(std::vector<ThreadResult>& results);
+
+    BookBuildConfig config;
+    BookHasher hasher;
+    BookBuildStats stats;
+    std::vector<std::pair<void*, size_t>> mappings;
+    std::vector<Slice> slices;
+    std::atomic<size_t> nextSlice{ 0 };
+};
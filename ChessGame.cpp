@@ -1,11 +1,23 @@
 #include "ChessGame.h"
 #include <iostream>
 #include <cmath>
+#include <cstdio>
 #include <algorithm>
 
+// Strip along the top of the board with the review buttons and the ply slider
+static const int ReplayBarHeight = 32;
+static const int SliderLeft = 176;
+static const int SliderWidth = 504;
 
+ChessGame::ChessGame() : ChessGame(true) {
+}
 
-ChessGame::ChessGame() : window(sf::VideoMode(800, 800), "SFML Chess") {
+ChessGame::ChessGame(bool openWindow) {
+    if (openWindow) {
+        window.create(sf::VideoMode(800, 800), "SFML Chess");
+        window.setFramerateLimit(60);
+    }
+    pieceVertices.setPrimitiveType(sf::Quads);
     initializeBoard();
     loadTextures();
     loadSounds();
@@ -20,8 +32,6 @@ ChessGame::ChessGame() : window(sf::VideoMode(800, 800), "SFML Chess") {
             }
         }
     }
-
-    window.setFramerateLimit(60);
 }
 //piece to char for log
 char ChessGame::pieceTypeToChar(PieceType type) {
@@ -83,10 +93,15 @@ void ChessGame::loadTextures() {
         debugImg.create(200, 200, sf::Color::Magenta);
         piecesTexture.loadFromImage(debugImg);
         std::cout << "Using debug texture instead\n";
-        return;
     }
+    else {
+        std::cout << "Successfully loaded chess pieces texture\n";
+    }
+    slicePieceSprites();
+}
 
-    std::cout << "Successfully loaded chess pieces texture\n";
+// Points every piece's sprite at its cell of the texture already in memory
+void ChessGame::slicePieceSprites() {
     sf::Vector2u textureSize = piecesTexture.getSize();
     int pieceWidth = textureSize.x / 6;
     int pieceHeight = textureSize.y / 2;
@@ -250,6 +265,17 @@ void ChessGame::handleKeyPress(sf::Keyboard::Key key) {
         rotateBoard = !rotateBoard;
         std::cout << "Rotate Board: " << (rotateBoard ? "ON" : "OFF") << std::endl;
     }
+    if (key == sf::Keyboard::F3) {
+        hudEnabled = !hudEnabled;
+    }
+    if (key == sf::Keyboard::F4) {
+        if (profiler.saveChromeTrace("frame-trace.json")) {
+            std::cout << "Frame trace written to frame-trace.json" << std::endl;
+        }
+        else {
+            std::cerr << "Cannot write frame-trace.json" << std::endl;
+        }
+    }
 
     //
 
@@ -276,8 +302,13 @@ void ChessGame::handleKeyPress(sf::Keyboard::Key key) {
                 std::cout << "\n=== Starting Multiplayer Mode ===\n";
                 menuState = MenuState::InGame;
                 resetGame();
+                restartAnalysis();
                 break;
-            case 2: // Quit
+            case 2: // Online
+                std::cout << "\n=== Starting Online Mode ===\n";
+                startNetworkGame();
+                break;
+            case 3: // Quit
                 std::cout << "Quitting game...\n";
                 window.close();
                 break;
@@ -294,17 +325,88 @@ void ChessGame::handleKeyPress(sf::Keyboard::Key key) {
         switch (key) {
         case sf::Keyboard::Escape:
             std::cout << "\nReturning to main menu...\n";
+            stopNetworkGame();
+            if (analysis) analysis->stop();
             menuState = MenuState::MainMenu;
             selectedMenuItem = 0;
             break;
+        case sf::Keyboard::Left:
+        case sf::Keyboard::Z:
+            // While reviewing the arrows step through the game instead of changing it
+            if (isReviewing()) {
+                seekReview(reviewPly - 1);
+                break;
+            }
+            if (networkMode) break;
+            takeBack();
+            break;
+        case sf::Keyboard::Right:
+        case sf::Keyboard::Y:
+            if (isReviewing()) {
+                seekReview(reviewPly + 1);
+                break;
+            }
+            if (networkMode) break;
+            redoMove();
+            break;
+        case sf::Keyboard::Home:
+            seekReview(0);
+            break;
+        case sf::Keyboard::PageUp:
+            seekReview(shownPly() - 1);
+            break;
+        case sf::Keyboard::PageDown:
+            seekReview(shownPly() + 1);
+            break;
+        case sf::Keyboard::End:
+            seekReview(replay.length());
+            break;
+        case sf::Keyboard::N:
+        case sf::Keyboard::P:
+            if (archive.empty() || networkMode) break;
+            openArchiveGame(archiveIndex + (key == sf::Keyboard::N ? 1 : -1));
+            break;
+        case sf::Keyboard::Q:
+            if (networkMode && !networkGameOver) {
+                network.send(Frame(MessageType::Resign));
+            }
+            break;
+        case sf::Keyboard::C:
+            if (networkMode) {
+                network.send(Frame(MessageType::ClockRequest));
+            }
+            break;
+        case sf::Keyboard::A:
+            if (networkMode) break;
+            analysisEnabled = !analysisEnabled;
+            std::cout << "Analysis: " << (analysisEnabled ? "ON" : "OFF") << std::endl;
+            if (analysisEnabled) {
+                if (!analysis) {
+                    analysis = std::make_unique<Analysis>();
+                    analysis->setTablebases(&tablebases);
+                }
+                restartAnalysis();
+            }
+            else {
+                analysis->stop();
+            }
+            break;
+        case sf::Keyboard::Add:
+        case sf::Keyboard::Equal:
+        case sf::Keyboard::Subtract:
+        case sf::Keyboard::Hyphen:
+            if (!analysisEnabled) break;
+            analysis->setLineCount(analysis->lineCount() + (key == sf::Keyboard::Add || key == sf::Keyboard::Equal ? 1 : -1));
+            std::cout << "Analysis lines: " << analysis->lineCount() << std::endl;
+            restartAnalysis();
+            break;
         default:
             break;
         }
     }
 }
 
-void ChessGame::resetGame() {
-    // Reset game state
+void ChessGame::clearGameState() {
     isPieceSelected = false;
     currentTurn = Color::White;
     gameState = GameState::Playing;
@@ -315,10 +417,27 @@ void ChessGame::resetGame() {
     blackRookKingsideMoved = false;
     blackRookQueensideMoved = false;
     moveHistory.clear();
+    undoHistory.clear();
+    redoMoves.clear();
+    moveLog.clear();
+    moveNumber = 1;
+    whiteToMove = true;
+    lastMoveFrom = { -1, -1 };
+    lastMoveTo = { -1, -1 };
+    lastMovePieceType = PieceType::None;
+    reviewPly = -1;
+    draggingSlider = false;
+}
+
+void ChessGame::resetGame() {
+    clearGameState();
 
     // Reinitialize board
     initializeBoard();
-    loadTextures();
+    slicePieceSprites();
+    position.setStartPosition();
+    replay.reset(position);
+    invalidateLegalMoves();
 
     std::cout << "White to move first." << std::endl;
     std::cout << "Features:" << std::endl;
@@ -326,12 +445,76 @@ void ChessGame::resetGame() {
     std::cout << "- Castling (king and rook must not have moved)" << std::endl;
     std::cout << "- Check detection and prevention" << std::endl;
     std::cout << "- Checkmate and stalemate detection" << std::endl;
+    std::cout << "- Draws by repetition, fifty-move rule and insufficient material" << std::endl;
     std::cout << "- Pawn promotion to Queen" << std::endl;
+    std::cout << "- En passant captures" << std::endl;
     std::cout << "Click on a piece to select it, then click on a destination square to move." << std::endl;
+    std::cout << "Press LEFT/Z to take back a move, RIGHT/Y to redo it." << std::endl;
+    std::cout << "Press HOME/PAGE UP/PAGE DOWN/END to review the game, drag the slider to jump to a move." << std::endl;
+    std::cout << "Press A to toggle the analysis panel, +/- for more or fewer lines." << std::endl;
     std::cout << "Press ESC to return to main menu." << std::endl << std::endl;
 
 }
 
+// Sets up an arbitrary position with an empty history (benchmarks, analysis)
+bool ChessGame::loadFen(const std::string& fen) {
+    Position loaded;
+    if (!loaded.setFromFen(fen)) return false;
+
+    clearGameState();
+    position = loaded;
+    replay.reset(position);
+    syncBoardFromPosition();
+    gameState = isInCheck(currentTurn) ? GameState::Check : GameState::Playing;
+    return true;
+}
+
+// Rebuilds the sprite board and the castling / turn bookkeeping from the rules core
+void ChessGame::syncBoardFromPosition() {
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            int sq = makeSquare(col, row);
+            PieceType type = position.pieceAt(sq);
+            Piece piece = { type, type == PieceType::None ? Color::White : position.colorAt(sq) };
+            // Only castling kings and rooks and unmoved pawns keep their first-move rights
+            piece.hasMoved = type != PieceType::None;
+            if (type == PieceType::Pawn) {
+                piece.hasMoved = row != (piece.color == Color::White ? 1 : 6);
+            }
+            board[row][col] = piece;
+        }
+    }
+    int rights = position.castlingRights();
+    if (rights & WhiteKingside) board[0][7].hasMoved = false;
+    if (rights & WhiteQueenside) board[0][0].hasMoved = false;
+    if (rights & BlackKingside) board[7][7].hasMoved = false;
+    if (rights & BlackQueenside) board[7][0].hasMoved = false;
+    if (rights & (WhiteKingside | WhiteQueenside)) board[0][4].hasMoved = false;
+    if (rights & (BlackKingside | BlackQueenside)) board[7][4].hasMoved = false;
+    whiteKingMoved = !(rights & (WhiteKingside | WhiteQueenside));
+    blackKingMoved = !(rights & (BlackKingside | BlackQueenside));
+    whiteRookKingsideMoved = !(rights & WhiteKingside);
+    whiteRookQueensideMoved = !(rights & WhiteQueenside);
+    blackRookKingsideMoved = !(rights & BlackKingside);
+    blackRookQueensideMoved = !(rights & BlackQueenside);
+
+    // En passant is derived from the last move: recreate the double push
+    if (position.epSquare() != -1) {
+        int col = squareCol(position.epSquare());
+        int row = squareRow(position.epSquare());
+        int direction = row == 2 ? 1 : -1;
+        lastMoveFrom = { col, row - direction };
+        lastMoveTo = { col, row + direction };
+        lastMovePieceType = PieceType::Pawn;
+    }
+
+    currentTurn = position.sideToMove();
+    whiteToMove = currentTurn == Color::White;
+    moveNumber = position.fullmoveNumber();
+    slicePieceSprites();
+    invalidateLegalMoves();
+}
+
 bool ChessGame::isValidMove(sf::Vector2i from, sf::Vector2i to) const {
     if (!isInBounds(from) || !isInBounds(to) || from == to) return false;
 
@@ -588,11 +771,58 @@ std::vector<sf::Vector2i> ChessGame::getAllValidMoves(Color color) const {
     return allMoves;
 }
 
+// Legal moves are computed once per position for the side to move and reused
+// until the next move, reset or takeback. The rules core generates them with
+// pin/check masks instead of probing isValidMove for every square pair.
+void ChessGame::buildLegalMoveCache() const {
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            legalMoveCache[row][col].clear();
+        }
+    }
+
+    MoveList moves;
+    position.generateLegal(moves);
+    for (PackedMove move : moves) {
+        // Promotions are always to a queen, so skip the underpromotion duplicates
+        if (isPromotionMove(move) && promotionType(move) != PieceType::Queen) continue;
+        int from = moveFrom(move);
+        int to = moveTo(move);
+        legalMoveCache[squareRow(from)][squareCol(from)].emplace_back(squareCol(to), squareRow(to));
+    }
+    anyLegalMove = !moves.empty();
+    legalMovesValid = true;
+}
+
+void ChessGame::invalidateLegalMoves() {
+    legalMovesValid = false;
+}
+
+const std::vector<sf::Vector2i>& ChessGame::getLegalMoves(sf::Vector2i position) const {
+    if (!legalMovesValid) {
+        buildLegalMoveCache();
+    }
+    return legalMoveCache[position.y][position.x];
+}
+
+bool ChessGame::isLegalMove(sf::Vector2i from, sf::Vector2i to) const {
+    if (!isInBounds(from) || !isInBounds(to)) return false;
+    const auto& moves = getLegalMoves(from);
+    return std::find(moves.begin(), moves.end(), to) != moves.end();
+}
+
+bool ChessGame::hasAnyLegalMove() const {
+    if (!legalMovesValid) {
+        buildLegalMoveCache();
+    }
+    return anyLegalMove;
+}
+
 void ChessGame::updateGameState() {
+    FrameProfiler::Scope span(profiler, FrameSpan::GameState);
     bool inCheck = isInCheck(currentTurn);
-    auto validMoves = getAllValidMoves(currentTurn);
 
-    if (validMoves.empty()) {
+    if (!hasAnyLegalMove()) {
         gameState = inCheck ? GameState::Checkmate : GameState::Stalemate;
 
         if (gameState == GameState::Checkmate) {
@@ -601,6 +831,20 @@ void ChessGame::updateGameState() {
         else {
             std::cout << "\n*** STALEMATE! The game is a draw. ***\n";
         }
+        return;
+    }
+
+    GameState drawResult = position.drawState();
+    if (drawResult != GameState::Playing) {
+        gameState = drawResult;
+        switch (drawResult) {
+        case GameState::ThreefoldRepetition: std::cout << "\n*** DRAW by threefold repetition. ***\n"; break;
+        case GameState::FivefoldRepetition: std::cout << "\n*** DRAW by fivefold repetition. ***\n"; break;
+        case GameState::FiftyMoveRule: std::cout << "\n*** DRAW by the fifty-move rule. ***\n"; break;
+        case GameState::SeventyFiveMoveRule: std::cout << "\n*** DRAW by the seventy-five-move rule. ***\n"; break;
+        case GameState::InsufficientMaterial: std::cout << "\n*** DRAW by insufficient material. ***\n"; break;
+        default: break;
+        }
     }
     else {
         GameState previousState = gameState;
@@ -609,6 +853,15 @@ void ChessGame::updateGameState() {
         if (gameState == GameState::Check && previousState != GameState::Check) {
             std::cout << "\n*** CHECK! " << (currentTurn == Color::White ? "White" : "Black") << " king is in check! ***\n";
         }
+
+        TablebaseResult result;
+        if (tablebases.tableCount() && tablebases.probe(position, result)) {
+            const char* mover = currentTurn == Color::White ? "White" : "Black";
+            const char* other = currentTurn == Color::White ? "Black" : "White";
+            if (result.wdl > 0) std::cout << "Tablebase: " << mover << " mates in " << (result.dtm + 1) / 2 << "\n";
+            else if (result.wdl < 0) std::cout << "Tablebase: " << other << " mates in " << result.dtm / 2 << "\n";
+            else std::cout << "Tablebase: draw with best play\n";
+        }
     }
 }
 
@@ -628,17 +881,48 @@ void ChessGame::performCastling(sf::Vector2i kingFrom, sf::Vector2i kingTo) {
 }
 
 
-void ChessGame::movePiece(sf::Vector2i from, sf::Vector2i to) {
+void ChessGame::movePiece(sf::Vector2i from, sf::Vector2i to, PackedMove exact) {
+    FrameProfiler::Scope span(profiler, FrameSpan::MovePiece);
     std::cout << "Moving from (" << from.x << "," << from.y << ") to (" << to.x << "," << to.y << ")\n";
     Piece& movingPiece = board[from.y][from.x];
+    invalidateLegalMoves();
+
+    // Resolve the move in the rules core before the board changes
+    PackedMove coreMove = exact != NullMove ? exact : position.findMove(makeSquare(from.x, from.y), makeSquare(to.x, to.y));
     
     //moveLog
-    bool isCapture = (board[to.y][to.x].type != PieceType::None);
+    bool isEnPassant = (coreMove != NullMove && moveFlag(coreMove) == FlagEnPassant);
+    bool isCapture = (board[to.y][to.x].type != PieceType::None) || isEnPassant;
+
+    // Snapshot what a takeback needs before anything changes
+    UndoRecord undo;
+    undo.movedPiece = movingPiece;
+    undo.capturedAt = isEnPassant ? sf::Vector2i(to.x, from.y) : to;
+    undo.capturedPiece = board[undo.capturedAt.y][undo.capturedAt.x];
+    undo.coreMove = coreMove;
+    undo.lastMoveFrom = lastMoveFrom;
+    undo.lastMoveTo = lastMoveTo;
+    undo.lastMovePieceType = lastMovePieceType;
+    undo.gameState = gameState;
+    undo.rotateBoard = rotateBoard;
+    undo.moveNumber = moveNumber;
+    undo.whiteToMove = whiteToMove;
+    if (!whiteToMove && !moveLog.empty()) {
+        undo.moveLogLine = moveLog.back();
+    }
+
     char movingPieceChar = pieceTypeToChar(movingPiece.type); 
     logMove(movingPieceChar, from, to, isCapture);
     
     // Handle special moves
     bool isCastling = (movingPiece.type == PieceType::King && abs(to.x - from.x) == 2);
+
+    Move move;
+    move.from = from;
+    move.to = to;
+    move.capturedPiece = undo.capturedPiece.type;
+    move.isCastling = isCastling;
+    move.isEnPassant = isEnPassant;
     
 
     // Print move to console
@@ -659,9 +943,8 @@ void ChessGame::movePiece(sf::Vector2i from, sf::Vector2i to) {
         moveSound.play();
     }
     std::cout << " from (" << from.x << "," << from.y << ") to (" << to.x << "," << to.y << ")";
-    if (board[to.y][to.x].type != PieceType::None) {
-        std::cout << " (captures)";
-        
+    if (isCapture) {
+        std::cout << (isEnPassant ? " (captures en passant)" : " (captures)");
     }
     if (isCastling) {
         std::cout << " (castling)";
@@ -680,8 +963,11 @@ void ChessGame::movePiece(sf::Vector2i from, sf::Vector2i to) {
     if (isCastling) {
         performCastling(from, to);
     }
+    if (isEnPassant) {
+        board[from.y][to.x] = { PieceType::None, Color::White };
+    }
 
-    // Handle pawn promotion (simplified - always promote to queen)
+    // Handle pawn promotion: to a queen unless the core move says otherwise
 
     //rotate board autoupdate
     rotateBoard = (currentTurn == Color::Black);
@@ -693,22 +979,115 @@ void ChessGame::movePiece(sf::Vector2i from, sf::Vector2i to) {
         if ((movedPiece.color == Color::White && to.y == 7) ||  // White promotes at bottom row
             (movedPiece.color == Color::Black && to.y == 0)) {  // Black promotes at top row
 
-            movedPiece.type = PieceType::Queen;
+            PieceType promoted = (coreMove != NullMove && isPromotionMove(coreMove)) ? promotionType(coreMove) : PieceType::Queen;
+            movedPiece.type = promoted;
 
             // Update sprite for promoted piece
-            sf::Vector2u textureSize = piecesTexture.getSize();
-            int pieceWidth = textureSize.x / 6;
-            int pieceHeight = textureSize.y / 2;
-            int spriteX = 3 * pieceWidth; // Queen sprite
-            int spriteY = (movedPiece.color == Color::Black) ? 0 : pieceHeight;
-
-            movedPiece.setTexture(piecesTexture, spriteX, spriteY, pieceWidth, pieceHeight);
+            sf::IntRect cell = pieceTextureRect(promoted, movedPiece.color);
+            movedPiece.setTexture(piecesTexture, cell.left, cell.top, cell.width, cell.height);
             movedPiece.sprite.setPosition(to.x * 100 + 50, to.y * 100 + 50);
 
-            std::cout << "*** PAWN PROMOTION! Promoted to Queen ***" << std::endl;
+            std::cout << "*** PAWN PROMOTION! Promoted to " << pieceTypeToChar(promoted) << " ***" << std::endl;
+            move.isPromotion = true;
+            move.promotionPiece = promoted;
         }
     }
 
+    if (coreMove != NullMove) {
+        position.makeMove(coreMove);
+        replay.push(coreMove);
+    }
+    else {
+        std::cerr << "Warning: move not recognised by the rules core" << std::endl;
+    }
+
+    lastMoveFrom = from;
+    lastMoveTo = to;
+    lastMovePieceType = undo.movedPiece.type;
+
+    moveHistory.push_back(move);
+    undoHistory.push_back(undo);
+    restartAnalysis();
+}
+
+// Make a move and hand the turn over (mouse input and redo)
+void ChessGame::playMove(sf::Vector2i from, sf::Vector2i to, PackedMove exact) {
+    movePiece(from, to, exact);
+    currentTurn = oppositeColor(currentTurn);
+    updateGameState();
+
+    std::cout << "Turn: " << (currentTurn == Color::White ? "White" : "Black") << std::endl;
+}
+
+// Restore the position before the last move from its undo record: no board
+// re-initialisation and no texture reload
+void ChessGame::takeBack() {
+    if (undoHistory.empty()) {
+        std::cout << "Nothing to take back." << std::endl;
+        return;
+    }
+
+    const UndoRecord& undo = undoHistory.back();
+    const Move& move = moveHistory.back();
+
+    board[move.from.y][move.from.x] = undo.movedPiece;
+    board[move.to.y][move.to.x] = { PieceType::None, Color::White };
+    if (undo.capturedPiece.type != PieceType::None) {
+        board[undo.capturedAt.y][undo.capturedAt.x] = undo.capturedPiece;
+    }
+    if (move.isCastling) {
+        bool kingside = (move.to.x > move.from.x);
+        int row = move.from.y;
+        int rookFromCol = kingside ? 7 : 0;
+        int rookToCol = kingside ? 5 : 3;
+        board[row][rookFromCol] = board[row][rookToCol];
+        board[row][rookFromCol].hasMoved = false;
+        board[row][rookToCol] = { PieceType::None, Color::White };
+    }
+
+    if (undo.coreMove != NullMove) {
+        position.unmakeMove(undo.coreMove);
+        replay.truncate(replay.length() - 1);
+    }
+
+    // Move log: White's move opened a line, Black's move was appended to one
+    if (undo.whiteToMove) {
+        if (!moveLog.empty()) moveLog.pop_back();
+    }
+    else if (!moveLog.empty()) {
+        moveLog.back() = undo.moveLogLine;
+    }
+    moveNumber = undo.moveNumber;
+    whiteToMove = undo.whiteToMove;
+    saveMoveLog();
+
+    lastMoveFrom = undo.lastMoveFrom;
+    lastMoveTo = undo.lastMoveTo;
+    lastMovePieceType = undo.lastMovePieceType;
+    gameState = undo.gameState;
+    rotateBoard = undo.rotateBoard;
+    currentTurn = oppositeColor(currentTurn);
+    isPieceSelected = false;
+    invalidateLegalMoves();
+
+    redoMoves.push_back(move);
+    moveHistory.pop_back();
+    undoHistory.pop_back();
+    restartAnalysis();
+
+    std::cout << "Move taken back. Turn: " << (currentTurn == Color::White ? "White" : "Black") << std::endl;
+}
+
+void ChessGame::redoMove() {
+    if (redoMoves.empty()) {
+        std::cout << "Nothing to redo." << std::endl;
+        return;
+    }
+
+    Move move = redoMoves.back();
+    redoMoves.pop_back();
+    isPieceSelected = false;
+    playMove(move.from, move.to);
 }
 
 void ChessGame::handleMouseClick(sf::Vector2i mousePos) {
@@ -727,12 +1106,29 @@ void ChessGame::handleMouseClick(sf::Vector2i mousePos) {
         return;
     }
 
+    // Earlier positions are for looking only
+    if (isReviewing()) {
+        isPieceSelected = false;
+        return;
+    }
 
     if (!isInBounds(boardPos)) {
         isPieceSelected = false;
         return;
     }
 
+    // No more moves once the game has ended
+    if (gameState == GameState::Checkmate || isDraw(gameState) || networkGameOver) {
+        isPieceSelected = false;
+        return;
+    }
+
+    // Online: only our own pieces, only on our turn
+    if (networkMode && (networkColor == -1 || currentTurn != (networkColor == 0 ? Color::White : Color::Black))) {
+        isPieceSelected = false;
+        return;
+    }
+
 
     if (!isPieceSelected) {
         if (board[boardPos.y][boardPos.x].type != PieceType::None &&
@@ -762,18 +1158,21 @@ void ChessGame::handleMouseClick(sf::Vector2i mousePos) {
         }
     }
     else {
-        if (isValidMove(selectedPosition, boardPos)) {
-            movePiece(selectedPosition, boardPos);
-            currentTurn = oppositeColor(currentTurn);
-            updateGameState();
-
-            std::cout << "Turn: " << (currentTurn == Color::White ? "White" : "Black") << std::endl;
+        if (isLegalMove(selectedPosition, boardPos) && networkMode) {
+            // The server validates the move and echoes it back to both players
+            PackedMove move = position.findMove(makeSquare(selectedPosition.x, selectedPosition.y), makeSquare(boardPos.x, boardPos.y));
+            network.send(Frame(MessageType::Move).u16(move));
+        }
+        else if (isLegalMove(selectedPosition, boardPos)) {
+            // A new move abandons the redo line
+            redoMoves.clear();
+            playMove(selectedPosition, boardPos);
         }
         isPieceSelected = false;
     }
 }
 
-void ChessGame::drawBoard() {
+void ChessGame::drawBoard(sf::RenderTarget& target) {
     sf::RectangleShape square(sf::Vector2f(100, 100));
 
     for (int row = 0; row < 8; row++) {
@@ -785,18 +1184,18 @@ void ChessGame::drawBoard() {
             square.setPosition(drawX * 100, drawY * 100);
             bool isLightSquare = (col + row) % 2 == 0;
             square.setFillColor(isLightSquare ? sf::Color(240, 217, 181) : sf::Color(181, 136, 99));
-            window.draw(square);
+            target.draw(square);
         }
     }
 
    }
 
 
-void ChessGame::drawPieces() {
+void ChessGame::drawPieces(sf::RenderTarget& target) {
     for (int row = 0; row < 8; row++) {
         for (int col = 0; col < 8; col++) {
             if (board[row][col].type != PieceType::None) {
-                window.draw(board[row][col].sprite);
+                target.draw(board[row][col].sprite);
             }
         }
     }
@@ -807,14 +1206,56 @@ void ChessGame::drawPieces() {
                 int drawX = x;
                 int drawY = rotateBoard ? 7 - y : y;
                 board[y][x].sprite.setPosition(drawX * 100 + 50, drawY * 100 + 50);
-                window.draw(board[y][x].sprite);
+                target.draw(board[y][x].sprite);
             }
         }
     }
 }
 
-void ChessGame::drawSelection() {
-    
+// Same squares as drawPieces, but every piece is drawn once and all of them
+// go out in a single draw call: one textured quad per piece in a reused vertex array
+void ChessGame::drawPiecesBatched(sf::RenderTarget& target) {
+    pieceVertices.clear();
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            sf::IntRect rect;
+            if (isReviewing()) {
+                int sq = makeSquare(x, y);
+                PieceType type = reviewPosition.pieceAt(sq);
+                if (type == PieceType::None) continue;
+                rect = pieceTextureRect(type, reviewPosition.colorAt(sq));
+            }
+            else {
+                const Piece& piece = board[y][x];
+                if (piece.type == PieceType::None) continue;
+                rect = piece.sprite.getTextureRect();
+            }
+            float left = x * 100.0f + 10.0f;
+            float top = (rotateBoard ? 7 - y : y) * 100.0f + 10.0f;
+            float u = float(rect.left), v = float(rect.top);
+            float w = float(rect.width), h = float(rect.height);
+
+            pieceVertices.append(sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(u, v)));
+            pieceVertices.append(sf::Vertex(sf::Vector2f(left + 80.0f, top), sf::Vector2f(u + w, v)));
+            pieceVertices.append(sf::Vertex(sf::Vector2f(left + 80.0f, top + 80.0f), sf::Vector2f(u + w, v + h)));
+            pieceVertices.append(sf::Vertex(sf::Vector2f(left, top + 80.0f), sf::Vector2f(u, v + h)));
+        }
+    }
+    target.draw(pieceVertices, &piecesTexture);
+}
+
+void ChessGame::drawSelection(sf::RenderTarget& target) {
+    if (isReviewing()) {
+        if (reviewPosition.inCheck()) {
+            int king = reviewPosition.kingSquare(reviewPosition.sideToMove());
+            sf::RectangleShape checkHighlight(sf::Vector2f(100, 100));
+            checkHighlight.setPosition(squareCol(king) * 100, (rotateBoard ? 7 - squareRow(king) : squareRow(king)) * 100);
+            checkHighlight.setFillColor(sf::Color(255, 0, 0, 128));
+            target.draw(checkHighlight);
+        }
+        return;
+    }
+
     if (isPieceSelected) {
         // board rotation 
         int drawX = selectedPosition.x;
@@ -824,16 +1265,16 @@ void ChessGame::drawSelection() {
         sf::CircleShape dotHighlight(10);
         dotHighlight.setFillColor(sf::Color::Green);
         dotHighlight.setPosition(drawX * 100 + 40, drawY * 100 + 40);
-        window.draw(dotHighlight);
+        target.draw(dotHighlight);
 
         // Draw yellow rectangle highlight for selected piece
         sf::RectangleShape rectHighlight(sf::Vector2f(100, 100));
         rectHighlight.setFillColor(sf::Color(255, 255, 0, 128));
         rectHighlight.setPosition(drawX * 100, drawY * 100);
-        window.draw(rectHighlight);
+        target.draw(rectHighlight);
 
         // Highlight valid moves with circles
-        auto validMoves = getValidMoves(selectedPosition);
+        const auto& validMoves = getLegalMoves(selectedPosition);
         for (const auto& move : validMoves) {
             int moveX = move.x;
             int moveY = rotateBoard ? 7 - move.y : move.y;
@@ -841,7 +1282,7 @@ void ChessGame::drawSelection() {
             sf::CircleShape moveCircle(20);
             moveCircle.setFillColor(sf::Color(0, 255, 0, 128));
             moveCircle.setPosition(moveX * 100 + 30, moveY * 100 + 30);
-            window.draw(moveCircle);
+            target.draw(moveCircle);
         }
     }
 
@@ -854,7 +1295,7 @@ void ChessGame::drawSelection() {
             sf::RectangleShape checkHighlight(sf::Vector2f(100, 100));
             checkHighlight.setPosition(kingPos.x * 100, kingPos.y * 100);
             checkHighlight.setFillColor(sf::Color(255, 0, 0, 128));
-            window.draw(checkHighlight);
+            target.draw(checkHighlight);
         }
     }
 }
@@ -863,9 +1304,12 @@ void ChessGame::run() {
     std::cout << "\n=== SFML Chess Game Started ===\n";
     std::cout << "Navigate the main menu with UP/DOWN arrows and ENTER to select.\n";
     std::cout << "You can also click on menu items with the mouse.\n";
-    std::cout << "If you see rectangles instead of text, that means no font was loaded.\n\n";
+    std::cout << "If you see rectangles instead of text, that means no font was loaded.\n";
+    std::cout << "F3 shows frame timings, F4 writes them to frame-trace.json (chrome://tracing).\n\n";
 
     while (window.isOpen()) {
+        profiler.beginFrame();
+        profiler.begin(FrameSpan::Events);
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed) {
@@ -876,9 +1320,42 @@ void ChessGame::run() {
             }
             else if (event.type == sf::Event::MouseButtonPressed) {
                 if (event.mouseButton.button == sf::Mouse::Left) {
-                    handleMouseClick({ event.mouseButton.x, event.mouseButton.y });
+                    profiler.markInput();
+                    if (menuState == MenuState::InGame && isReviewing() && event.mouseButton.y < ReplayBarHeight) {
+                        handleReplayBar({ event.mouseButton.x, event.mouseButton.y });
+                    }
+                    else {
+                        FrameProfiler::Scope span(profiler, FrameSpan::MouseClick);
+                        handleMouseClick({ event.mouseButton.x, event.mouseButton.y });
+                    }
+                }
+            }
+            else if (event.type == sf::Event::MouseMoved) {
+                if (draggingSlider) {
+                    seekReview(sliderPly(event.mouseMove.x));
                 }
             }
+            else if (event.type == sf::Event::MouseButtonReleased) {
+                draggingSlider = false;
+            }
+        }
+
+        // A slider drag seeks many times per frame; the analysis restarts once
+        if (reviewAnalysisPending) {
+            reviewAnalysisPending = false;
+            restartAnalysis();
+        }
+        profiler.end(FrameSpan::Events);
+
+        if (networkMode) {
+            FrameProfiler::Scope span(profiler, FrameSpan::Network);
+            pollNetwork();
+        }
+
+        // Drain the analysis channel once per frame, however many updates arrived
+        if (analysisEnabled) {
+            FrameProfiler::Scope span(profiler, FrameSpan::AnalysisPoll);
+            analysis->poll();
         }
 
         window.clear();
@@ -887,15 +1364,308 @@ void ChessGame::run() {
             drawMenu();
         }
         else {
-            drawBoard();
-            drawSelection();
-            drawPieces();
+            profiler.begin(FrameSpan::DrawBoard);
+            drawBoard(window);
+            profiler.end(FrameSpan::DrawBoard);
+            profiler.begin(FrameSpan::DrawSelection);
+            drawSelection(window);
+            profiler.end(FrameSpan::DrawSelection);
+            profiler.begin(FrameSpan::DrawPieces);
+            drawPiecesBatched(window);
+            profiler.end(FrameSpan::DrawPieces);
+            if (analysisEnabled) {
+                FrameProfiler::Scope span(profiler, FrameSpan::DrawAnalysis);
+                drawAnalysis(window);
+            }
+            if (isReviewing()) {
+                FrameProfiler::Scope span(profiler, FrameSpan::DrawReplayBar);
+                drawReplayBar(window);
+            }
+        }
+        if (hudEnabled) {
+            FrameProfiler::Scope span(profiler, FrameSpan::DrawHud);
+            drawHud(window);
         }
 
+        profiler.begin(FrameSpan::Display);
         window.display();
+        profiler.end(FrameSpan::Display);
+        profiler.endFrame();
+    }
+}
+
+// Frame timing overlay in the top right corner: percentiles over the last
+// frames, a bar per frame, and the median and p99 of every phase
+void ChessGame::drawHud(sf::RenderTarget& target) {
+    const float left = 500, top = 40, width = 292;
+    static const FrameSpan phases[] = {
+        FrameSpan::Events, FrameSpan::MouseClick, FrameSpan::MovePiece, FrameSpan::GameState,
+        FrameSpan::Network, FrameSpan::AnalysisPoll, FrameSpan::DrawBoard, FrameSpan::DrawSelection,
+        FrameSpan::DrawPieces, FrameSpan::DrawAnalysis, FrameSpan::DrawReplayBar, FrameSpan::DrawHud,
+        FrameSpan::Display
+    };
+    const int phaseCount = sizeof(phases) / sizeof(phases[0]);
+    float height = 110 + phaseCount * 16.0f;
+
+    sf::RectangleShape panel(sf::Vector2f(width, height));
+    panel.setPosition(left, top);
+    panel.setFillColor(sf::Color(0, 0, 0, 200));
+    target.draw(panel);
+
+    // Last 120 frames, 1 px per millisecond, the 60 fps budget as a line
+    sf::RectangleShape bar;
+    bar.setFillColor(sf::Color(120, 200, 120));
+    int frames = std::min(120, profiler.frameCount());
+    for (int i = 0; i < frames; i++) {
+        float ms = std::min(40.0f, float(profiler.frameMs(i)));
+        bar.setSize(sf::Vector2f(2, ms));
+        bar.setFillColor(ms > 16.7f ? sf::Color(230, 90, 70) : sf::Color(120, 200, 120));
+        bar.setPosition(left + width - 6 - i * 2.4f, top + 48 - ms);
+        target.draw(bar);
+    }
+    sf::RectangleShape budget(sf::Vector2f(width - 8, 1));
+    budget.setPosition(left + 4, top + 48 - 16.7f);
+    budget.setFillColor(sf::Color(255, 255, 255, 90));
+    target.draw(budget);
+
+    if (font.getInfo().family.empty()) return;
+    auto format = [](double ms) {
+        char text[16];
+        std::snprintf(text, sizeof(text), "%.2f", ms);
+        return std::string(text);
+    };
+    sf::Text text;
+    text.setFont(font);
+    text.setCharacterSize(13);
+    text.setFillColor(sf::Color::White);
+    auto line = [&](const std::string& content, float y) {
+        text.setString(content);
+        text.setPosition(left + 6, y);
+        target.draw(text);
+    };
+    line("frame p50 " + format(profiler.framePercentile(0.5)) + "  p99 " + format(profiler.framePercentile(0.99)) + " ms", top + 54);
+    line("click-to-photon p50 " + format(profiler.latencyPercentile(0.5)) + "  p99 " + format(profiler.latencyPercentile(0.99))
+         + " ms (" + std::to_string(profiler.latencyCount()) + ")", top + 72);
+    line("phase                     p50       p99", top + 92);
+    for (int i = 0; i < phaseCount; i++) {
+        std::string name = frameSpanName(phases[i]);
+        name.resize(22, ' ');
+        line(name + format(profiler.spanPercentile(phases[i], 0.5)) + "    " + format(profiler.spanPercentile(phases[i], 0.99)),
+             top + 108 + i * 16.0f);
+    }
+}
+
+// Eval bar along the left edge, best-move arrow on the board and the top
+// lines in a translucent panel along the bottom
+void ChessGame::drawAnalysis(sf::RenderTarget& target) {
+    int lines = analysis->shownLines();
+    if (lines == 0) return;
+    const AnalysisLine& best = analysis->line(0);
+
+    // White's share of the bar is the expected score of the evaluation
+    double whiteShare = best.score >= MateInMaxPly ? 1.0
+                      : best.score <= -MateInMaxPly ? 0.0
+                      : 1.0 / (1.0 + std::pow(10.0, -best.score / 400.0));
+    float whiteHeight = float(800 * whiteShare);
+    sf::RectangleShape bar(sf::Vector2f(14, 800));
+    bar.setPosition(0, 0);
+    bar.setFillColor(sf::Color(40, 40, 40));
+    target.draw(bar);
+    sf::RectangleShape whiteBar(sf::Vector2f(14, whiteHeight));
+    // White's back rank is drawn at the bottom when the board is rotated
+    whiteBar.setPosition(0, rotateBoard ? 800 - whiteHeight : 0);
+    whiteBar.setFillColor(sf::Color(235, 235, 235));
+    target.draw(whiteBar);
+
+    if (best.pvLength > 0) {
+        int from = moveFrom(best.pv[0]);
+        int to = moveTo(best.pv[0]);
+        sf::Vector2f start(squareCol(from) * 100 + 50.0f, (rotateBoard ? 7 - squareRow(from) : squareRow(from)) * 100 + 50.0f);
+        sf::Vector2f end(squareCol(to) * 100 + 50.0f, (rotateBoard ? 7 - squareRow(to) : squareRow(to)) * 100 + 50.0f);
+        float dx = end.x - start.x;
+        float dy = end.y - start.y;
+        float length = std::sqrt(dx * dx + dy * dy);
+        float angle = std::atan2(dy, dx) * 180.0f / 3.14159265f;
+        sf::Color arrowColor(30, 144, 255, 170);
+
+        sf::RectangleShape shaft(sf::Vector2f(length - 30.0f, 14.0f));
+        shaft.setOrigin(0, 7);
+        shaft.setPosition(start.x, start.y);
+        shaft.setRotation(angle);
+        shaft.setFillColor(arrowColor);
+        target.draw(shaft);
+
+        sf::ConvexShape head(3);
+        head.setPoint(0, sf::Vector2f(0, -20));
+        head.setPoint(1, sf::Vector2f(30, 0));
+        head.setPoint(2, sf::Vector2f(0, 20));
+        head.setPosition(end.x - dx / length * 30.0f, end.y - dy / length * 30.0f);
+        head.setRotation(angle);
+        head.setFillColor(arrowColor);
+        target.draw(head);
+    }
+
+    if (font.getInfo().family.empty()) return;
+    float height = 12.0f + lines * 26.0f;
+    sf::RectangleShape panel(sf::Vector2f(786, height));
+    panel.setPosition(14, 800 - height);
+    panel.setFillColor(sf::Color(0, 0, 0, 170));
+    target.draw(panel);
+
+    sf::Text text;
+    text.setFont(font);
+    text.setCharacterSize(18);
+    text.setFillColor(sf::Color::White);
+    for (int i = 0; i < lines; i++) {
+        text.setString(std::to_string(i + 1) + ". " + analysis->lineText(i));
+        text.setPosition(22, 800 - height + 6 + i * 26.0f);
+        target.draw(text);
+    }
+}
+
+// Sprite sheet cell of a piece: R N B Q K P from left to right, Black on the top row
+sf::IntRect ChessGame::pieceTextureRect(PieceType type, Color color) const {
+    sf::Vector2u textureSize = piecesTexture.getSize();
+    int pieceWidth = textureSize.x / 6;
+    int pieceHeight = textureSize.y / 2;
+    int column = 0;
+    switch (type) {
+    case PieceType::Rook:    column = 0; break;
+    case PieceType::Knight:  column = 1; break;
+    case PieceType::Bishop:  column = 2; break;
+    case PieceType::Queen:   column = 3; break;
+    case PieceType::King:    column = 4; break;
+    case PieceType::Pawn:    column = 5; break;
+    default: break;
+    }
+    return sf::IntRect(column * pieceWidth, color == Color::Black ? 0 : pieceHeight, pieceWidth, pieceHeight);
+}
+
+// Shows the position after `ply` moves; the last ply returns to the live game.
+// Only the rules core is touched: no sounds, console output or move log.
+void ChessGame::seekReview(int ply) {
+    if (menuState != MenuState::InGame) return;
+    ply = std::max(0, std::min(ply, replay.length()));
+    if (ply == shownPly()) return;
+
+    isPieceSelected = false;
+    if (ply == replay.length()) {
+        reviewPly = -1;
+        draggingSlider = false;
+    }
+    else {
+        replay.seek(ply, reviewPosition);
+        reviewPly = ply;
+    }
+    reviewAnalysisPending = true;
+}
+
+void ChessGame::handleReplayBar(sf::Vector2i mousePos) {
+    if (mousePos.x < 164) {
+        switch ((mousePos.x - 4) / 40) {
+        case 0: seekReview(0); break;
+        case 1: seekReview(reviewPly - 1); break;
+        case 2: seekReview(reviewPly + 1); break;
+        default: seekReview(replay.length()); break;
+        }
+    }
+    else if (mousePos.x < SliderLeft + SliderWidth + 12) {
+        draggingSlider = true;
+        seekReview(sliderPly(mousePos.x));
     }
 }
 
+int ChessGame::sliderPly(int x) const {
+    double fraction = std::max(0.0, std::min(1.0, double(x - SliderLeft) / SliderWidth));
+    return int(fraction * replay.length() + 0.5);
+}
+
+void ChessGame::drawReplayBar(sf::RenderTarget& target) {
+    sf::RectangleShape bar(sf::Vector2f(800, ReplayBarHeight));
+    bar.setFillColor(sf::Color(0, 0, 0, 190));
+    target.draw(bar);
+
+    // First, previous, next, last
+    static const char* labels[4] = { "|<", "<", ">", ">|" };
+    sf::RectangleShape button(sf::Vector2f(36, 24));
+    button.setFillColor(sf::Color(70, 70, 70));
+    sf::Text text;
+    text.setFont(font);
+    text.setCharacterSize(16);
+    text.setFillColor(sf::Color::White);
+    bool hasFont = !font.getInfo().family.empty();
+    for (int i = 0; i < 4; i++) {
+        button.setPosition(4 + i * 40.0f, 4);
+        target.draw(button);
+        if (hasFont) {
+            text.setString(labels[i]);
+            text.setPosition(4 + i * 40.0f + 10, 6);
+            target.draw(text);
+        }
+    }
+
+    sf::RectangleShape track(sf::Vector2f(SliderWidth, 4));
+    track.setPosition(SliderLeft, 14);
+    track.setFillColor(sf::Color(150, 150, 150));
+    target.draw(track);
+    float knobX = SliderLeft + SliderWidth * float(reviewPly) / std::max(1, replay.length());
+    sf::CircleShape knob(8);
+    knob.setOrigin(8, 8);
+    knob.setPosition(knobX, 16);
+    knob.setFillColor(sf::Color(30, 144, 255));
+    target.draw(knob);
+
+    if (hasFont) {
+        text.setString("ply " + std::to_string(reviewPly) + "/" + std::to_string(replay.length()));
+        text.setPosition(SliderLeft + SliderWidth + 14.0f, 6);
+        target.draw(text);
+    }
+}
+
+bool ChessGame::loadArchive(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    archive.clear();
+    PgnGame game;
+    while (readPgnGame(file, game)) {
+        archive.push_back(game);
+    }
+    if (archive.empty()) {
+        std::cerr << "No games in " << path << std::endl;
+        return false;
+    }
+    std::cout << "Loaded " << archive.size() << " games from " << path << ", N / P for the next / previous game" << std::endl;
+    openArchiveGame(0);
+    return true;
+}
+
+// The game's final position becomes the live game (moves can continue from
+// there) and the review starts from its first position
+void ChessGame::openArchiveGame(int index) {
+    int count = (int)archive.size();
+    archiveIndex = (index % count + count) % count;
+    const PgnGame& game = archive[archiveIndex];
+
+    Position start;
+    if (!start.setFromFen(game.fen)) start.setStartPosition();
+    clearGameState();
+    replay.reset(start);
+    for (PackedMove move : game.moves) {
+        replay.push(move);
+    }
+    replay.seek(replay.length(), position);
+    syncBoardFromPosition();
+    updateGameState();
+    menuState = MenuState::InGame;
+
+    std::cout << "Game " << archiveIndex + 1 << "/" << count << ": " << game.tag("White") << " - " << game.tag("Black")
+              << " " << game.result << ", " << game.moves.size() << " plies" << std::endl;
+    seekReview(0);
+}
+
 bool ChessGame::isInBounds(sf::Vector2i pos) const {
     return pos.x >= 0 && pos.x < 8 && pos.y >= 0 && pos.y < 8;
 }
@@ -905,10 +1675,17 @@ Color ChessGame::oppositeColor(Color color) const {
 }
 
 
+// The analysis follows the shown position; online games are never analysed
+void ChessGame::restartAnalysis() {
+    if (!analysisEnabled || networkMode || menuState != MenuState::InGame) return;
+    analysis->start(isReviewing() ? reviewPosition : position);
+}
+
 //rotate board every move
 void ChessGame::switchTurn() {
     currentTurn = (currentTurn == Color::White) ? Color::Black : Color::White;
     rotateBoard = !rotateBoard;
+    invalidateLegalMoves();
 }
 
 //moveLog
@@ -930,6 +1707,14 @@ void ChessGame::logMove(char piece, sf::Vector2i from, sf::Vector2i to, bool isC
         moveNumber++;
     }
 
+    saveMoveLog();
+
+    // Switch turns
+    whiteToMove = !whiteToMove;
+}
+
+void ChessGame::saveMoveLog()
+{
     // Save to file (overwrite full log each time to keep formatting)
     std::ofstream logFile("moves.txt");
     if (logFile.is_open()) {
@@ -938,9 +1723,6 @@ void ChessGame::logMove(char piece, sf::Vector2i from, sf::Vector2i to, bool isC
         }
         logFile.close();
     }
-
-    // Switch turns
-    whiteToMove = !whiteToMove;
 }
 std::string ChessGame::squareToNotation(sf::Vector2i pos)
 {
@@ -985,3 +1767,121 @@ void ChessGame::savePGN()
     file.close();
 }
 
+int ChessGame::setTablebasePath(const std::string& directory)
+{
+    tablebases.clear();
+    int count = tablebases.load(directory);
+    std::cout << "Tablebases: " << count << " tables from " << directory << std::endl;
+    return count;
+}
+
+//network mode
+void ChessGame::setServer(const std::string& host, unsigned short port, uint32_t gameId)
+{
+    serverHost = host;
+    serverPort = port;
+    networkGameId = gameId;
+}
+
+void ChessGame::startNetworkGame()
+{
+    if (!network.connect(serverHost, serverPort)) {
+        std::cout << "Online mode unavailable: start the server first (server --port " << serverPort << ").\n";
+        return;
+    }
+    menuState = MenuState::InGame;
+    resetGame();
+    networkMode = true;
+    networkGameOver = false;
+    networkColor = -1;
+    network.send(Frame(MessageType::Join).u32(networkGameId));
+    std::cout << "Joining game " << networkGameId << " on " << serverHost << ":" << serverPort << "..." << std::endl;
+    std::cout << "Press Q to resign, C to show the clocks." << std::endl;
+}
+
+void ChessGame::stopNetworkGame()
+{
+    if (!networkMode) return;
+    network.disconnect();
+    networkMode = false;
+    networkColor = -1;
+}
+
+void ChessGame::pollNetwork()
+{
+    std::vector<uint8_t> frame;
+    while (network.poll(frame)) {
+        handleNetworkFrame(frame);
+    }
+    if (!network.isConnected() && !networkGameOver) {
+        networkGameOver = true;
+        std::cout << "Connection to server lost." << std::endl;
+    }
+}
+
+void ChessGame::handleNetworkFrame(const std::vector<uint8_t>& frame)
+{
+    const uint8_t* payload = frame.data() + FrameHeaderSize;
+    size_t length = frame.size() - FrameHeaderSize;
+    // Shortest payload of every message read below; shorter frames are dropped
+    size_t needed = 0;
+    switch (MessageType(frame[0])) {
+    case MessageType::Joined:   needed = 5; break;
+    case MessageType::Start:    needed = 12; break;
+    case MessageType::MoveMade: needed = 2; break;
+    case MessageType::Clock:    needed = 8; break;
+    case MessageType::GameOver: needed = 2; break;
+    case MessageType::Error:    needed = 1; break;
+    default: break;
+    }
+    if (length < needed) {
+        std::cerr << "Malformed frame of type " << int(frame[0]) << " from the server" << std::endl;
+        return;
+    }
+
+    switch (MessageType(frame[0])) {
+    case MessageType::Joined:
+        networkColor = payload[4];
+        std::cout << "Joined game " << getU32(payload) << " as " << (networkColor == 0 ? "White" : "Black") << std::endl;
+        // Show the board from our side
+        rotateBoard = (networkColor == 1);
+        break;
+    case MessageType::Start:
+        std::cout << "Game started: " << getU32(payload) / 1000 << "s + " << getU32(payload + 8) / 1000 << "s" << std::endl;
+        break;
+    case MessageType::MoveMade: {
+        PackedMove move = getU16(payload);
+        MoveList legal;
+        position.generateLegal(legal);
+        if (std::find(legal.begin(), legal.end(), move) == legal.end()) {
+            std::cerr << "Server sent a move that is not legal here" << std::endl;
+            break;
+        }
+        int from = moveFrom(move);
+        int to = moveTo(move);
+        isPieceSelected = false;
+        // The exact move, so an underpromotion stays one
+        playMove({ squareCol(from), squareRow(from) }, { squareCol(to), squareRow(to) }, move);
+        rotateBoard = (networkColor == 1);
+        break;
+    }
+    case MessageType::Clock:
+        std::cout << "Clock - White: " << getU32(payload) / 1000.0 << "s, Black: " << getU32(payload + 4) / 1000.0 << "s" << std::endl;
+        break;
+    case MessageType::GameOver: {
+        networkGameOver = true;
+        const char* reasons[] = { "checkmate", "draw", "resignation", "timeout", "abandonment" };
+        uint8_t winner = payload[0];
+        uint8_t reason = payload[1];
+        std::cout << "\n*** GAME OVER: "
+                  << (winner == 2 ? "Draw" : winner == 0 ? "White wins" : "Black wins")
+                  << " by " << (reason < 5 ? reasons[reason] : "unknown") << " ***\n";
+        break;
+    }
+    case MessageType::Error:
+        std::cout << "Server error code " << int(payload[0]) << std::endl;
+        break;
+    default:
+        break;
+    }
+}
@@ -5,18 +5,15 @@
 #include <Windows.h>
 #include <string>
 #include <fstream>
-
-enum class PieceType {
-    None, King, Queen, Rook, Bishop, Knight, Pawn
-};
-
-enum class Color {
-    White, Black
-};
-
-enum class GameState {
-    Playing, Check, Checkmate, Stalemate
-};
+#include <memory>
+#include "Types.h"
+#include "Position.h"
+#include "NetworkClient.h"
+#include "Analysis.h"
+#include "GameReplay.h"
+#include "FrameProfiler.h"
+#include "Pgn.h"
+#include "Tablebase.h"
 
 enum class MenuState {
     MainMenu, InGame
@@ -50,17 +47,37 @@ struct Piece {
     }
 };
 
+// Everything a takeback needs that the move itself does not record
+struct UndoRecord {
+    Piece movedPiece;                 // before the move (unpromoted, original hasMoved)
+    Piece capturedPiece;              // type None if nothing was captured
+    sf::Vector2i capturedAt;          // differs from move.to for en passant
+    PackedMove coreMove = NullMove;
+    sf::Vector2i lastMoveFrom;
+    sf::Vector2i lastMoveTo;
+    PieceType lastMovePieceType = PieceType::None;
+    GameState gameState = GameState::Playing;
+    bool rotateBoard = true;
+    int moveNumber = 1;
+    bool whiteToMove = true;
+    std::string moveLogLine;          // last moveLog line before a Black move was appended
+};
+
 class ChessGame {
 private:
     sf::RenderWindow window;
     std::vector<std::vector<Piece>> board;
     sf::Texture piecesTexture;
+    sf::VertexArray pieceVertices;    // reused every frame by drawPiecesBatched
     sf::Font font;
     bool isPieceSelected = false;
     sf::Vector2i selectedPosition;
     Color currentTurn = Color::White;
     GameState gameState = GameState::Playing;
     MenuState menuState = MenuState::MainMenu;
+
+    // Rules core mirror of the board (Zobrist history, halfmove clock, material counts)
+    Position position;
     
     //
     sf::Vector2i lastMoveFrom = { -1, -1 };
@@ -89,34 +106,108 @@ private:
     bool blackRookQueensideMoved = false;
 
     
+    // Legal moves of the side to move, indexed [row][col]
+    mutable std::vector<sf::Vector2i> legalMoveCache[8][8];
+    mutable bool legalMovesValid = false;
+    mutable bool anyLegalMove = false;
+
     //rotate board
     bool rotateBoard = true;
     // Menu variables
     int selectedMenuItem = 0;
-    std::vector<std::string> menuItems = { "Single Player", "Multiplayer", "Quit" };
+    std::vector<std::string> menuItems = { "Single Player", "Multiplayer", "Online", "Quit" };
+
+    // Network mode: the server is authoritative, local moves wait for its echo
+    NetworkClient network;
+    bool networkMode = false;
+    bool networkGameOver = false;
+    int networkColor = -1;
+    std::string serverHost = "127.0.0.1";
+    unsigned short serverPort = 5555;
+    uint32_t networkGameId = 1;
+
+    // Local analysis panel: background multi-PV search of the current position,
+    // created the first time the panel is opened
+    std::unique_ptr<Analysis> analysis;
+    bool analysisEnabled = false;
+
+    // Endgame tables from setTablebasePath: exact results in updateGameState
+    // and for the analysis search
+    Tablebases tablebases;
+
+    // Every move of the current game, so any ply can be shown at once. While
+    // reviewing, the board shows reviewPosition and the live game is left as it is.
+    GameReplay replay;
+    Position reviewPosition;
+    int reviewPly = -1;                // -1 when the live game is shown
+    bool draggingSlider = false;
+    bool reviewAnalysisPending = false;
+
+    // Frame phase timings and click-to-photon latency, always recorded;
+    // F3 shows them, F4 writes frame-trace.json
+    FrameProfiler profiler;
+    bool hudEnabled = false;
+
+    // Games loaded with loadArchive, stepped through with N / P
+    std::vector<PgnGame> archive;
+    int archiveIndex = 0;
 
 public:
     ChessGame();
+    // Without a window the game can still be driven and rendered into any render target
+    explicit ChessGame(bool openWindow);
     void run();
+    void setServer(const std::string& host, unsigned short port, uint32_t gameId);
+    bool loadFen(const std::string& fen);
+    // Opens the first game of a PGN file for review
+    bool loadArchive(const std::string& path);
+    // Maps the tables made by tbgen; returns how many were found
+    int setTablebasePath(const std::string& directory);
 
 private:
+    friend class ChessGameBench;
+
     void initializeBoard();
     void loadSounds();
-    void loadTextures();
-    void drawBoard();
-    void drawPieces();
-    void drawSelection();
+    void loadTextures();                // once, from disk
+    void slicePieceSprites();
+    void drawBoard(sf::RenderTarget& target);
+    void drawPieces(sf::RenderTarget& target);
+    void drawPiecesBatched(sf::RenderTarget& target);
+    void drawSelection(sf::RenderTarget& target);
+    void drawAnalysis(sf::RenderTarget& target);
+    void drawHud(sf::RenderTarget& target);
     void drawMenu();
+    void clearGameState();
     void resetGame();
     void handleMouseClick(sf::Vector2i mousePos);
     void handleMenuClick(sf::Vector2i mousePos);
     void handleKeyPress(sf::Keyboard::Key key);
+    void startNetworkGame();
+    void stopNetworkGame();
+    void pollNetwork();
+    void handleNetworkFrame(const std::vector<uint8_t>& frame);
     void switchTurn();
+    void restartAnalysis();
+    void syncBoardFromPosition();
+    sf::IntRect pieceTextureRect(PieceType type, Color color) const;
+
+    // Review: first / prev / next / last and the ply slider
+    bool isReviewing() const { return reviewPly >= 0; }
+    int shownPly() const { return isReviewing() ? reviewPly : replay.length(); }
+    void seekReview(int ply);
+    void handleReplayBar(sf::Vector2i mousePos);
+    int sliderPly(int x) const;
+    void drawReplayBar(sf::RenderTarget& target);
+    void openArchiveGame(int index);
     char pieceTypeToChar(PieceType type);
 
     //movelog
     std::vector<Move> moveHistory;
+    std::vector<UndoRecord> undoHistory;
+    std::vector<Move> redoMoves;
     void logMove(char piece, sf::Vector2i from, sf::Vector2i to, bool isCapture);
+    void saveMoveLog();
     std::string squareToNotation(sf::Vector2i pos);
     std::string createMoveNotation(char piece, sf::Vector2i from, sf::Vector2i to, bool isCapture);
     void savePGN();
@@ -146,11 +237,23 @@ private:
     // Game state
     std::vector<sf::Vector2i> getValidMoves(sf::Vector2i position) const;
     std::vector<sf::Vector2i> getAllValidMoves(Color color) const;
+
+    // Legal move cache (computed once per position, shared by highlighting, clicks and mate detection)
+    const std::vector<sf::Vector2i>& getLegalMoves(sf::Vector2i position) const;
+    bool isLegalMove(sf::Vector2i from, sf::Vector2i to) const;
+    bool hasAnyLegalMove() const;
+    void buildLegalMoveCache() const;
+    void invalidateLegalMoves();
     void updateGameState();
     bool wouldBeInCheck(sf::Vector2i from, sf::Vector2i to, Color color) const;
 
     // Move execution
-    void movePiece(sf::Vector2i from, sf::Vector2i to);
+    // `exact` is the rules-core move when it is already known (network
+    // moves, which may underpromote); otherwise it is looked up from the squares
+    void movePiece(sf::Vector2i from, sf::Vector2i to, PackedMove exact = NullMove);
+    void playMove(sf::Vector2i from, sf::Vector2i to, PackedMove exact = NullMove);
+    void takeBack();
+    void redoMove();
     
 
     // Utility
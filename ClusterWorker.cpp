@@ -0,0 +1,218 @@
+#include "ClusterWorker.h"
+#include "Position.h"
+#include "Protocol.h"
+#include "Search.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct PendingJob {
+    uint32_t id = 0;
+    int depth = 0;
+    uint32_t nodes = 0;
+    std::string fen;
+};
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connectOnce(const std::string& endpoint) {
+    if (endpoint.compare(0, 5, "unix:") == 0) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, endpoint.c_str() + 5, sizeof(addr.sun_path) - 1);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos) return -1;
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(endpoint.substr(0, colon).c_str(), endpoint.substr(colon + 1).c_str(), &hints, &found) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* entry = found; entry && fd == -1; entry = entry->ai_next) {
+        fd = socket(entry->ai_family, entry->ai_socktype | SOCK_CLOEXEC, entry->ai_protocol);
+        if (fd != -1 && connect(fd, entry->ai_addr, entry->ai_addrlen) == -1) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    if (fd != -1) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+// Frames are tiny and the socket blocking, so a send either completes or the
+// coordinator is gone
+static bool sendFrame(int fd, const Frame& frame) {
+    size_t offset = 0;
+    while (offset < frame.size) {
+        ssize_t sent = ::send(fd, frame.data + offset, frame.size - offset, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        offset += sent;
+    }
+    return true;
+}
+
+int runClusterWorker(const ClusterWorkerConfig& config) {
+    // The coordinator may still be starting up
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && fd == -1; attempt++) {
+        fd = connectOnce(config.endpoint);
+        if (fd == -1) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (fd == -1) {
+        std::cerr << "Cannot connect to " << config.endpoint << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    Search search;
+    search.setHashSize(config.hashMb);
+    search.setThreads(config.threads);
+    search.setCollectStats(!config.statsJsonPath.empty() || !config.prometheusPath.empty());
+    SearchStats stats;
+
+    std::mutex resultMutex;
+    SearchInfo lastInfo;
+    PackedMove bestMove = NullMove;
+    std::atomic<bool> searchDone{ false };
+    search.onInfo = [&](const SearchInfo& info) {
+        if (info.multiPv != 1) return;
+        std::lock_guard<std::mutex> lock(resultMutex);
+        lastInfo = info;
+    };
+    search.onBestMove = [&](PackedMove best, PackedMove) {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        bestMove = best;
+        searchDone = true;
+    };
+
+    if (!sendFrame(fd, Frame(MessageType::WorkerHello).u8(uint8_t(std::max(1, std::min(config.slots, 255))))
+                           .u8(uint8_t(std::min(config.threads, 255))).u32(uint32_t(getpid())))) {
+        close(fd);
+        return 1;
+    }
+
+    std::deque<PendingJob> pending;
+    std::vector<uint8_t> in;
+    bool searching = false;
+    bool finished = false;
+    uint32_t currentId = 0;
+    int completed = 0;
+    int64_t lastSendMs = nowMs();
+
+    while (!finished) {
+        if (searching && searchDone) {
+            search.wait();
+            searching = false;
+            searchDone = false;
+            if (search.collectingStats()) {
+                stats.add(search.statistics());
+                if (!config.prometheusPath.empty() && !saveStatsPrometheus(config.prometheusPath, stats)) {
+                    std::cerr << "Cannot write " << config.prometheusPath << std::endl;
+                }
+            }
+            Frame result(MessageType::JobResult);
+            {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                result.u32(currentId).u16(bestMove).u32(uint32_t(lastInfo.score)).u8(uint8_t(lastInfo.depth))
+                      .u32(uint32_t(std::min<uint64_t>(lastInfo.nodes, 0xFFFFFFFFu))).u32(uint32_t(lastInfo.timeMs));
+                for (size_t i = 0; i < lastInfo.pv.size() && result.room() >= 2; i++) result.u16(lastInfo.pv[i]);
+            }
+            if (++completed == config.crashAfter) _exit(3);
+            if (!sendFrame(fd, result)) break;
+            lastSendMs = nowMs();
+        }
+        if (!searching && !pending.empty()) {
+            PendingJob job = pending.front();
+            pending.pop_front();
+            Position pos;
+            if (!pos.setFromFen(job.fen)) {
+                if (!sendFrame(fd, Frame(MessageType::JobError).u32(job.id))) break;
+                lastSendMs = nowMs();
+                continue;
+            }
+            SearchLimits limits;
+            limits.depth = job.depth;
+            limits.nodes = job.nodes;
+            {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                lastInfo = SearchInfo();
+                bestMove = NullMove;
+            }
+            // The table is kept: consecutive jobs are usually consecutive plies of one game
+            search.start(pos, limits);
+            searching = true;
+            currentId = job.id;
+        }
+        if (nowMs() - lastSendMs >= 500) {
+            if (!sendFrame(fd, Frame(MessageType::Heartbeat))) break;
+            lastSendMs = nowMs();
+        }
+
+        pollfd readable = { fd, POLLIN, 0 };
+        if (poll(&readable, 1, 20) <= 0) continue;
+        uint8_t buffer[4096];
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) continue;
+            break;
+        }
+        in.insert(in.end(), buffer, buffer + received);
+        size_t offset = 0;
+        while (size_t frameSize = completeFrameSize(in.data() + offset, in.size() - offset)) {
+            const uint8_t* frame = in.data() + offset;
+            const uint8_t* payload = frame + FrameHeaderSize;
+            size_t length = frameSize - FrameHeaderSize;
+            if (MessageType(frame[0]) == MessageType::Job && length > 9) {
+                PendingJob job;
+                job.id = getU32(payload);
+                job.depth = payload[4];
+                job.nodes = getU32(payload + 5);
+                job.fen.assign((const char*)payload + 9, length - 9);
+                pending.push_back(job);
+            }
+            else if (MessageType(frame[0]) == MessageType::NoMoreJobs) {
+                finished = true;
+            }
+            offset += frameSize;
+        }
+        in.erase(in.begin(), in.begin() + offset);
+    }
+
+    if (searching) {
+        search.stop();
+        search.wait();
+    }
+    close(fd);
+    if (!config.statsJsonPath.empty()) {
+        std::ofstream file(config.statsJsonPath);
+        writeStatsJson(file, stats);
+    }
+    return 0;
+}
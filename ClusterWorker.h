@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Worker side of the distributed analysis: connects to a coordinator, runs
+// the leased jobs one at a time on its own Search and reports each result.
+// A heartbeat keeps the leases alive while a long search is running.
+struct ClusterWorkerConfig {
+    std::string endpoint;          // "host:port" or "unix:PATH"
+    int threads = 1;
+    int hashMb = 64;
+    int slots = 2;                 // jobs held at once: one searching, the rest waiting
+    int crashAfter = 0;            // exit without a word after this many results (tests retries)
+    std::string statsJsonPath;     // search statistics over all jobs, written on exit
+    std::string prometheusPath;    // rewritten after every job
+};
+
+// Returns the process exit code
+int runClusterWorker(const ClusterWorkerConfig& config);
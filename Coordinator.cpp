@@ -0,0 +1,536 @@
+#include "Coordinator.h"
+#include "Pgn.h"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const int MaxRestarts = 3;     // per local worker slot
+
+Coordinator::Coordinator(const CoordinatorConfig& config) : config(config) {
+}
+
+Coordinator::~Coordinator() {
+    for (auto& worker : workers) {
+        if (worker->fd != -1) close(worker->fd);
+    }
+    if (listenFd != -1) close(listenFd);
+    if (!config.unixPath.empty()) unlink(config.unixPath.c_str());
+}
+
+int64_t Coordinator::nowMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Transpositions inside a game and across games become a single job
+void Coordinator::addJob(const Position& pos) {
+    MoveList moves;
+    pos.generateLegal(moves);
+    if (moves.empty()) return;
+    auto inserted = jobByKey.emplace(pos.key(), uint32_t(jobs.size()));
+    if (!inserted.second) {
+        duplicatePositions++;
+        return;
+    }
+    AnalysisJob job;
+    job.key = pos.key();
+    job.fen = pos.toFen();
+    jobs.push_back(job);
+}
+
+bool Coordinator::load() {
+    std::ifstream file(config.inputPath);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << config.inputPath << std::endl;
+        return false;
+    }
+    const std::string& path = config.inputPath;
+    bool pgn = path.size() >= 4 && path.compare(path.size() - 4, 4, ".pgn") == 0;
+    if (pgn) {
+        PgnGame game;
+        while (readPgnGame(file, game)) {
+            Position pos;
+            if (!pos.setFromFen(game.fen)) continue;
+            for (size_t ply = 0; ply <= game.moves.size(); ply++) {
+                int counted = int(ply) - config.skipPlies;
+                if (counted >= 0 && counted % std::max(1, config.everyPly) == 0) addJob(pos);
+                if (ply < game.moves.size()) pos.makeMove(game.moves[ply]);
+            }
+        }
+    }
+    else {
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream in(line);
+            std::string fields[4];
+            if (!(in >> fields[0] >> fields[1] >> fields[2] >> fields[3])) continue;
+            Position pos;
+            if (pos.setFromFen(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1")) addJob(pos);
+        }
+    }
+
+    readProgressLog();
+    for (uint32_t id = 0; id < jobs.size(); id++) {
+        if (jobs[id].state == JobState::Queued) queue.push_back(id);
+    }
+    progressLog.open(config.logPath, std::ios::app);
+    if (!progressLog.is_open()) {
+        std::cerr << "Cannot open " << config.logPath << std::endl;
+        return false;
+    }
+    // Terminate a line cut short by a crash so the next one does not extend it
+    std::ifstream tail(config.logPath, std::ios::binary | std::ios::ate);
+    if (tail.tellg() > 0) {
+        tail.seekg(-1, std::ios::end);
+        if (tail.get() != '\n') progressLog << std::endl;
+    }
+    std::cout << "Loaded " << jobs.size() << " positions (" << duplicatePositions << " duplicates merged), "
+              << resumedJobs << " already in " << config.logPath << std::endl;
+    return true;
+}
+
+// Every finished line names the key first and ends with "; fen". A line cut
+// short by a crash has no fen and is ignored, so that position is redone.
+void Coordinator::readProgressLog() {
+    std::ifstream log(config.logPath);
+    std::string line;
+    while (std::getline(log, line)) {
+        if (line.find(" ; ") == std::string::npos) continue;
+        std::istringstream in(line);
+        std::string keyText, status;
+        if (!(in >> keyText >> status) || status != "done") continue;
+        auto found = jobByKey.find(std::strtoull(keyText.c_str(), nullptr, 16));
+        if (found == jobByKey.end()) continue;
+        AnalysisJob& job = jobs[found->second];
+        if (job.state == JobState::Done) continue;
+        job.state = JobState::Done;
+        doneJobs++;
+        resumedJobs++;
+    }
+}
+
+bool Coordinator::start() {
+    if (!config.unixPath.empty()) {
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, config.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(config.unixPath.c_str());
+        if (listenFd == -1 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            std::cerr << "Failed to bind " << config.unixPath << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    else {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(uint16_t(config.port));
+        if (listenFd == -1 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            std::cerr << "Failed to bind port " << config.port << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    if (listen(listenFd, 256) == -1) {
+        std::cerr << "listen failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    startTime = std::chrono::steady_clock::now();
+    if (!config.workerStatsDir.empty()) mkdir(config.workerStatsDir.c_str(), 0755);
+    // Nothing left to do after resuming a complete log: no workers to start
+    int localWorkers = finished() ? 0 : config.localWorkers;
+    children.assign(localWorkers, -1);
+    restarts.assign(localWorkers, 0);
+    for (int i = 0; i < localWorkers; i++) {
+        if (!spawnWorker(i)) return false;
+    }
+    running = true;
+    return true;
+}
+
+// Local workers are this executable in worker mode, so a crashing search
+// takes down one process and its leases, not the coordinator
+bool Coordinator::spawnWorker(int index) {
+    std::string endpoint = config.unixPath.empty() ? "127.0.0.1:" + std::to_string(config.port) : "unix:" + config.unixPath;
+    std::vector<std::string> args = { "analyze", "--worker", endpoint,
+                                      "--threads", std::to_string(config.workerThreads),
+                                      "--hash", std::to_string(config.workerHashMb) };
+    if (!config.workerStatsDir.empty()) {
+        std::string base = config.workerStatsDir + "/worker" + std::to_string(index);
+        args.insert(args.end(), { "--stats-json", base + ".json", "--prometheus", base + ".prom" });
+    }
+    if (index == 0 && restarts[index] == 0 && config.crashAfter > 0) {
+        args.push_back("--crash-after");
+        args.push_back(std::to_string(config.crashAfter));
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        std::cerr << "fork failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (pid == 0) {
+        std::vector<char*> argv;
+        for (std::string& arg : args) argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        execv("/proc/self/exe", argv.data());
+        _exit(127);
+    }
+    children[index] = pid;
+    return true;
+}
+
+// A local worker that died is started again, a few times per slot; its
+// connection drops on its own and the leases go back to the queue
+void Coordinator::reapWorkers() {
+    for (int i = 0; i < int(children.size()); i++) {
+        int status = 0;
+        if (children[i] == -1 || waitpid(children[i], &status, WNOHANG) != children[i]) continue;
+        std::cout << "Local worker " << i << " (pid " << children[i] << ") "
+                  << (WIFSIGNALED(status) ? "killed by signal " + std::to_string(WTERMSIG(status))
+                                          : "exited with status " + std::to_string(WEXITSTATUS(status)));
+        children[i] = -1;
+        if (restarts[i] >= MaxRestarts) {
+            std::cout << ", not restarted after " << restarts[i] << " restarts" << std::endl;
+            continue;
+        }
+        restarts[i]++;
+        std::cout << ", restarting" << std::endl;
+        spawnWorker(i);
+    }
+}
+
+void Coordinator::acceptWorkers() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) break;
+        if (config.unixPath.empty()) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        auto worker = std::make_unique<WorkerLink>();
+        worker->id = int(workers.size());
+        worker->fd = fd;
+        worker->connectedMs = nowMs();
+        worker->leaseUntilMs = nowMs() + config.leaseMs;
+        workers.push_back(std::move(worker));
+    }
+}
+
+void Coordinator::onReadable(WorkerLink& worker) {
+    uint8_t buffer[16384];
+    ssize_t received = recv(worker.fd, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+        worker.in.insert(worker.in.end(), buffer, buffer + received);
+        size_t offset = 0;
+        while (worker.fd != -1) {
+            size_t frameSize = completeFrameSize(worker.in.data() + offset, worker.in.size() - offset);
+            if (frameSize == 0) break;
+            if (!handleFrame(worker, worker.in.data() + offset, frameSize)) {
+                dropWorker(worker);
+                return;
+            }
+            offset += frameSize;
+        }
+        worker.in.erase(worker.in.begin(), worker.in.begin() + offset);
+    }
+    else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        dropWorker(worker);
+    }
+}
+
+bool Coordinator::handleFrame(WorkerLink& worker, const uint8_t* frame, size_t size) {
+    const uint8_t* payload = frame + FrameHeaderSize;
+    size_t length = size - FrameHeaderSize;
+
+    // Anything from the worker proves it is alive
+    worker.leaseUntilMs = nowMs() + config.leaseMs;
+    worker.stalled = false;
+
+    switch (MessageType(frame[0])) {
+    case MessageType::WorkerHello:
+        if (length != 6) return false;
+        worker.slots = std::max(1, int(payload[0]));
+        worker.threads = payload[1];
+        worker.pid = getU32(payload + 2);
+        std::cout << "Worker " << worker.id << " connected: pid " << worker.pid << ", "
+                  << worker.threads << " threads, " << worker.slots << " slots" << std::endl;
+        return true;
+    case MessageType::Heartbeat:
+        return true;
+    case MessageType::JobResult:
+        if (length < 19 || (length - 19) % 2 != 0) return false;
+        handleResult(worker, payload, length);
+        return true;
+    case MessageType::JobError:
+        if (length != 4) return false;
+        handleJobError(worker, getU32(payload));
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Coordinator::handleResult(WorkerLink& worker, const uint8_t* payload, size_t length) {
+    uint32_t id = getU32(payload);
+    if (id >= jobs.size()) return;
+    auto held = std::find(worker.held.begin(), worker.held.end(), id);
+    if (held != worker.held.end()) worker.held.erase(held);
+
+    uint32_t timeMs = getU32(payload + 15);
+    uint32_t nodes = getU32(payload + 11);
+    worker.busyMs += timeMs;
+    worker.nodes += nodes;
+
+    // First answer wins, whoever holds the lease now
+    AnalysisJob& job = jobs[id];
+    if (job.state == JobState::Done) {
+        duplicateResults++;
+        return;
+    }
+    if (job.state == JobState::Failed) failedJobs--;
+    job.state = JobState::Done;
+    job.worker = -1;
+    doneJobs++;
+    worker.completed++;
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016" PRIx64, job.key);
+    progressLog << key << " done depth " << int(payload[10]) << " score " << int32_t(getU32(payload + 6))
+                << " nodes " << nodes << " time " << timeMs
+                << " best " << Position::moveToUci(getU16(payload + 4)) << " pv";
+    for (size_t offset = 19; offset < length; offset += 2) {
+        progressLog << " " << Position::moveToUci(getU16(payload + offset));
+    }
+    // Flushed per line: the log is what a restart resumes from
+    progressLog << " ; " << job.fen << std::endl;
+}
+
+// A position the worker cannot set up fails at once: another lease would not help
+void Coordinator::handleJobError(WorkerLink& worker, uint32_t id) {
+    if (id >= jobs.size()) return;
+    auto held = std::find(worker.held.begin(), worker.held.end(), id);
+    if (held != worker.held.end()) worker.held.erase(held);
+    AnalysisJob& job = jobs[id];
+    if (job.state == JobState::Done || job.state == JobState::Failed) return;
+    job.state = JobState::Failed;
+    job.worker = -1;
+    failedJobs++;
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016" PRIx64, job.key);
+    progressLog << key << " failed invalid-fen ; " << job.fen << std::endl;
+}
+
+void Coordinator::assignJobs() {
+    for (auto& link : workers) {
+        WorkerLink& worker = *link;
+        if (worker.fd == -1 || worker.slots == 0 || worker.stalled) continue;
+        while (int(worker.held.size()) < worker.slots && !queue.empty()) {
+            uint32_t id = queue.front();
+            queue.pop_front();
+            AnalysisJob& job = jobs[id];
+            if (job.state != JobState::Queued) continue;   // answered late while waiting for a retry
+            job.state = JobState::Leased;
+            job.worker = worker.id;
+            job.attempts++;
+            if (worker.held.empty()) worker.leaseUntilMs = nowMs() + config.leaseMs;
+            worker.held.push_back(id);
+            uint32_t nodes = uint32_t(std::min<uint64_t>(config.nodes, 0xFFFFFFFFu));
+            send(worker, Frame(MessageType::Job).u32(id).u8(uint8_t(std::min(config.depth, 255))).u32(nodes).text(job.fen));
+        }
+    }
+}
+
+// A silent worker keeps its connection (a late answer is still used if it is
+// the first) but its jobs go back to the queue and it gets no new ones
+void Coordinator::expireLeases() {
+    int64_t now = nowMs();
+    for (auto& link : workers) {
+        WorkerLink& worker = *link;
+        if (worker.fd == -1 || worker.stalled || worker.held.empty() || now < worker.leaseUntilMs) continue;
+        std::cout << "Worker " << worker.id << " missed its lease, " << worker.held.size() << " jobs requeued" << std::endl;
+        worker.stalled = true;
+        releaseJobs(worker);
+    }
+}
+
+void Coordinator::releaseJobs(WorkerLink& worker) {
+    for (uint32_t id : worker.held) {
+        AnalysisJob& job = jobs[id];
+        if (job.state != JobState::Leased || job.worker != worker.id) continue;
+        job.worker = -1;
+        worker.lostJobs++;
+        if (job.attempts >= config.maxAttempts) {
+            job.state = JobState::Failed;
+            failedJobs++;
+            char key[17];
+            std::snprintf(key, sizeof(key), "%016" PRIx64, job.key);
+            progressLog << key << " failed attempts " << job.attempts << " ; " << job.fen << std::endl;
+        }
+        else {
+            // Retried before untouched positions so a retry does not wait for the whole queue
+            job.state = JobState::Queued;
+            queue.push_front(id);
+            retries++;
+        }
+    }
+    worker.held.clear();
+}
+
+void Coordinator::dropWorker(WorkerLink& worker) {
+    if (worker.fd == -1) return;
+    std::cout << "Worker " << worker.id << " disconnected";
+    if (!worker.held.empty()) std::cout << ", " << worker.held.size() << " jobs requeued";
+    std::cout << std::endl;
+    releaseJobs(worker);
+    close(worker.fd);
+    worker.fd = -1;
+    worker.disconnectedMs = nowMs();
+}
+
+void Coordinator::send(WorkerLink& worker, const Frame& frame) {
+    if (worker.fd == -1) return;
+    frame.appendTo(worker.out);
+}
+
+bool Coordinator::flush(WorkerLink& worker) {
+    size_t offset = 0;
+    while (offset < worker.out.size()) {
+        ssize_t sent = ::send(worker.fd, worker.out.data() + offset, worker.out.size() - offset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            offset += sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+    worker.out.erase(worker.out.begin(), worker.out.begin() + offset);
+    return true;
+}
+
+bool Coordinator::run() {
+    lastReportMs = nowMs();
+    bool abandoned = false;
+    doneAtStart = doneJobs;
+    std::vector<pollfd> fds;
+    std::vector<WorkerLink*> polled;
+
+    while (running && !finished()) {
+        fds.assign(1, { listenFd, POLLIN, 0 });
+        polled.clear();
+        for (auto& link : workers) {
+            if (link->fd == -1) continue;
+            fds.push_back({ link->fd, short(POLLIN | (link->out.empty() ? 0 : POLLOUT)), 0 });
+            polled.push_back(link.get());
+        }
+        if (poll(fds.data(), fds.size(), 50) > 0) {
+            if (fds[0].revents & POLLIN) acceptWorkers();
+            for (size_t i = 0; i < polled.size(); i++) {
+                WorkerLink& worker = *polled[i];
+                short revents = fds[i + 1].revents;
+                if (revents & (POLLIN | POLLHUP | POLLERR)) onReadable(worker);
+                if (worker.fd != -1 && (revents & POLLOUT) && !flush(worker)) dropWorker(worker);
+            }
+        }
+
+        reapWorkers();
+        if (!children.empty()) {
+            bool alive = std::any_of(children.begin(), children.end(), [](pid_t child) { return child != -1; });
+            for (auto& link : workers) alive = alive || link->fd != -1;
+            if (!alive) {
+                std::cerr << "No workers left, " << jobs.size() - doneJobs - failedJobs << " positions not analysed" << std::endl;
+                abandoned = true;
+                break;
+            }
+        }
+        expireLeases();
+        assignJobs();
+        for (auto& link : workers) {
+            if (link->fd != -1 && !link->out.empty() && !flush(*link)) dropWorker(*link);
+        }
+        if (nowMs() - lastReportMs >= config.reportMs) {
+            lastReportMs = nowMs();
+            report();
+        }
+    }
+    report();
+
+    // Connected workers exit on NoMoreJobs; local ones are then reaped. A
+    // local worker that was never accepted would wait for jobs forever.
+    std::vector<uint32_t> told;
+    for (auto& link : workers) {
+        if (link->fd == -1) continue;
+        send(*link, Frame(MessageType::NoMoreJobs));
+        if (flush(*link) && link->out.empty()) told.push_back(link->pid);
+        close(link->fd);
+        link->fd = -1;
+        link->disconnectedMs = nowMs();
+    }
+    for (pid_t child : children) {
+        if (child == -1) continue;
+        if (!running || std::find(told.begin(), told.end(), uint32_t(child)) == told.end()) kill(child, SIGTERM);
+        int status = 0;
+        waitpid(child, &status, 0);
+    }
+    return !abandoned;
+}
+
+void Coordinator::report() {
+    int64_t now = nowMs();
+    int64_t connectedMs = 0, busyMs = 0;
+    int connected = 0;
+    size_t leased = 0;
+    for (auto& link : workers) {
+        connectedMs += (link->fd == -1 ? link->disconnectedMs : now) - link->connectedMs;
+        busyMs += link->busyMs;
+        leased += link->held.size();
+        if (link->fd != -1) connected++;
+    }
+    double seconds = std::max(0.001, now / 1000.0);
+    std::cout << "[" << std::fixed << std::setprecision(1) << std::setw(7) << seconds << "s] done "
+              << doneJobs << "/" << jobs.size() << ", failed " << failedJobs << ", leased " << leased
+              << ", retries " << retries << ", " << (doneJobs - doneAtStart) / seconds << " pos/s, "
+              << connected << " workers, utilization "
+              << std::setprecision(0) << 100.0 * busyMs / std::max<int64_t>(1, connectedMs) << "%" << std::endl;
+}
+
+void Coordinator::printSummary() const {
+    int64_t now = nowMs();
+    double seconds = std::max(0.001, now / 1000.0);
+    uint64_t nodes = 0;
+    std::cout << "\n worker      pid  threads     jobs      nodes    pos/s   util   lost" << std::endl;
+    for (const auto& link : workers) {
+        const WorkerLink& worker = *link;
+        int64_t connectedMs = std::max<int64_t>(1, (worker.fd == -1 ? worker.disconnectedMs : now) - worker.connectedMs);
+        nodes += worker.nodes;
+        std::cout << std::setw(7) << worker.id << std::setw(9) << worker.pid << std::setw(9) << worker.threads
+                  << std::setw(9) << worker.completed << std::setw(11) << worker.nodes
+                  << std::setw(9) << std::fixed << std::setprecision(1) << worker.completed * 1000.0 / connectedMs
+                  << std::setw(6) << std::setprecision(0) << 100.0 * worker.busyMs / connectedMs << "%"
+                  << std::setw(7) << worker.lostJobs << std::endl;
+    }
+    std::cout << "\nPositions " << jobs.size() << ": " << doneJobs << " done (" << resumedJobs << " resumed), "
+              << failedJobs << " failed, " << duplicatePositions << " duplicate positions merged, "
+              << duplicateResults << " duplicate results dropped, " << retries << " retries" << std::endl;
+    std::cout << "Analysed " << doneJobs - doneAtStart << " positions in " << std::setprecision(2) << seconds << " s: "
+              << std::setprecision(1) << (doneJobs - doneAtStart) / seconds << " pos/s, "
+              << uint64_t(nodes / seconds) << " nodes/s" << std::endl;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "Position.h"
+#include "Protocol.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+// Distributed analysis: the coordinator splits a PGN or EPD workload into one
+// job per distinct position (Zobrist key) and leases the jobs to worker
+// processes over TCP or a Unix socket. Results are appended to a progress log
+// that doubles as the output; restarting with the same log skips every
+// position already in it. Linux only (poll, fork).
+
+struct CoordinatorConfig {
+    std::string inputPath;         // .pgn (every position of every game) or EPD
+    std::string logPath = "analysis.log";
+    int port = 5600;
+    std::string unixPath;          // listen on a Unix socket instead of TCP when set
+    int depth = 12;
+    uint64_t nodes = 0;            // 0 = depth only
+    int everyPly = 1;              // PGN: analyse every Nth ply
+    int skipPlies = 0;             // PGN: leave out the opening plies
+    int leaseMs = 10000;           // a worker that is silent this long loses its jobs
+    int maxAttempts = 3;           // leases of one job before it is logged as failed
+    int reportMs = 2000;
+    int localWorkers = 0;          // worker processes started on this machine
+    int workerThreads = 1;
+    int workerHashMb = 64;
+    int crashAfter = 0;            // the first local worker dies after this many jobs (tests retries)
+    std::string workerStatsDir;    // local workers write their search statistics here when set
+};
+
+enum class JobState {
+    Queued, Leased, Done, Failed
+};
+
+struct AnalysisJob {
+    uint64_t key = 0;
+    std::string fen;
+    JobState state = JobState::Queued;
+    int attempts = 0;
+    int worker = -1;               // holder while leased
+};
+
+// One connected worker process
+struct WorkerLink {
+    int id = 0;
+    int fd = -1;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    int slots = 0;                 // 0 until the worker's hello
+    int threads = 1;
+    uint32_t pid = 0;
+    std::vector<uint32_t> held;    // leased job ids
+    int64_t leaseUntilMs = 0;
+    bool stalled = false;          // lease expired: no new jobs until it speaks again
+    int64_t connectedMs = 0;
+    int64_t disconnectedMs = -1;
+    int64_t busyMs = 0;            // search time reported with results
+    uint64_t completed = 0;
+    uint64_t nodes = 0;
+    uint64_t lostJobs = 0;         // leases that expired or died with the connection
+};
+
+class Coordinator {
+public:
+    explicit Coordinator(const CoordinatorConfig& config);
+    ~Coordinator();
+
+    bool load();                   // input + progress log
+    bool start();                  // listen, then start the local workers
+    // Until every job is done or failed, or requestStop(); false when the
+    // local workers kept dying and no worker was left for the remaining jobs
+    bool run();
+    void requestStop() { running = false; }   // async-signal-safe
+    void printSummary() const;
+
+private:
+    int64_t nowMs() const;
+    void addJob(const Position& pos);
+    void readProgressLog();
+    bool spawnWorker(int index);
+    void reapWorkers();
+    void acceptWorkers();
+    void onReadable(WorkerLink& worker);
+    bool handleFrame(WorkerLink& worker, const uint8_t* frame, size_t size);
+    void handleResult(WorkerLink& worker, const uint8_t* payload, size_t length);
+    void handleJobError(WorkerLink& worker, uint32_t id);
+    void assignJobs();
+    void expireLeases();
+    void releaseJobs(WorkerLink& worker);
+    void dropWorker(WorkerLink& worker);
+    void send(WorkerLink& worker, const Frame& frame);
+    bool flush(WorkerLink& worker);
+    void report();
+    bool finished() const { return doneJobs + failedJobs == jobs.size(); }
+
+    CoordinatorConfig config;
+    std::vector<AnalysisJob> jobs;
+    std::unordered_map<uint64_t, uint32_t> jobByKey;
+    std::deque<uint32_t> queue;
+    size_t doneJobs = 0;
+    size_t failedJobs = 0;
+    size_t resumedJobs = 0;        // already in the progress log at startup
+    uint64_t duplicatePositions = 0;
+    uint64_t duplicateResults = 0; // a second answer for a job, e.g. after its lease expired
+    uint64_t retries = 0;
+
+    std::ofstream progressLog;
+    int listenFd = -1;
+    std::atomic<bool> running{ false };
+    std::vector<std::unique_ptr<WorkerLink>> workers;
+    std::vector<pid_t> children;   // by local worker index, -1 once reaped for good
+    std::vector<int> restarts;
+    std::chrono::steady_clock::time_point startTime;
+    int64_t lastReportMs = 0;
+    size_t doneAtStart = 0;
+};
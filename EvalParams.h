@@ -0,0 +1,161 @@
+#pragma once
+
+// Evaluation parameters in centipawns, indexed by PieceType.
+// Piece-square tables are written from White's point of view with rank 8 in
+// the first row; Evaluate.cpp mirrors them for Black.
+// This file can be regenerated by the tuner.
+
+const int PieceValueMg[7] = { 0, 0, 900, 500, 330, 320, 100 };
+const int PieceValueEg[7] = { 0, 0, 900, 500, 330, 320, 120 };
+
+// Game phase weight per piece; 24 = full middlegame
+const int PhaseWeight[7] = { 0, 0, 4, 2, 1, 1, 0 };
+const int MaxPhase = 24;
+
+// Middlegame piece-square tables
+const int PstMg[7][64] = {
+    { // None
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { // King
+         -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+         -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+         -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+         -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+         -20,  -30,  -30,  -40,  -40,  -30,  -30,  -20,
+         -10,  -20,  -20,  -20,  -20,  -20,  -20,  -10,
+          20,   20,    0,    0,    0,    0,   20,   20,
+          20,   30,   10,    0,    0,   10,   30,   20
+    },
+    { // Queen
+         -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+         -10,    0,    0,    0,    0,    0,    0,  -10,
+         -10,    0,    5,    5,    5,    5,    0,  -10,
+          -5,    0,    5,    5,    5,    5,    0,   -5,
+           0,    0,    5,    5,    5,    5,    0,   -5,
+         -10,    5,    5,    5,    5,    5,    0,  -10,
+         -10,    0,    5,    0,    0,    0,    0,  -10,
+         -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20
+    },
+    { // Rook
+           0,    0,    0,    0,    0,    0,    0,    0,
+           5,   10,   10,   10,   10,   10,   10,    5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+           0,    0,    0,    5,    5,    0,    0,    0
+    },
+    { // Bishop
+         -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+         -10,    0,    0,    0,    0,    0,    0,  -10,
+         -10,    0,    5,   10,   10,    5,    0,  -10,
+         -10,    5,    5,   10,   10,    5,    5,  -10,
+         -10,    0,   10,   10,   10,   10,    0,  -10,
+         -10,   10,   10,   10,   10,   10,   10,  -10,
+         -10,    5,    0,    0,    0,    0,    5,  -10,
+         -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20
+    },
+    { // Knight
+         -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+         -40,  -20,    0,    0,    0,    0,  -20,  -40,
+         -30,    0,   10,   15,   15,   10,    0,  -30,
+         -30,    5,   15,   20,   20,   15,    5,  -30,
+         -30,    0,   15,   20,   20,   15,    0,  -30,
+         -30,    5,   10,   15,   15,   10,    5,  -30,
+         -40,  -20,    0,    5,    5,    0,  -20,  -40,
+         -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50
+    },
+    { // Pawn
+           0,    0,    0,    0,    0,    0,    0,    0,
+          50,   50,   50,   50,   50,   50,   50,   50,
+          10,   10,   20,   30,   30,   20,   10,   10,
+           5,    5,   10,   25,   25,   10,    5,    5,
+           0,    0,    0,   20,   20,    0,    0,    0,
+           5,   -5,  -10,    0,    0,  -10,   -5,    5,
+           5,   10,   10,  -20,  -20,   10,   10,    5,
+           0,    0,    0,    0,    0,    0,    0,    0
+    }
+};
+
+// Endgame piece-square tables
+const int PstEg[7][64] = {
+    { // None
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { // King
+         -50,  -40,  -30,  -20,  -20,  -30,  -40,  -50,
+         -30,  -20,  -10,    0,    0,  -10,  -20,  -30,
+         -30,  -10,   20,   30,   30,   20,  -10,  -30,
+         -30,  -10,   30,   40,   40,   30,  -10,  -30,
+         -30,  -10,   30,   40,   40,   30,  -10,  -30,
+         -30,  -10,   20,   30,   30,   20,  -10,  -30,
+         -30,  -30,    0,    0,    0,    0,  -30,  -30,
+         -50,  -30,  -30,  -30,  -30,  -30,  -30,  -50
+    },
+    { // Queen
+         -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+         -10,    0,    0,    0,    0,    0,    0,  -10,
+         -10,    0,    5,    5,    5,    5,    0,  -10,
+          -5,    0,    5,    5,    5,    5,    0,   -5,
+           0,    0,    5,    5,    5,    5,    0,   -5,
+         -10,    5,    5,    5,    5,    5,    0,  -10,
+         -10,    0,    5,    0,    0,    0,    0,  -10,
+         -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20
+    },
+    { // Rook
+           0,    0,    0,    0,    0,    0,    0,    0,
+           5,   10,   10,   10,   10,   10,   10,    5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+          -5,    0,    0,    0,    0,    0,    0,   -5,
+           0,    0,    0,    5,    5,    0,    0,    0
+    },
+    { // Bishop
+         -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+         -10,    0,    0,    0,    0,    0,    0,  -10,
+         -10,    0,    5,   10,   10,    5,    0,  -10,
+         -10,    5,    5,   10,   10,    5,    5,  -10,
+         -10,    0,   10,   10,   10,   10,    0,  -10,
+         -10,   10,   10,   10,   10,   10,   10,  -10,
+         -10,    5,    0,    0,    0,    0,    5,  -10,
+         -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20
+    },
+    { // Knight
+         -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+         -40,  -20,    0,    0,    0,    0,  -20,  -40,
+         -30,    0,   10,   15,   15,   10,    0,  -30,
+         -30,    5,   15,   20,   20,   15,    5,  -30,
+         -30,    0,   15,   20,   20,   15,    0,  -30,
+         -30,    5,   10,   15,   15,   10,    5,  -30,
+         -40,  -20,    0,    5,    5,    0,  -20,  -40,
+         -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50
+    },
+    { // Pawn
+           0,    0,    0,    0,    0,    0,    0,    0,
+          80,   80,   80,   80,   80,   80,   80,   80,
+          50,   50,   50,   50,   50,   50,   50,   50,
+          30,   30,   30,   30,   30,   30,   30,   30,
+          15,   15,   15,   15,   15,   15,   15,   15,
+           5,    5,    5,    5,    5,    5,    5,    5,
+           0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0
+    }
+};
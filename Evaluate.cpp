@@ -0,0 +1,27 @@
+#include "Evaluate.h"
+#include "EvalParams.h"
+#include <algorithm>
+
+int evaluate(const Position& pos) {
+    int mg[2] = { 0, 0 };
+    int eg[2] = { 0, 0 };
+    int phase = 0;
+
+    for (int c = 0; c < 2; c++) {
+        Color color = c == 0 ? Color::White : Color::Black;
+        for (int t = (int)PieceType::King; t <= (int)PieceType::Pawn; t++) {
+            Bitboard bb = pos.pieces(color, (PieceType)t);
+            while (bb) {
+                int sq = popLsb(bb);
+                int index = c == 0 ? sq ^ 56 : sq;   // tables are stored rank 8 first
+                mg[c] += PieceValueMg[t] + PstMg[t][index];
+                eg[c] += PieceValueEg[t] + PstEg[t][index];
+                phase += PhaseWeight[t];
+            }
+        }
+    }
+
+    phase = std::min(phase, MaxPhase);
+    int score = ((mg[0] - mg[1]) * phase + (eg[0] - eg[1]) * (MaxPhase - phase)) / MaxPhase;
+    return pos.sideToMove() == Color::White ? score : -score;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "Position.h"
+
+// Static evaluation in centipawns from the side to move's point of view:
+// material + piece-square tables, tapered between middlegame and endgame
+int evaluate(const Position& pos);
@@ -0,0 +1,121 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+const char* frameSpanName(FrameSpan span) {
+    static const char* names[] = {
+        "frame", "events", "handleMouseClick", "movePiece", "updateGameState", "network", "analysis.poll",
+        "draw.board", "draw.selection", "draw.pieces", "draw.analysis", "draw.replayBar", "draw.hud",
+        "display"
+    };
+    return span < FrameSpan::Count ? names[(int)span] : "click-to-photon";
+}
+
+FrameProfiler::FrameProfiler()
+    : history(HistoryFrames * (int)FrameSpan::Count, NotRun), latencyUs(MaxLatencies, 0),
+      trace(TraceCapacity), scratch(HistoryFrames) {
+    epochUs = nowUs();
+    std::fill(std::begin(openSpans), std::end(openSpans), 0);
+    std::fill(std::begin(frameSpans), std::end(frameSpans), NotRun);
+}
+
+int64_t FrameProfiler::nowUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() - epochUs;
+}
+
+void FrameProfiler::beginFrame() {
+    std::fill(std::begin(frameSpans), std::end(frameSpans), NotRun);
+    begin(FrameSpan::Frame);
+}
+
+void FrameProfiler::endFrame() {
+    end(FrameSpan::Frame);
+    int64_t now = nowUs();
+    for (int i = 0; i < pendingCount; i++) {
+        int64_t latency = now - pendingInputs[i];
+        latencyUs[latencies % MaxLatencies] = int32_t(latency);
+        latencies++;
+        record(uint8_t(FrameSpan::Count), pendingInputs[i], latency);
+    }
+    pendingCount = 0;
+
+    int32_t* row = &history[(frames % HistoryFrames) * (int)FrameSpan::Count];
+    std::copy(std::begin(frameSpans), std::end(frameSpans), row);
+    frames++;
+}
+
+void FrameProfiler::markInput() {
+    if (pendingCount < 16) pendingInputs[pendingCount++] = nowUs();
+}
+
+void FrameProfiler::begin(FrameSpan span) {
+    openSpans[(int)span] = nowUs();
+}
+
+void FrameProfiler::end(FrameSpan span) {
+    int64_t start = openSpans[(int)span];
+    int64_t duration = nowUs() - start;
+    int32_t& total = frameSpans[(int)span];
+    total = (total == NotRun ? 0 : total) + int32_t(duration);
+    record(uint8_t(span), start, duration);
+}
+
+void FrameProfiler::record(uint8_t span, int64_t startUs, int64_t durationUs) {
+    trace[traceEvents % TraceCapacity] = { startUs, int32_t(durationUs), span };
+    traceEvents++;
+}
+
+// Frames in which a span did not run are left out
+double FrameProfiler::percentile(const int32_t* values, int count, int stride, double p) const {
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (values[i * stride] != NotRun) scratch[kept++] = values[i * stride];
+    }
+    count = kept;
+    if (count == 0) return 0;
+    int index = std::min(count - 1, int(p * count));
+    std::nth_element(scratch.begin(), scratch.begin() + index, scratch.begin() + count);
+    return scratch[index] / 1000.0;
+}
+
+double FrameProfiler::framePercentile(double p) const {
+    return spanPercentile(FrameSpan::Frame, p);
+}
+
+double FrameProfiler::spanPercentile(FrameSpan span, double p) const {
+    return percentile(&history[(int)span], frameCount(), (int)FrameSpan::Count, p);
+}
+
+double FrameProfiler::latencyPercentile(double p) const {
+    return percentile(latencyUs.data(), latencyCount(), 1, p);
+}
+
+double FrameProfiler::frameMs(int back) const {
+    if (back >= frameCount()) return 0;
+    int frame = (frames - 1 - back) % HistoryFrames;
+    return history[frame * (int)FrameSpan::Count + (int)FrameSpan::Frame] / 1000.0;
+}
+
+void FrameProfiler::writeChromeTrace(std::ostream& out) const {
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"game loop\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"input latency\"}}";
+    uint64_t first = traceEvents > TraceCapacity ? traceEvents - TraceCapacity : 0;
+    for (uint64_t i = first; i < traceEvents; i++) {
+        const TraceEvent& event = trace[i % TraceCapacity];
+        bool input = event.span == uint8_t(FrameSpan::Count);
+        out << ",\n{\"name\":\"" << frameSpanName(FrameSpan(event.span)) << "\",\"cat\":\"" << (input ? "input" : "frame")
+            << "\",\"ph\":\"X\",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+            << ",\"pid\":1,\"tid\":" << (input ? 2 : 1) << "}";
+    }
+    out << "\n]}\n";
+}
+
+bool FrameProfiler::saveChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+    writeChromeTrace(file);
+    return file.good();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timed phases of the GUI frame; spans may nest (a click inside Events)
+enum class FrameSpan {
+    Frame, Events, MouseClick, MovePiece, GameState, Network, AnalysisPoll,
+    DrawBoard, DrawSelection, DrawPieces, DrawAnalysis, DrawReplayBar, DrawHud,
+    Display,                    // includes the frame-rate limiter's sleep
+    Count
+};
+
+const char* frameSpanName(FrameSpan span);
+
+// Per-frame timing of the game loop with a microsecond clock. All buffers are
+// rings allocated up front, so recording costs two clock reads per span and
+// never allocates. Click-to-photon latency runs from the frame that polled the
+// click to the return of the display() that showed its result; the time the
+// event waited in the OS queue and the monitor scan-out are not visible here.
+class FrameProfiler {
+public:
+    static const int HistoryFrames = 512;
+    static const int MaxLatencies = 256;
+    static const int TraceCapacity = 1 << 16;
+
+    FrameProfiler();
+
+    int64_t nowUs() const;
+
+    void beginFrame();
+    void endFrame();              // call right after display()
+    void markInput();             // a click was taken from the event queue
+
+    void begin(FrameSpan span);
+    void end(FrameSpan span);
+
+    // Timing scope: begin on construction, end on destruction
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, FrameSpan span) : profiler(profiler), span(span) { profiler.begin(span); }
+        ~Scope() { profiler.end(span); }
+    private:
+        FrameProfiler& profiler;
+        FrameSpan span;
+    };
+
+    // Milliseconds over the recorded history, counting only the frames in
+    // which the span ran; p in [0, 1]
+    double framePercentile(double p) const;
+    double spanPercentile(FrameSpan span, double p) const;
+    double latencyPercentile(double p) const;
+    int frameCount() const { return frames < HistoryFrames ? frames : HistoryFrames; }
+    int latencyCount() const { return latencies < MaxLatencies ? latencies : MaxLatencies; }
+    double frameMs(int back) const;     // 0 = last finished frame
+
+    // Chrome trace event format (chrome://tracing, Perfetto): the recorded
+    // spans as complete events on thread 1, click-to-photon on thread 2
+    void writeChromeTrace(std::ostream& out) const;
+    bool saveChromeTrace(const std::string& path) const;
+
+private:
+    struct TraceEvent {
+        int64_t startUs;
+        int32_t durationUs;
+        uint8_t span;             // FrameSpan, or Count for click-to-photon
+    };
+
+    void record(uint8_t span, int64_t startUs, int64_t durationUs);
+    double percentile(const int32_t* values, int count, int stride, double p) const;
+
+    int64_t epochUs = 0;
+    int64_t openSpans[(int)FrameSpan::Count];
+    static constexpr int32_t NotRun = -1;
+    int32_t frameSpans[(int)FrameSpan::Count];                 // this frame's total per span, or NotRun
+    std::vector<int32_t> history;      // [HistoryFrames][Count] microseconds
+    int frames = 0;
+    std::vector<int32_t> latencyUs;    // [MaxLatencies]
+    int latencies = 0;
+    int64_t pendingInputs[16];
+    int pendingCount = 0;
+    std::vector<TraceEvent> trace;     // [TraceCapacity]
+    uint64_t traceEvents = 0;
+    mutable std::vector<int32_t> scratch;
+};
@@ -0,0 +1,43 @@
+#include "GameReplay.h"
+#include <algorithm>
+
+GameReplay::GameReplay(int interval) : interval(std::max(1, interval)) {
+    reset(Position());
+}
+
+void GameReplay::reset(const Position& start) {
+    moves.clear();
+    keys.assign(1, start.key());
+    checkpoints.assign(1, start.snapshot());
+    tail = start;
+}
+
+void GameReplay::push(PackedMove move) {
+    tail.makeMove(move);
+    moves.push_back(move);
+    keys.push_back(tail.key());
+    if (moves.size() % interval == 0) {
+        checkpoints.push_back(tail.snapshot());
+    }
+}
+
+void GameReplay::truncate(int plies) {
+    if (plies < 0 || plies >= length()) return;
+    moves.resize(plies);
+    keys.resize(plies + 1);
+    checkpoints.resize(plies / interval + 1);
+    seek(plies, tail);
+}
+
+void GameReplay::seek(int ply, Position& pos) const {
+    ply = std::max(0, std::min(ply, length()));
+    int start = ply / interval * interval;
+    const PositionSnapshot& checkpoint = checkpoints[ply / interval];
+
+    // Repetitions can only reach back as far as the last capture or pawn move
+    int previous = std::min<int>(start, checkpoint.halfmoveClock);
+    pos.restore(checkpoint, keys.data() + start - previous, previous);
+    for (int i = start; i < ply; i++) {
+        pos.makeMove(moves[i]);
+    }
+}
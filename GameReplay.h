@@ -0,0 +1,30 @@
+#pragma once
+#include "Position.h"
+#include <vector>
+
+// A game as its start position and moves, with a position snapshot every
+// `interval` plies. Seeking restores the nearest snapshot at or before the
+// ply and replays the rest silently on the rules core, so reaching any ply
+// costs at most interval - 1 moves however long the game is.
+class GameReplay {
+public:
+    explicit GameReplay(int interval = 16);
+
+    void reset(const Position& start);
+    void push(PackedMove move);            // must be legal after the last ply
+    void truncate(int plies);              // keeps the first `plies` moves
+
+    int length() const { return (int)moves.size(); }
+    PackedMove move(int ply) const { return moves[ply]; }    // played from the position after `ply` moves
+    const Position& last() const { return tail; }
+
+    // pos becomes the position after `ply` moves, with the keys repetition detection needs
+    void seek(int ply, Position& pos) const;
+
+private:
+    int interval;
+    std::vector<PackedMove> moves;
+    std::vector<uint64_t> keys;                    // keys[i]: position after i moves
+    std::vector<PositionSnapshot> checkpoints;     // after 0, interval, 2 * interval ... moves
+    Position tail;                                 // after the last move, where push continues
+};
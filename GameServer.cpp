@@ -0,0 +1,666 @@
+#include "GameServer.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static const int ClockCheckIntervalMs = 20;
+static const int MaxGather = 64;           // iovecs per sendmsg
+
+ServerWorker::ServerWorker(int index, const ServerConfig& config, std::vector<std::unique_ptr<ServerWorker>>& shards)
+    : index(index), config(config), shards(shards) {
+}
+
+ServerWorker::~ServerWorker() {
+    stop();
+    for (auto& entry : connections) {
+        if (entry.second->fd != -1) close(entry.second->fd);
+    }
+    if (wakeFd != -1) close(wakeFd);
+    if (epollFd != -1) close(epollFd);
+}
+
+bool ServerWorker::start() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd == -1 || wakeFd == -1) {
+        std::cerr << "Worker " << index << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    running = true;
+    thread = std::thread(&ServerWorker::run, this);
+    return true;
+}
+
+void ServerWorker::stop() {
+    if (!running.exchange(false)) return;
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+    if (thread.joinable()) thread.join();
+}
+
+void ServerWorker::handOff(int fd, std::vector<uint8_t> buffered, std::vector<uint8_t> unsent) {
+    {
+        std::lock_guard<std::mutex> lock(handOffMutex);
+        handOffs.push_back({ fd, std::move(buffered), std::move(unsent) });
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void ServerWorker::drainHandOffs() {
+    std::vector<HandOff> pending;
+    {
+        std::lock_guard<std::mutex> lock(handOffMutex);
+        pending.swap(handOffs);
+    }
+    for (HandOff& entry : pending) {
+        adopt(entry);
+    }
+}
+
+void ServerWorker::adopt(HandOff& entry) {
+    auto conn = std::make_unique<ServerConnection>();
+    conn->fd = entry.fd;
+    conn->in = std::move(entry.buffered);
+    conn->out = std::move(entry.unsent);
+    ServerConnection* raw = conn.get();
+    connections[raw] = std::move(conn);
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = raw;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, raw->fd, &ev);
+
+    if (!raw->out.empty() && !flush(raw)) {
+        closeConnection(raw);
+        return;
+    }
+    if (!raw->in.empty()) processInput(raw);
+}
+
+void ServerWorker::run() {
+    epoll_event events[256];
+    auto lastClockCheck = Clock::now();
+
+    while (running) {
+        int count = epoll_wait(epollFd, events, 256, ClockCheckIntervalMs);
+        for (int i = 0; i < count; i++) {
+            ServerConnection* conn = static_cast<ServerConnection*>(events[i].data.ptr);
+            if (!conn) {
+                uint64_t value;
+                ssize_t ignored = read(wakeFd, &value, sizeof(value));
+                (void)ignored;
+                drainHandOffs();
+                continue;
+            }
+            if (conn->fd == -1) continue;
+
+            uint32_t flags = events[i].events;
+            if (flags & EPOLLIN) onReadable(conn);
+            if (conn->fd != -1 && (flags & EPOLLOUT) && !flush(conn)) closeConnection(conn);
+            if (conn->fd != -1 && (flags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && !(flags & EPOLLIN)) closeConnection(conn);
+        }
+
+        flushDirty();
+
+        auto now = Clock::now();
+        if (now - lastClockCheck >= std::chrono::milliseconds(ClockCheckIntervalMs)) {
+            lastClockCheck = now;
+            checkClocks();
+            flushDirty();
+        }
+
+        for (ServerConnection* conn : closing) {
+            connections.erase(conn);
+        }
+        closing.clear();
+    }
+}
+
+void ServerWorker::onReadable(ServerConnection* conn) {
+    uint8_t buffer[16384];
+    ssize_t received = recv(conn->fd, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+        conn->in.insert(conn->in.end(), buffer, buffer + received);
+        processInput(conn);
+    }
+    else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        closeConnection(conn);
+    }
+}
+
+void ServerWorker::processInput(ServerConnection* conn) {
+    size_t offset = 0;
+    while (conn->fd != -1) {
+        size_t frameSize = completeFrameSize(conn->in.data() + offset, conn->in.size() - offset);
+        if (frameSize == 0) break;
+
+        // A Join or Spectate for another shard migrates the socket with the unread bytes
+        const uint8_t* frame = conn->in.data() + offset;
+        if ((frame[0] == uint8_t(MessageType::Join) || frame[0] == uint8_t(MessageType::Spectate)) && frame[1] == 4) {
+            uint32_t gameId = getU32(frame + FrameHeaderSize);
+            int shard = int(gameId % shards.size());
+            // A player still waiting in an unstarted game leaves it first, as
+            // handleJoin would; players of a started game get handleJoin's error
+            bool joining = frame[0] == uint8_t(MessageType::Join);
+            if (shard != index && (!conn->game || (joining && !conn->game->started))) {
+                leaveGame(conn);
+                unwatch(conn);
+                if (!flush(conn)) {
+                    closeConnection(conn);
+                    return;
+                }
+                // Whatever the socket would not take yet moves with it
+                std::vector<uint8_t> unsent(conn->out.begin() + conn->outOffset, conn->out.end());
+                for (size_t i = conn->feedHead; i < conn->feed.size(); i++) {
+                    const Frame& pending = *conn->feed[i];
+                    unsent.insert(unsent.end(), pending.data + (i == conn->feedHead ? conn->feedOffset : 0), pending.data + pending.size);
+                }
+                std::vector<uint8_t> rest(conn->in.begin() + offset, conn->in.end());
+                int fd = conn->fd;
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                conn->fd = -1;
+                closing.push_back(conn);
+                shards[shard]->handOff(fd, std::move(rest), std::move(unsent));
+                return;
+            }
+        }
+
+        if (!handleFrame(conn, frame, frameSize)) {
+            closeConnection(conn);
+            return;
+        }
+        offset += frameSize;
+    }
+    if (conn->fd != -1) {
+        conn->in.erase(conn->in.begin(), conn->in.begin() + offset);
+    }
+}
+
+bool ServerWorker::handleFrame(ServerConnection* conn, const uint8_t* frame, size_t size) {
+    const uint8_t* payload = frame + FrameHeaderSize;
+    size_t length = size - FrameHeaderSize;
+
+    switch (MessageType(frame[0])) {
+    case MessageType::Join:
+        if (length != 4) return false;
+        handleJoin(conn, getU32(payload));
+        return true;
+    case MessageType::Move:
+        if (length != 2) return false;
+        handleMove(conn, getU16(payload));
+        return true;
+    case MessageType::Resign:
+        handleResign(conn);
+        return true;
+    case MessageType::ClockRequest:
+        handleClockRequest(conn);
+        return true;
+    case MessageType::Spectate:
+        if (length != 4) return false;
+        handleSpectate(conn, getU32(payload));
+        return true;
+    default:
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::BadMessage)));
+        return false;
+    }
+}
+
+void ServerWorker::handleJoin(ServerConnection* conn, uint32_t gameId) {
+    if (conn->game) {
+        if (conn->game->started) {
+            send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::BadMessage)));
+            return;
+        }
+        leaveGame(conn);
+    }
+    unwatch(conn);
+
+    auto& slot = games[gameId];
+    if (!slot) {
+        slot = std::make_unique<ServerGame>();
+        slot->id = gameId;
+    }
+    ServerGame& game = *slot;
+
+    int color = !game.players[0] ? 0 : !game.players[1] ? 1 : -1;
+    if (color == -1) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::GameFull)));
+        return;
+    }
+    game.players[color] = conn;
+    conn->game = &game;
+    conn->color = color;
+    send(conn, Frame(MessageType::Joined).u32(gameId).u8(uint8_t(color)));
+
+    if (game.players[0] && game.players[1]) {
+        game.started = true;
+        game.clockMs[0] = game.clockMs[1] = config.baseMs;
+        game.turnStart = Clock::now();
+        broadcast(game, Frame(MessageType::Start).u32(config.baseMs).u32(config.baseMs).u32(config.incrementMs));
+    }
+}
+
+int64_t ServerWorker::remainingMs(const ServerGame& game, int color) const {
+    int side = game.position.sideToMove() == Color::White ? 0 : 1;
+    if (color != side) return game.clockMs[color];
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - game.turnStart).count();
+    return game.clockMs[color] - elapsed;
+}
+
+void ServerWorker::handleMove(ServerConnection* conn, PackedMove move) {
+    ServerGame* game = conn->game;
+    if (!game) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::NotInGame)));
+        return;
+    }
+    if (!game->started) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::GameNotStarted)));
+        return;
+    }
+    int color = conn->color;
+    Position& pos = game->position;
+    if ((pos.sideToMove() == Color::White ? 0 : 1) != color) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::NotYourTurn)));
+        return;
+    }
+
+    int64_t remaining = remainingMs(*game, color);
+    if (remaining <= 0) {
+        finishGame(*game, color ^ 1, EndReason::Timeout, GameState::Playing);
+        return;
+    }
+
+    MoveList legal;
+    pos.generateLegal(legal);
+    bool found = false;
+    for (PackedMove candidate : legal) {
+        if (candidate == move) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::IllegalMove)));
+        return;
+    }
+
+    game->clockMs[color] = remaining + config.incrementMs;
+    game->turnStart = Clock::now();
+    pos.makeMove(move);
+    broadcast(*game, Frame(MessageType::MoveMade).u16(move)
+                         .u32(uint32_t(game->clockMs[0])).u32(uint32_t(game->clockMs[1])));
+
+    MoveList replies;
+    pos.generateLegal(replies);
+    if (replies.empty()) {
+        if (pos.inCheck()) {
+            finishGame(*game, color, EndReason::Checkmate, GameState::Checkmate);
+        }
+        else {
+            finishGame(*game, 2, EndReason::Draw, GameState::Stalemate);
+        }
+        return;
+    }
+    GameState draw = pos.drawState();
+    if (draw != GameState::Playing) {
+        finishGame(*game, 2, EndReason::Draw, draw);
+    }
+}
+
+void ServerWorker::handleResign(ServerConnection* conn) {
+    if (!conn->game || !conn->game->started) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::NotInGame)));
+        return;
+    }
+    finishGame(*conn->game, conn->color ^ 1, EndReason::Resignation, GameState::Playing);
+}
+
+void ServerWorker::handleClockRequest(ServerConnection* conn) {
+    ServerGame* game = conn->game;
+    if (!game || !game->started) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::GameNotStarted)));
+        return;
+    }
+    int64_t white = std::max<int64_t>(0, remainingMs(*game, 0));
+    int64_t black = std::max<int64_t>(0, remainingMs(*game, 1));
+    uint8_t side = game->position.sideToMove() == Color::White ? 0 : 1;
+    send(conn, Frame(MessageType::Clock).u32(uint32_t(white)).u32(uint32_t(black)).u8(side));
+}
+
+void ServerWorker::handleSpectate(ServerConnection* conn, uint32_t gameId) {
+    if (conn->game) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::BadMessage)));
+        return;
+    }
+    auto found = games.find(gameId);
+    if (found == games.end()) {
+        send(conn, Frame(MessageType::Error).u8(uint8_t(ErrorCode::NoSuchGame)));
+        return;
+    }
+    unwatch(conn);
+    // A small kernel buffer keeps a lagging spectator's backlog in the feed,
+    // where it can be replaced by a snapshot
+    if (config.spectatorSendBuffer > 0) {
+        setsockopt(conn->fd, SOL_SOCKET, SO_SNDBUF, &config.spectatorSendBuffer, sizeof(config.spectatorSendBuffer));
+    }
+    ServerGame& game = *found->second;
+    conn->watching = &game;
+    conn->spectatorIndex = game.spectators.size();
+    game.spectators.push_back(conn);
+    conn->feed.push_back(snapshotFrame(game));
+    markDirty(conn);
+}
+
+// Clocks are as of the last move; the turn has been running since
+SharedFrame ServerWorker::snapshotFrame(ServerGame& game) {
+    if (!game.snapshot) {
+        Frame frame(MessageType::Snapshot);
+        frame.u32(game.id).u16(uint16_t(game.position.gamePly()))
+             .u32(uint32_t(game.clockMs[0])).u32(uint32_t(game.clockMs[1])).u8(game.started ? 1 : 0)
+             .text(game.position.toFen());
+        game.snapshot = std::make_shared<const Frame>(frame);
+    }
+    return game.snapshot;
+}
+
+void ServerWorker::unwatch(ServerConnection* conn) {
+    ServerGame* game = conn->watching;
+    if (!game) return;
+    ServerConnection* moved = game->spectators.back();
+    game->spectators[conn->spectatorIndex] = moved;
+    moved->spectatorIndex = conn->spectatorIndex;
+    game->spectators.pop_back();
+    conn->watching = nullptr;
+    conn->needsSnapshot = false;
+}
+
+// The last frame reaches every spectator, after the current state for those
+// whose backlog was dropped
+void ServerWorker::endSpectating(ServerGame& game, const Frame& last) {
+    if (game.spectators.empty()) return;
+    SharedFrame shared = std::make_shared<const Frame>(last);
+    for (ServerConnection* spectator : game.spectators) {
+        if (spectator->needsSnapshot) spectator->feed.push_back(snapshotFrame(game));
+        spectator->feed.push_back(shared);
+        spectator->needsSnapshot = false;
+        spectator->watching = nullptr;
+        markDirty(spectator);
+    }
+    game.spectators.clear();
+}
+
+void ServerWorker::finishGame(ServerGame& game, int winner, EndReason reason, GameState state) {
+    Frame gameOver = Frame(MessageType::GameOver).u8(uint8_t(winner)).u8(uint8_t(reason)).u8(uint8_t(state));
+    for (ServerConnection* player : game.players) {
+        if (player) send(player, gameOver);
+    }
+    endSpectating(game, gameOver);
+    for (ServerConnection*& player : game.players) {
+        if (player) {
+            player->game = nullptr;
+            player->color = -1;
+            player = nullptr;
+        }
+    }
+    games.erase(game.id);
+}
+
+void ServerWorker::leaveGame(ServerConnection* conn) {
+    ServerGame* game = conn->game;
+    if (!game) return;
+    if (game->started) {
+        finishGame(*game, conn->color ^ 1, EndReason::Abandoned, GameState::Playing);
+        return;
+    }
+    game->players[conn->color] = nullptr;
+    conn->game = nullptr;
+    conn->color = -1;
+    if (!game->players[0] && !game->players[1]) {
+        endSpectating(*game, Frame(MessageType::GameOver).u8(2).u8(uint8_t(EndReason::Abandoned)).u8(uint8_t(GameState::Playing)));
+        games.erase(game->id);
+    }
+}
+
+void ServerWorker::checkClocks() {
+    std::vector<std::pair<ServerGame*, int>> flagged;
+    for (auto& entry : games) {
+        ServerGame& game = *entry.second;
+        if (!game.started) continue;
+        int side = game.position.sideToMove() == Color::White ? 0 : 1;
+        if (remainingMs(game, side) <= 0) {
+            flagged.emplace_back(&game, side);
+        }
+    }
+    for (auto& entry : flagged) {
+        finishGame(*entry.first, entry.second ^ 1, EndReason::Timeout, GameState::Playing);
+    }
+}
+
+void ServerWorker::send(ServerConnection* conn, const Frame& frame) {
+    if (conn->fd == -1) return;
+    frame.appendTo(conn->out);
+    markDirty(conn);
+}
+
+void ServerWorker::markDirty(ServerConnection* conn) {
+    if (conn->fd != -1 && !conn->dirty) {
+        conn->dirty = true;
+        dirtyConnections.push_back(conn);
+    }
+}
+
+void ServerWorker::broadcast(ServerGame& game, const Frame& frame) {
+    for (ServerConnection* player : game.players) {
+        if (player) send(player, frame);
+    }
+    game.snapshot.reset();
+    if (!game.spectators.empty()) publish(game, std::make_shared<const Frame>(frame));
+}
+
+// One encoded frame for every spectator. A spectator that has fallen
+// config.spectatorBacklog frames behind loses its backlog (except a frame
+// already partly sent) and catches up with a single snapshot once its socket drains.
+void ServerWorker::publish(ServerGame& game, const SharedFrame& frame) {
+    for (ServerConnection* spectator : game.spectators) {
+        if (spectator->needsSnapshot) continue;
+        if (spectator->feed.size() - spectator->feedHead >= config.spectatorBacklog) {
+            size_t keep = spectator->feedHead + (spectator->feedOffset > 0 ? 1 : 0);
+            spectator->feed.erase(spectator->feed.begin() + keep, spectator->feed.end());
+            spectator->needsSnapshot = true;
+            continue;
+        }
+        spectator->feed.push_back(frame);
+        markDirty(spectator);
+    }
+}
+
+// Output is coalesced per loop iteration: one send() per connection
+void ServerWorker::flushDirty() {
+    for (size_t i = 0; i < dirtyConnections.size(); i++) {
+        ServerConnection* conn = dirtyConnections[i];
+        conn->dirty = false;
+        if (conn->fd != -1 && !conn->writeBlocked && !flush(conn)) {
+            closeConnection(conn);
+        }
+    }
+    dirtyConnections.clear();
+}
+
+// Player output and the spectator feed leave in one scatter/gather write
+bool ServerWorker::flush(ServerConnection* conn) {
+    while (true) {
+        if (conn->needsSnapshot && conn->feedHead == conn->feed.size() && conn->watching) {
+            conn->feed.push_back(snapshotFrame(*conn->watching));
+            conn->needsSnapshot = false;
+        }
+        iovec parts[MaxGather];
+        int count = 0;
+        if (conn->outOffset < conn->out.size()) {
+            parts[count++] = { conn->out.data() + conn->outOffset, conn->out.size() - conn->outOffset };
+        }
+        for (size_t i = conn->feedHead; i < conn->feed.size() && count < MaxGather; i++) {
+            size_t skip = i == conn->feedHead ? conn->feedOffset : 0;
+            parts[count++] = { const_cast<uint8_t*>(conn->feed[i]->data) + skip, conn->feed[i]->size - skip };
+        }
+        if (count == 0) break;
+
+        msghdr message = {};
+        message.msg_iov = parts;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!conn->writeBlocked) {
+                conn->writeBlocked = true;
+                epoll_event ev = {};
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+                ev.data.ptr = conn;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+            }
+            // Sent frames are only cleared on a full drain; a spectator that
+            // never catches up would otherwise grow the feed forever
+            if (conn->feedHead >= std::max<size_t>(config.spectatorBacklog, 16)) {
+                conn->feed.erase(conn->feed.begin(), conn->feed.begin() + conn->feedHead);
+                conn->feedHead = 0;
+            }
+            return true;
+        }
+        if (sent <= 0) return false;
+
+        size_t done = std::min(size_t(sent), conn->out.size() - conn->outOffset);
+        conn->outOffset += done;
+        done = size_t(sent) - done;
+        while (done > 0) {
+            size_t left = conn->feed[conn->feedHead]->size - conn->feedOffset;
+            if (done < left) {
+                conn->feedOffset += done;
+                break;
+            }
+            done -= left;
+            conn->feed[conn->feedHead++].reset();
+            conn->feedOffset = 0;
+        }
+    }
+
+    conn->out.clear();
+    conn->outOffset = 0;
+    conn->feed.clear();
+    conn->feedHead = 0;
+    if (conn->writeBlocked) {
+        conn->writeBlocked = false;
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+    }
+    return true;
+}
+
+void ServerWorker::closeConnection(ServerConnection* conn) {
+    if (conn->fd == -1) return;
+    int fd = conn->fd;
+    leaveGame(conn);
+    unwatch(conn);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conn->fd = -1;
+    closing.push_back(conn);
+}
+
+GameServer::GameServer(const ServerConfig& config) : config(config) {
+}
+
+GameServer::~GameServer() {
+    stop();
+    workers.clear();
+    if (listenFd != -1) close(listenFd);
+    if (!config.unixPath.empty()) unlink(config.unixPath.c_str());
+}
+
+bool GameServer::start() {
+    if (!config.unixPath.empty()) {
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, config.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(config.unixPath.c_str());
+        if (listenFd == -1 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            std::cerr << "Failed to bind " << config.unixPath << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    else {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(uint16_t(config.port));
+        if (listenFd == -1 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            std::cerr << "Failed to bind port " << config.port << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    if (listen(listenFd, 4096) == -1) {
+        std::cerr << "listen failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < config.workers; i++) {
+        workers.push_back(std::make_unique<ServerWorker>(i, config, workers));
+    }
+    for (auto& worker : workers) {
+        if (!worker->start()) return false;
+    }
+    running = true;
+    return true;
+}
+
+// Accepted sockets go round-robin to workers; their first Join routes them to
+// the worker that owns the game
+void GameServer::run() {
+    size_t next = 0;
+    while (running) {
+        pollfd pfd = { listenFd, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0) continue;
+
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1) break;
+            if (config.unixPath.empty()) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            workers[next]->handOff(fd, {}, {});
+            next = (next + 1) % workers.size();
+        }
+    }
+}
+
+void GameServer::stop() {
+    running = false;
+    for (auto& worker : workers) {
+        worker->stop();
+    }
+}
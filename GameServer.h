@@ -0,0 +1,141 @@
+#pragma once
+#include "Position.h"
+#include "Protocol.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Headless multiplayer server: one epoll loop per worker thread, games
+// sharded by id so every game and its sockets are owned by a single thread.
+// Linux only (epoll, eventfd).
+
+struct ServerConfig {
+    int port = 5555;
+    std::string unixPath;          // listen on a Unix socket instead of TCP when set
+    int workers = 4;
+    uint32_t baseMs = 300000;
+    uint32_t incrementMs = 2000;
+    size_t spectatorBacklog = 64;  // frames queued for a spectator before it gets a snapshot instead
+    int spectatorSendBuffer = 0;   // SO_SNDBUF of spectator sockets in bytes, 0 = kernel default
+};
+
+struct ServerGame;
+
+// Frames fanned out to spectators are encoded once and shared by reference
+typedef std::shared_ptr<const Frame> SharedFrame;
+
+struct ServerConnection {
+    int fd = -1;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    size_t outOffset = 0;
+    bool dirty = false;            // queued output waiting for the end of the loop iteration
+    bool writeBlocked = false;     // EPOLLOUT registered
+    ServerGame* game = nullptr;
+    int color = -1;
+
+    // Spectators: shared frames, written after `out` with one sendmsg
+    ServerGame* watching = nullptr;
+    size_t spectatorIndex = 0;     // position in watching->spectators
+    std::vector<SharedFrame> feed;
+    size_t feedHead = 0;           // first frame not completely sent
+    size_t feedOffset = 0;         // bytes of it already sent
+    bool needsSnapshot = false;    // backlog dropped: the current state goes out next
+};
+
+struct ServerGame {
+    uint32_t id = 0;
+    Position position;
+    ServerConnection* players[2] = { nullptr, nullptr };
+    int64_t clockMs[2] = { 0, 0 };
+    std::chrono::steady_clock::time_point turnStart;
+    bool started = false;
+    std::vector<ServerConnection*> spectators;
+    SharedFrame snapshot;          // built on demand, dropped on every broadcast
+};
+
+class ServerWorker {
+public:
+    ServerWorker(int index, const ServerConfig& config, std::vector<std::unique_ptr<ServerWorker>>& shards);
+    ~ServerWorker();
+
+    bool start();
+    void stop();
+
+    // Thread-safe: adopt a socket, replaying bytes already read by another
+    // thread and sending output that thread could not write yet
+    void handOff(int fd, std::vector<uint8_t> buffered, std::vector<uint8_t> unsent);
+
+private:
+    struct HandOff {
+        int fd;
+        std::vector<uint8_t> buffered;
+        std::vector<uint8_t> unsent;
+    };
+
+    void run();
+    void drainHandOffs();
+    void adopt(HandOff& entry);
+    void onReadable(ServerConnection* conn);
+    void processInput(ServerConnection* conn);
+    bool handleFrame(ServerConnection* conn, const uint8_t* frame, size_t size);
+    void handleJoin(ServerConnection* conn, uint32_t gameId);
+    void handleMove(ServerConnection* conn, PackedMove move);
+    void handleResign(ServerConnection* conn);
+    void handleClockRequest(ServerConnection* conn);
+    void handleSpectate(ServerConnection* conn, uint32_t gameId);
+    void send(ServerConnection* conn, const Frame& frame);
+    void markDirty(ServerConnection* conn);
+    void broadcast(ServerGame& game, const Frame& frame);
+    void publish(ServerGame& game, const SharedFrame& frame);
+    SharedFrame snapshotFrame(ServerGame& game);
+    void unwatch(ServerConnection* conn);
+    void endSpectating(ServerGame& game, const Frame& last);
+    void flushDirty();
+    bool flush(ServerConnection* conn);
+    void closeConnection(ServerConnection* conn);
+    void leaveGame(ServerConnection* conn);
+    void finishGame(ServerGame& game, int winner, EndReason reason, GameState state);
+    void checkClocks();
+    int64_t remainingMs(const ServerGame& game, int color) const;
+
+    int index;
+    const ServerConfig& config;
+    std::vector<std::unique_ptr<ServerWorker>>& shards;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+
+    std::mutex handOffMutex;
+    std::vector<HandOff> handOffs;
+
+    std::unordered_map<ServerConnection*, std::unique_ptr<ServerConnection>> connections;
+    std::unordered_map<uint32_t, std::unique_ptr<ServerGame>> games;
+    std::vector<ServerConnection*> dirtyConnections;
+    std::vector<ServerConnection*> closing;
+};
+
+class GameServer {
+public:
+    explicit GameServer(const ServerConfig& config);
+    ~GameServer();
+
+    bool start();
+    void run();      // accept loop, returns after requestStop()
+    void requestStop() { running = false; }   // async-signal-safe
+    void stop();
+
+private:
+    ServerConfig config;
+    int listenFd = -1;
+    std::atomic<bool> running{ false };
+    std::vector<std::unique_ptr<ServerWorker>> workers;
+};
@@ -0,0 +1,211 @@
+#include "MateSolver.h"
+#include <algorithm>
+#include <chrono>
+
+static const uint32_t Infinite = 0xFFFFFFFFu;
+static const int BucketSize = 4;
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MateSolver::MateSolver(size_t megabytes) {
+    size_t buckets = 1;
+    while (buckets * 2 * BucketSize * sizeof(Entry) <= std::max<size_t>(1, megabytes) * 1024 * 1024) buckets *= 2;
+    table.resize(buckets * BucketSize);
+    bucketMask = buckets - 1;
+}
+
+void MateSolver::clear() {
+    std::fill(table.begin(), table.end(), Entry());
+}
+
+// The same position with a different number of plies left is a different problem
+uint64_t MateSolver::nodeKey(int depthLeft) const {
+    return pos.key() ^ (uint64_t(depthLeft + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+const MateSolver::Entry* MateSolver::find(uint64_t key) const {
+    const Entry* bucket = &table[(key & bucketMask) * BucketSize];
+    for (int i = 0; i < BucketSize; i++) {
+        if (bucket[i].key == key) return &bucket[i];
+    }
+    return nullptr;
+}
+
+// Keep the entries that cost the most to compute
+void MateSolver::store(uint64_t key, Numbers numbers, PackedMove best, uint64_t work) {
+    Entry* bucket = &table[(key & bucketMask) * BucketSize];
+    Entry* slot = &bucket[0];
+    for (int i = 0; i < BucketSize; i++) {
+        if (bucket[i].key == key) {
+            slot = &bucket[i];
+            break;
+        }
+        if (bucket[i].work < slot->work) slot = &bucket[i];
+    }
+    slot->key = key;
+    slot->phi = numbers.phi;
+    slot->delta = numbers.delta;
+    slot->work = uint32_t(std::min<uint64_t>(work, 0xFFFFFFFFu));
+    slot->best = best;
+}
+
+bool MateSolver::limitReached() {
+    if (aborted) return true;
+    if (nodeLimit && nodes >= nodeLimit) aborted = true;
+    if (timeLimitMs && (nodes & 1023) == 0 && (nowUs() - startUs) / 1000 >= timeLimitMs) aborted = true;
+    return aborted;
+}
+
+// Numbers of a position that has not been expanded yet. Odd plies left means
+// the attacker is to move.
+MateSolver::Numbers MateSolver::leafNumbers(int depthLeft) {
+    bool attacker = (depthLeft & 1) != 0;
+    Numbers failed = attacker ? Numbers{ Infinite, 0 } : Numbers{ 0, Infinite };
+    MoveList moves;
+    pos.generateLegal(moves);
+    // Checkmate is a loss for the side to move, whichever side that is
+    if (moves.empty()) return pos.inCheck() ? Numbers{ Infinite, 0 } : failed;
+    if (depthLeft == 0 || pos.isRepetition() || pos.isFiftyMoveDraw() || pos.hasInsufficientMaterial()) return failed;
+    // Fewer replies make the defender easier to refute
+    return attacker ? Numbers{ 1, 1 } : Numbers{ 1, uint32_t(moves.size()) };
+}
+
+// Multiple iterative deepening: expand the most proving child until this
+// node's numbers reach one of the thresholds
+MateSolver::Numbers MateSolver::mid(int depthLeft, uint32_t thPhi, uint32_t thDelta) {
+    uint64_t startNodes = nodes++;
+    uint64_t key = nodeKey(depthLeft);
+
+    MoveList moves;
+    pos.generateLegal(moves);
+    if (moves.empty() || depthLeft == 0) {
+        Numbers numbers = leafNumbers(depthLeft);
+        store(key, numbers, NullMove, 1);
+        return numbers;
+    }
+
+    Numbers children[256];
+    for (int i = 0; i < moves.size(); i++) {
+        pos.makeMove(moves[i]);
+        const Entry* entry = find(nodeKey(depthLeft - 1));
+        children[i] = entry ? Numbers{ entry->phi, entry->delta } : leafNumbers(depthLeft - 1);
+        pos.unmakeMove(moves[i]);
+    }
+
+    Numbers numbers;
+    PackedMove best = NullMove;
+    while (true) {
+        // phi = min child delta, delta = sum of child phi
+        int bestIndex = 0;
+        uint32_t secondDelta = Infinite;
+        numbers = { Infinite, 0 };
+        uint64_t sum = 0;
+        bool infiniteChild = false;
+        for (int i = 0; i < moves.size(); i++) {
+            if (children[i].delta < numbers.phi) {
+                secondDelta = numbers.phi;
+                numbers.phi = children[i].delta;
+                bestIndex = i;
+            }
+            else if (children[i].delta < secondDelta) {
+                secondDelta = children[i].delta;
+            }
+            if (children[i].phi == Infinite) infiniteChild = true;
+            sum += children[i].phi;
+        }
+        numbers.delta = infiniteChild ? Infinite : uint32_t(std::min<uint64_t>(sum, Infinite - 1));
+        best = moves[bestIndex];
+        if (numbers.phi >= thPhi || numbers.delta >= thDelta || limitReached()) break;
+
+        // The child may use the parent's remaining delta budget, and must give
+        // way once it is no longer clearly the best (1 + 1/4 slack against thrashing)
+        const Numbers& child = children[bestIndex];
+        uint64_t childThPhi = uint64_t(thDelta) - numbers.delta + child.phi;
+        uint64_t childThDelta = std::min<uint64_t>(thPhi, uint64_t(secondDelta) + secondDelta / 4 + 1);
+        pos.makeMove(best);
+        children[bestIndex] = mid(depthLeft - 1, uint32_t(std::min<uint64_t>(childThPhi, Infinite)),
+                                  uint32_t(std::min<uint64_t>(childThDelta, Infinite)));
+        pos.unmakeMove(best);
+    }
+
+    store(key, numbers, best, nodes - startNodes);
+    return numbers;
+}
+
+// Walks the proof tree: the attacker plays the stored proving move, the
+// defender the reply whose proof took the most work (the most stubborn one)
+void MateSolver::extractLine(int depthLeft, std::vector<PackedMove>& line) {
+    while (depthLeft > 0 && !aborted) {
+        MoveList moves;
+        pos.generateLegal(moves);
+        if (moves.empty()) break;
+
+        bool attacker = (depthLeft & 1) != 0;
+        PackedMove chosen = NullMove;
+        uint64_t chosenWork = 0;
+        const Entry* entry = find(nodeKey(depthLeft));
+        if (attacker && entry && entry->phi == 0 && entry->best != NullMove) {
+            chosen = entry->best;
+        }
+        if (chosen == NullMove) {
+            for (int i = 0; i < moves.size(); i++) {
+                pos.makeMove(moves[i]);
+                const Entry* childEntry = find(nodeKey(depthLeft - 1));
+                Numbers numbers;
+                uint64_t work;
+                if (childEntry) {
+                    numbers = { childEntry->phi, childEntry->delta };
+                    work = childEntry->work;
+                }
+                else {
+                    // Dropped from the table: prove the child again
+                    uint64_t before = nodes;
+                    numbers = mid(depthLeft - 1, Infinite, Infinite);
+                    work = nodes - before;
+                }
+                pos.unmakeMove(moves[i]);
+
+                // A proven child has pn 0: its delta when the defender moves there, its phi otherwise
+                bool proven = attacker ? numbers.delta == 0 : numbers.phi == 0;
+                if (!proven) continue;
+                if (chosen == NullMove || (attacker ? work < chosenWork : work > chosenWork)) {
+                    chosen = moves[i];
+                    chosenWork = work;
+                }
+            }
+        }
+        if (chosen == NullMove) break;
+        line.push_back(chosen);
+        pos.makeMove(chosen);
+        depthLeft--;
+    }
+    for (size_t i = line.size(); i-- > 0;) {
+        pos.unmakeMove(line[i]);
+    }
+}
+
+MateSolution MateSolver::solve(const Position& root, int moves) {
+    MateSolution solution;
+    pos = root;
+    pos.reserveHistory(root.gamePly() + 2 * moves + 2);
+    nodes = 0;
+    aborted = false;
+    startUs = nowUs();
+
+    int depthLeft = 2 * std::max(1, moves) - 1;
+    Numbers numbers = mid(depthLeft, Infinite, Infinite);
+    if (numbers.phi == 0) {
+        solution.result = MateResult::Proven;
+        extractLine(depthLeft, solution.line);
+    }
+    else if (numbers.delta == 0) {
+        solution.result = MateResult::Disproven;
+    }
+    solution.nodes = nodes;
+    solution.timeUs = nowUs() - startUs;
+    solution.timeMs = solution.timeUs / 1000;
+    return solution;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Position.h"
+#include <cstdint>
+#include <vector>
+
+enum class MateResult {
+    Proven, Disproven, Unknown     // Unknown: node or time limit reached first
+};
+
+struct MateSolution {
+    MateResult result = MateResult::Unknown;
+    std::vector<PackedMove> line;  // mating line when proven, attacker's move first
+    uint64_t nodes = 0;
+    int64_t timeMs = 0;
+    int64_t timeUs = 0;
+};
+
+// Depth-first proof-number search (df-pn) for "side to move mates within N
+// moves". Proof and disproof numbers live in the solver's own fixed-size
+// table, so memory use is bounded by the size given to the constructor.
+// A repetition or fifty-move draw counts as a failed attack: a proof is
+// always a real forced mate, a disproof can in rare cases be pessimistic.
+class MateSolver {
+public:
+    explicit MateSolver(size_t megabytes = 64);
+
+    void setNodeLimit(uint64_t nodes) { nodeLimit = nodes; }    // 0 = no limit
+    void setTimeLimit(int64_t ms) { timeLimitMs = ms; }          // 0 = no limit
+    void clear();
+
+    MateSolution solve(const Position& root, int moves);
+
+private:
+    // phi / delta are the proof numbers seen from the side to move: the
+    // attacker's (pn, dn) and the defender's (dn, pn)
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t phi = 0;
+        uint32_t delta = 0;
+        uint32_t work = 0;          // nodes spent below the entry, the replacement priority
+        PackedMove best = NullMove;
+    };
+    struct Numbers {
+        uint32_t phi;
+        uint32_t delta;
+    };
+
+    uint64_t nodeKey(int depthLeft) const;
+    const Entry* find(uint64_t key) const;
+    void store(uint64_t key, Numbers numbers, PackedMove best, uint64_t work);
+    Numbers leafNumbers(int depthLeft);
+    Numbers mid(int depthLeft, uint32_t thPhi, uint32_t thDelta);
+    void extractLine(int depthLeft, std::vector<PackedMove>& line);
+    bool limitReached();
+
+    std::vector<Entry> table;
+    size_t bucketMask = 0;
+    Position pos;
+    uint64_t nodes = 0;
+    uint64_t nodeLimit = 0;
+    int64_t timeLimitMs = 0;
+    int64_t startUs = 0;
+    bool aborted = false;
+};
@@ -0,0 +1,135 @@
+#include "MoveOrdering.h"
+#include "EvalParams.h"
+#include <algorithm>
+#include <cstring>
+
+// The king is never captured in an exchange, so its value only has to exceed the rest
+static const int SeeValue[7] = { 0, 20000, PieceValueMg[2], PieceValueMg[3], PieceValueMg[4], PieceValueMg[5], PieceValueMg[6] };
+
+int staticExchange(const Position& pos, PackedMove move) {
+    if (isCastlingMove(move)) return 0;
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    Color side = pos.colorAt(from);
+
+    Bitboard occ = pos.occupied() ^ squareBB(from);
+    int gain[32];
+    int depth = 0;
+    if (moveFlag(move) == FlagEnPassant) {
+        occ ^= squareBB(side == Color::White ? to - 8 : to + 8);
+        gain[0] = SeeValue[int(PieceType::Pawn)];
+    }
+    else {
+        gain[0] = SeeValue[int(pos.pieceAt(to))];
+    }
+    PieceType onTarget = pos.pieceAt(from);
+    if (isPromotionMove(move)) {
+        onTarget = promotionType(move);
+        gain[0] += SeeValue[int(onTarget)] - SeeValue[int(PieceType::Pawn)];
+    }
+
+    // Attackers are recomputed from the shrinking occupancy, which uncovers x-rays
+    const PieceType order[6] = { PieceType::Pawn, PieceType::Knight, PieceType::Bishop,
+                                 PieceType::Rook, PieceType::Queen, PieceType::King };
+    Bitboard attackers = pos.attackersTo(to, occ) & occ;
+    side = ~side;
+    while (depth < 31) {
+        depth++;
+        // Score if the piece now on the target is taken, used only if `side` can take it
+        gain[depth] = SeeValue[int(onTarget)] - gain[depth - 1];
+        if (std::max(-gain[depth - 1], gain[depth]) < 0) break;
+
+        Bitboard ours = attackers & pos.pieces(side);
+        if (!ours) break;
+        PieceType type = PieceType::None;
+        Bitboard fromSet = 0;
+        for (PieceType candidate : order) {
+            fromSet = ours & pos.pieces(side, candidate);
+            if (fromSet) {
+                type = candidate;
+                break;
+            }
+        }
+        // The king may only recapture when nothing defends the square any more
+        if (type == PieceType::King && (attackers & pos.pieces(~side))) break;
+
+        occ ^= fromSet & (0 - fromSet);
+        attackers = pos.attackersTo(to, occ) & occ;
+        onTarget = type;
+        side = ~side;
+    }
+    // Either side may stop capturing: back the result up the sequence
+    while (--depth) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    }
+    return gain[0];
+}
+
+void HistoryTables::clear() {
+    memset(butterfly, 0, sizeof(butterfly));
+    memset(counterMoves, 0, sizeof(counterMoves));
+    memset(continuation, 0, sizeof(continuation));
+}
+
+// Most valuable victim, least valuable attacker
+static int captureScore(const Position& pos, PackedMove move) {
+    int score = 0;
+    if (isCaptureMove(move)) {
+        PieceType victim = moveFlag(move) == FlagEnPassant ? PieceType::Pawn : pos.pieceAt(moveTo(move));
+        score += PieceValueMg[int(victim)] * 8 - PieceValueMg[int(pos.pieceAt(moveFrom(move)))] / 100;
+    }
+    if (isPromotionMove(move)) score += PieceValueMg[int(promotionType(move))];
+    return score;
+}
+
+void orderMoves(const Position& pos, MoveList& moves, int* scores, const OrderingContext& context) {
+    int features = context.features;
+    Color us = pos.sideToMove();
+    int c = us == Color::White ? 0 : 1;
+    for (int i = 0; i < moves.size(); i++) {
+        PackedMove move = moves[i];
+        if (move == context.ttMove) {
+            scores[i] = 1 << 30;
+        }
+        else if (isCaptureMove(move) || isPromotionMove(move)) {
+            bool losing = (features & OrderSee) && staticExchange(pos, move) < 0;
+            scores[i] = (losing ? LosingCaptureScore : 1 << 28) + captureScore(pos, move);
+        }
+        else if (context.killers && (features & OrderKillers) && move == context.killers[0]) {
+            scores[i] = (1 << 27) + 1;
+        }
+        else if (context.killers && (features & OrderKillers) && move == context.killers[1]) {
+            scores[i] = 1 << 27;
+        }
+        else if ((features & OrderCounterMoves) && move == context.counterMove) {
+            scores[i] = 1 << 26;
+        }
+        else {
+            int score = 0;
+            int from = moveFrom(move);
+            int to = moveTo(move);
+            if (context.history && (features & OrderHistory)) {
+                score += context.history->butterfly[c][from][to];
+            }
+            if (features & OrderContinuation) {
+                int piece = pieceIndex(us, pos.pieceAt(from)) * 64 + to;
+                for (const int16_t* row : context.continuation) {
+                    if (row) score += row[piece];
+                }
+            }
+            scores[i] = score;
+        }
+    }
+    // Insertion sort: stable, and the lists are short
+    for (int i = 1; i < moves.size(); i++) {
+        PackedMove move = moves[i];
+        int score = scores[i];
+        int j = i - 1;
+        for (; j >= 0 && scores[j] < score; j--) {
+            moves.moves[j + 1] = moves.moves[j];
+            scores[j + 1] = scores[j];
+        }
+        moves.moves[j + 1] = move;
+        scores[j + 1] = score;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Position.h"
+#include <cstdint>
+
+// Static exchange evaluation: material balance in centipawns of the capture
+// sequence on the move's target square, both sides always recapturing with
+// their least valuable attacker and free to stop. Pins are ignored.
+int staticExchange(const Position& pos, PackedMove move);
+
+// Move ordering features, each can be switched off to measure what it saves
+enum OrderingFeature {
+    OrderKillers = 1,
+    OrderCounterMoves = 2,
+    OrderHistory = 4,          // butterfly history [side][from][to]
+    OrderContinuation = 8,     // history of a move following the previous one / two moves
+    OrderSee = 16,             // losing captures after quiet moves, pruned in quiescence
+    OrderAll = 31
+};
+
+const int MaxHistory = 16384;
+
+// Piece of either colour as one index: colour * 7 + PieceType
+inline int pieceIndex(Color color, PieceType type) {
+    return (color == Color::White ? 0 : 7) + int(type);
+}
+
+// Learned quiet-move statistics of one search thread, kept between searches
+struct HistoryTables {
+    int16_t butterfly[2][64][64];
+    PackedMove counterMoves[14][64];              // reply to the previous move's [piece][to]
+    int16_t continuation[14][64][14][64];         // [previous piece][previous to][piece][to]
+
+    void clear();
+};
+
+// History gravity: bonuses shrink as the entry approaches MaxHistory
+inline void updateHistory(int16_t& entry, int bonus) {
+    int value = entry + bonus - entry * (bonus < 0 ? -bonus : bonus) / MaxHistory;
+    entry = int16_t(value);
+}
+
+inline int historyBonus(int depth) {
+    return depth > 13 ? 1600 : depth * depth * 8 + 32 * depth;
+}
+
+struct OrderingContext {
+    PackedMove ttMove = NullMove;
+    const PackedMove* killers = nullptr;          // two slots; nullptr in quiescence
+    PackedMove counterMove = NullMove;
+    const int16_t* continuation[2] = { nullptr, nullptr };  // [piece][to] rows for one and two plies back
+    const HistoryTables* history = nullptr;
+    int features = OrderAll;
+};
+
+// Losing captures sort below every other move; their keys start here
+const int LosingCaptureScore = -(1 << 24);
+
+inline bool isLosingCaptureScore(int score) { return score < LosingCaptureScore / 2; }
+
+// Hash move, winning and equal captures by MVV-LVA, killers, counter move,
+// quiet moves by history, then losing captures (only with OrderSee).
+// scores receives the sort key of each move in the sorted list.
+void orderMoves(const Position& pos, MoveList& moves, int* scores, const OrderingContext& context);
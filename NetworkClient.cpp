@@ -0,0 +1,56 @@
+#include "NetworkClient.h"
+#include <iostream>
+
+bool NetworkClient::connect(const std::string& host, unsigned short port) {
+    disconnect();
+    socket.setBlocking(true);
+    if (socket.connect(sf::IpAddress(host), port, sf::seconds(3)) != sf::Socket::Done) {
+        std::cerr << "Could not connect to " << host << ":" << port << std::endl;
+        return false;
+    }
+    connected = true;
+    return true;
+}
+
+void NetworkClient::disconnect() {
+    if (connected) {
+        socket.disconnect();
+    }
+    connected = false;
+    in.clear();
+}
+
+bool NetworkClient::send(const Frame& frame) {
+    if (!connected) return false;
+    socket.setBlocking(true);
+    if (socket.send(frame.data, frame.size) != sf::Socket::Done) {
+        std::cerr << "Lost connection to server" << std::endl;
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+// Frames that arrived before the server closed the connection are still delivered
+bool NetworkClient::poll(std::vector<uint8_t>& frame) {
+    if (connected) {
+        // Drain whatever has arrived without blocking the render loop
+        socket.setBlocking(false);
+        char buffer[4096];
+        std::size_t received = 0;
+        sf::Socket::Status status;
+        while ((status = socket.receive(buffer, sizeof(buffer), received)) == sf::Socket::Done) {
+            in.insert(in.end(), buffer, buffer + received);
+        }
+        if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+            std::cerr << "Disconnected from server" << std::endl;
+            connected = false;
+        }
+    }
+
+    std::size_t size = completeFrameSize(in.data(), in.size());
+    if (size == 0) return false;
+    frame.assign(in.begin(), in.begin() + size);
+    in.erase(in.begin(), in.begin() + size);
+    return true;
+}
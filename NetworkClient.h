@@ -0,0 +1,22 @@
+#pragma once
+#include <SFML/Network.hpp>
+#include <string>
+#include <vector>
+#include "Protocol.h"
+
+// Client side of the game server protocol for the SFML network mode
+class NetworkClient {
+public:
+    bool connect(const std::string& host, unsigned short port);
+    void disconnect();
+    bool isConnected() const { return connected; }
+    bool send(const Frame& frame);
+
+    // Copies the next complete frame into `frame`; false when none is available yet
+    bool poll(std::vector<uint8_t>& frame);
+
+private:
+    sf::TcpSocket socket;
+    std::vector<uint8_t> in;
+    bool connected = false;
+};
@@ -0,0 +1,181 @@
+#include "Pgn.h"
+#include <cctype>
+#include <cstring>
+
+std::string PgnGame::tag(const std::string& name) const {
+    for (const auto& entry : tags) {
+        if (entry.first == name) return entry.second;
+    }
+    return "";
+}
+
+void PgnGame::setTag(const std::string& name, const std::string& value) {
+    for (auto& entry : tags) {
+        if (entry.first == name) {
+            entry.second = value;
+            return;
+        }
+    }
+    tags.emplace_back(name, value);
+}
+
+static bool isResultToken(const std::string& token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool readPgnGame(std::istream& in, PgnGame& game, int maxPlies) {
+    game = PgnGame();
+    std::string line;
+
+    // Tag section: skip blank lines before it, stop at the first movetext line
+    bool sawTags = false;
+    std::string movetext;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            if (sawTags) break;
+            continue;
+        }
+        if (line[first] != '[') {
+            movetext = line;
+            break;
+        }
+        sawTags = true;
+        size_t space = line.find(' ', first);
+        size_t open = line.find('"', first);
+        size_t close = line.rfind('"');
+        if (space == std::string::npos || open == std::string::npos || close <= open) continue;
+        game.setTag(line.substr(first + 1, space - first - 1), line.substr(open + 1, close - open - 1));
+    }
+    if (!sawTags && movetext.empty()) return false;
+
+    // Movetext runs until a blank line after some text
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos) {
+            if (!movetext.empty()) break;
+            continue;
+        }
+        movetext += "\n" + line;
+    }
+
+    Position pos;
+    std::string fen = game.tag("FEN");
+    if (!fen.empty() && pos.setFromFen(fen)) {
+        game.fen = fen;
+    }
+    else {
+        pos.setStartPosition();
+    }
+
+    bool valid = true;
+    int commentDepth = 0, variationDepth = 0;
+    size_t i = 0;
+    while (i < movetext.size()) {
+        char c = movetext[i];
+        if (c == '{') {
+            commentDepth++;
+            i++;
+            continue;
+        }
+        if (c == '}') {
+            if (commentDepth > 0) commentDepth--;
+            i++;
+            continue;
+        }
+        if (commentDepth > 0) {
+            i++;
+            continue;
+        }
+        if (c == ';') {
+            while (i < movetext.size() && movetext[i] != '\n') i++;
+            continue;
+        }
+        if (c == '(') {
+            variationDepth++;
+            i++;
+            continue;
+        }
+        if (c == ')') {
+            if (variationDepth > 0) variationDepth--;
+            i++;
+            continue;
+        }
+        if (isspace((unsigned char)c)) {
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < movetext.size() && !isspace((unsigned char)movetext[i])
+               && !strchr("{}();", movetext[i])) {
+            i++;
+        }
+        std::string token = movetext.substr(start, i - start);
+        if (variationDepth > 0 || token[0] == '$') continue;
+        if (isResultToken(token)) {
+            game.result = token;
+            continue;
+        }
+
+        // "12." / "12..." prefixes, possibly glued to the move
+        size_t digits = 0;
+        while (digits < token.size() && isdigit((unsigned char)token[digits])) digits++;
+        if (digits > 0 && digits < token.size() && token[digits] == '.') {
+            token.erase(0, token.find_first_not_of('.', digits));
+            if (token.find_first_not_of('.') == std::string::npos) continue;
+        }
+        else if (digits == token.size()) {
+            continue;
+        }
+
+        if (!valid || int(game.moves.size()) == maxPlies) continue;
+        PackedMove move = pos.parseSanMove(token);
+        if (move == NullMove) {
+            valid = false;
+            continue;
+        }
+        pos.makeMove(move);
+        game.moves.push_back(move);
+    }
+
+    if (game.tag("Result").empty()) game.setTag("Result", game.result);
+    return true;
+}
+
+void writePgnGame(std::ostream& out, const PgnGame& game) {
+    for (const auto& entry : game.tags) {
+        out << "[" << entry.first << " \"" << entry.second << "\"]\n";
+    }
+    out << "\n";
+
+    Position pos;
+    pos.setFromFen(game.fen);
+    std::string line;
+    for (size_t i = 0; i < game.moves.size(); i++) {
+        PackedMove move = game.moves[i];
+        std::string token;
+        if (pos.sideToMove() == Color::White) {
+            token = std::to_string(pos.fullmoveNumber()) + ". ";
+        }
+        else if (i == 0) {
+            token = std::to_string(pos.fullmoveNumber()) + "... ";
+        }
+        token += pos.moveToSan(move);
+        pos.makeMove(move);
+
+        if (!line.empty() && line.size() + 1 + token.size() > 79) {
+            out << line << "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + token;
+    }
+    std::string result = game.tag("Result").empty() ? game.result : game.tag("Result");
+    if (!line.empty() && line.size() + 1 + result.size() > 79) {
+        out << line << "\n";
+        line.clear();
+    }
+    line += (line.empty() ? "" : " ") + result;
+    out << line << "\n\n";
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "Position.h"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal PGN reader / writer on top of the rules core: tag pairs and the main
+// line only (comments, variations, NAGs and move numbers are skipped)
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::string fen = Position::StartFen;
+    std::vector<PackedMove> moves;
+    std::string result = "*";
+
+    std::string tag(const std::string& name) const;
+    void setTag(const std::string& name, const std::string& value);
+};
+
+// Reads the next game; false at end of input. Movetext stops at the first
+// move that is not legal in the replayed position, or after maxPlies moves
+// (-1 = all): the rest is skipped without parsing the SAN.
+bool readPgnGame(std::istream& in, PgnGame& game, int maxPlies = -1);
+void writePgnGame(std::ostream& out, const PgnGame& game);
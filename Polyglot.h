@@ -0,0 +1,43 @@
+#pragma once
+#include "Position.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Polyglot opening book format: 16-byte big-endian entries sorted by key,
+//   key u64, move u16, weight u16, learn u32
+// Moves: to file/rank in bits 0-5, from file/rank in bits 6-11, promotion
+// piece (1 knight .. 4 queen) in bits 12-14; castling is king takes rook.
+//
+// Polyglot keys hash the position with the format's published table of 781
+// random numbers, which is built in. loadRandom replaces it with one read from
+// a text file (the Random64 array of the Polyglot sources can be used as is).
+
+const int PolyglotRandomCount = 781;
+const size_t PolyglotEntrySize = 16;
+
+struct PolyglotEntry {
+    uint64_t key = 0;
+    uint16_t move = 0;
+    uint16_t weight = 0;
+    uint32_t learn = 0;
+};
+
+class BookHasher {
+public:
+    BookHasher();
+
+    // Every 0x literal in the file, in order; false unless there are 781
+    bool loadRandom(const std::string& path);
+    uint64_t key(const Position& pos) const;
+
+private:
+    std::vector<uint64_t> random;
+};
+
+uint16_t toPolyglotMove(PackedMove move);
+PackedMove fromPolyglotMove(const Position& pos, uint16_t move);   // NullMove unless legal
+std::string polyglotMoveToUci(uint16_t move);
+
+void writePolyglotEntry(uint8_t* out, const PolyglotEntry& entry);
+PolyglotEntry readPolyglotEntry(const uint8_t* in);
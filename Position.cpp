@@ -0,0 +1,896 @@
+#include "Position.h"
+#include <sstream>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+const char* Position::StartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Keys and castling masks are generated by the compiler; xorshift64* with a
+// fixed seed so keys are identical between runs and builds
+struct ZobristKeys {
+    uint64_t piece[2][7][64] = {};
+    uint64_t castling[16] = {};
+    uint64_t enPassant[8] = {};
+    uint64_t side = 0;
+    int castlingMask[64] = {};  // rights that survive a move touching the square
+};
+
+constexpr uint64_t nextZobrist(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+constexpr ZobristKeys buildZobristKeys() {
+    ZobristKeys keys;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int c = 0; c < 2; c++)
+        for (int t = 0; t < 7; t++)
+            for (int sq = 0; sq < 64; sq++)
+                keys.piece[c][t][sq] = nextZobrist(state);
+    for (int i = 0; i < 16; i++) keys.castling[i] = nextZobrist(state);
+    for (int i = 0; i < 8; i++) keys.enPassant[i] = nextZobrist(state);
+    keys.side = nextZobrist(state);
+
+    for (int sq = 0; sq < 64; sq++) keys.castlingMask[sq] = 15;
+    keys.castlingMask[makeSquare(4, 0)] &= ~(WhiteKingside | WhiteQueenside);
+    keys.castlingMask[makeSquare(7, 0)] &= ~WhiteKingside;
+    keys.castlingMask[makeSquare(0, 0)] &= ~WhiteQueenside;
+    keys.castlingMask[makeSquare(4, 7)] &= ~(BlackKingside | BlackQueenside);
+    keys.castlingMask[makeSquare(7, 7)] &= ~BlackKingside;
+    keys.castlingMask[makeSquare(0, 7)] &= ~BlackQueenside;
+    return keys;
+}
+
+static constexpr ZobristKeys Zobrist = buildZobristKeys();
+static constexpr const uint64_t (&zobristPiece)[2][7][64] = Zobrist.piece;
+static constexpr const uint64_t (&zobristCastling)[16] = Zobrist.castling;
+static constexpr const uint64_t (&zobristEnPassant)[8] = Zobrist.enPassant;
+static constexpr const uint64_t& zobristSide = Zobrist.side;
+static constexpr const int (&castlingMask)[64] = Zobrist.castlingMask;
+
+// Per-colour constants for the templated generators and make/unmake
+template <Color Us> constexpr int colorIndexOf() { return Us == Color::White ? 0 : 1; }
+template <Color Us> constexpr int pawnPush() { return Us == Color::White ? 8 : -8; }
+template <Color Us> constexpr Bitboard pushPawns(Bitboard b) { return Us == Color::White ? b << 8 : b >> 8; }
+template <Color Us> constexpr Bitboard promotionRankBB() { return Us == Color::White ? Rank8BB : Rank1BB; }
+template <Color Us> constexpr Bitboard doublePushRankBB() { return Us == Color::White ? Rank1BB << 8 : Rank1BB << 48; }
+template <Color Us> constexpr int kingHome() { return Us == Color::White ? makeSquare(4, 0) : makeSquare(4, 7); }
+template <Color Us> constexpr int kingsideRight() { return Us == Color::White ? WhiteKingside : BlackKingside; }
+template <Color Us> constexpr int queensideRight() { return Us == Color::White ? WhiteQueenside : BlackQueenside; }
+
+Position::Position() {
+    history.reserve(1024);
+    setStartPosition();
+}
+
+void Position::clear() {
+    for (int c = 0; c < 2; c++) {
+        byColor[c] = 0;
+        for (int t = 0; t < 7; t++) {
+            byType[c][t] = 0;
+            counts[c][t] = 0;
+        }
+    }
+    for (int sq = 0; sq < 64; sq++) squares[sq] = PieceType::None;
+    side = Color::White;
+    castling = 0;
+    enPassant = -1;
+    halfmoves = 0;
+    pliesFromNull = 0;
+    fullmoves = 1;
+    zobristKey = 0;
+    history.clear();
+}
+
+void Position::setStartPosition() {
+    setFromFen(StartFen);
+}
+
+void Position::putPiece(int sq, PieceType type, Color color) {
+    int c = colorIndex(color);
+    byType[c][(int)type] |= squareBB(sq);
+    byColor[c] |= squareBB(sq);
+    squares[sq] = type;
+    counts[c][(int)type]++;
+    zobristKey ^= zobristPiece[c][(int)type][sq];
+}
+
+void Position::removePiece(int sq) {
+    int c = (byColor[1] & squareBB(sq)) ? 1 : 0;
+    PieceType type = squares[sq];
+    byType[c][(int)type] &= ~squareBB(sq);
+    byColor[c] &= ~squareBB(sq);
+    squares[sq] = PieceType::None;
+    counts[c][(int)type]--;
+    zobristKey ^= zobristPiece[c][(int)type][sq];
+}
+
+void Position::movePieceBB(int from, int to) {
+    int c = (byColor[1] & squareBB(from)) ? 1 : 0;
+    PieceType type = squares[from];
+    Bitboard fromTo = squareBB(from) | squareBB(to);
+    byType[c][(int)type] ^= fromTo;
+    byColor[c] ^= fromTo;
+    squares[to] = type;
+    squares[from] = PieceType::None;
+    zobristKey ^= zobristPiece[c][(int)type][from] ^ zobristPiece[c][(int)type][to];
+}
+
+// Only record an en passant square the side to move could actually use, so
+// repetition keys do not depend on a phantom capture
+bool Position::canCaptureEnPassant(int sq) const {
+    return (pawnAttacks[colorIndex(~side)][sq] & pieces(side, PieceType::Pawn)) != 0;
+}
+
+void Position::setEnPassant(int sq) {
+    if (enPassant != -1) zobristKey ^= zobristEnPassant[squareCol(enPassant)];
+    enPassant = (sq != -1 && canCaptureEnPassant(sq)) ? sq : -1;
+    if (enPassant != -1) zobristKey ^= zobristEnPassant[squareCol(enPassant)];
+}
+
+bool Position::setFromFen(const std::string& fen) {
+    clear();
+    std::istringstream in(fen);
+    std::string placement, sideStr, castlingStr = "-", epStr = "-";
+    in >> placement >> sideStr >> castlingStr >> epStr >> halfmoves >> fullmoves;
+    if (placement.empty()) return false;
+
+    int row = 7, col = 0;
+    for (char ch : placement) {
+        if (ch == '/') {
+            row--;
+            col = 0;
+        }
+        else if (isdigit((unsigned char)ch)) {
+            col += ch - '0';
+        }
+        else {
+            PieceType type = PieceType::None;
+            switch (tolower(ch)) {
+            case 'k': type = PieceType::King; break;
+            case 'q': type = PieceType::Queen; break;
+            case 'r': type = PieceType::Rook; break;
+            case 'b': type = PieceType::Bishop; break;
+            case 'n': type = PieceType::Knight; break;
+            case 'p': type = PieceType::Pawn; break;
+            default: return false;
+            }
+            if (row < 0 || col > 7) return false;
+            putPiece(makeSquare(col, row), type, isupper((unsigned char)ch) ? Color::White : Color::Black);
+            col++;
+        }
+    }
+    if (pieceCount(Color::White, PieceType::King) != 1 || pieceCount(Color::Black, PieceType::King) != 1) return false;
+
+    side = (sideStr == "b") ? Color::Black : Color::White;
+    if (side == Color::Black) zobristKey ^= zobristSide;
+
+    for (char ch : castlingStr) {
+        switch (ch) {
+        case 'K': castling |= WhiteKingside; break;
+        case 'Q': castling |= WhiteQueenside; break;
+        case 'k': castling |= BlackKingside; break;
+        case 'q': castling |= BlackQueenside; break;
+        default: break;
+        }
+    }
+    // Drop rights the piece placement cannot support
+    if (!(pieces(Color::White, PieceType::King) & squareBB(makeSquare(4, 0)))) castling &= ~(WhiteKingside | WhiteQueenside);
+    if (!(pieces(Color::Black, PieceType::King) & squareBB(makeSquare(4, 7)))) castling &= ~(BlackKingside | BlackQueenside);
+    if (!(pieces(Color::White, PieceType::Rook) & squareBB(makeSquare(7, 0)))) castling &= ~WhiteKingside;
+    if (!(pieces(Color::White, PieceType::Rook) & squareBB(makeSquare(0, 0)))) castling &= ~WhiteQueenside;
+    if (!(pieces(Color::Black, PieceType::Rook) & squareBB(makeSquare(7, 7)))) castling &= ~BlackKingside;
+    if (!(pieces(Color::Black, PieceType::Rook) & squareBB(makeSquare(0, 7)))) castling &= ~BlackQueenside;
+    zobristKey ^= zobristCastling[castling];
+
+    if (epStr.size() == 2 && epStr[0] >= 'a' && epStr[0] <= 'h' && epStr[1] >= '1' && epStr[1] <= '8') {
+        setEnPassant(makeSquare(epStr[0] - 'a', epStr[1] - '1'));
+    }
+    if (fullmoves < 1) fullmoves = 1;
+    return true;
+}
+
+PositionSnapshot Position::snapshot() const {
+    PositionSnapshot snapshot = {};
+    for (int sq = 0; sq < 64; sq++) {
+        int code = squares[sq] == PieceType::None ? 0 : colorIndex(colorAt(sq)) * 8 + (int)squares[sq];
+        snapshot.squares[sq / 2] |= uint8_t(code << (sq & 1) * 4);
+    }
+    snapshot.side = uint8_t(colorIndex(side));
+    snapshot.castlingRights = uint8_t(castling);
+    snapshot.epSquare = int8_t(enPassant);
+    snapshot.halfmoveClock = uint16_t(halfmoves);
+    snapshot.fullmoveNumber = uint16_t(fullmoves);
+    return snapshot;
+}
+
+void Position::restore(const PositionSnapshot& snapshot, const uint64_t* previousKeys, int count) {
+    clear();
+    for (int sq = 0; sq < 64; sq++) {
+        int code = (snapshot.squares[sq / 2] >> (sq & 1) * 4) & 15;
+        if (code) putPiece(sq, PieceType(code & 7), code & 8 ? Color::Black : Color::White);
+    }
+    side = snapshot.side ? Color::Black : Color::White;
+    if (side == Color::Black) zobristKey ^= zobristSide;
+    castling = snapshot.castlingRights;
+    zobristKey ^= zobristCastling[castling];
+    // Stored as it was: already checked for a capturing pawn
+    enPassant = snapshot.epSquare;
+    if (enPassant != -1) zobristKey ^= zobristEnPassant[squareCol(enPassant)];
+    halfmoves = snapshot.halfmoveClock;
+    fullmoves = snapshot.fullmoveNumber;
+
+    // Only the keys are read back from these entries
+    for (int i = 0; i < count; i++) {
+        StateInfo st = {};
+        st.key = previousKeys[i];
+        st.epSquare = -1;
+        st.captured = PieceType::None;
+        history.push_back(st);
+    }
+    pliesFromNull = count;
+}
+
+std::string Position::toFen() const {
+    std::string fen;
+    for (int row = 7; row >= 0; row--) {
+        int empty = 0;
+        for (int col = 0; col < 8; col++) {
+            int sq = makeSquare(col, row);
+            if (squares[sq] == PieceType::None) {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                fen += char('0' + empty);
+                empty = 0;
+            }
+            const char* letters = " kqrbnp";
+            char ch = letters[(int)squares[sq]];
+            fen += colorAt(sq) == Color::White ? char(toupper(ch)) : ch;
+        }
+        if (empty) fen += char('0' + empty);
+        if (row > 0) fen += '/';
+    }
+    fen += side == Color::White ? " w " : " b ";
+    std::string rights;
+    if (castling & WhiteKingside) rights += 'K';
+    if (castling & WhiteQueenside) rights += 'Q';
+    if (castling & BlackKingside) rights += 'k';
+    if (castling & BlackQueenside) rights += 'q';
+    fen += rights.empty() ? "-" : rights;
+    fen += " " + (enPassant == -1 ? std::string("-") : squareName(enPassant));
+    fen += " " + std::to_string(halfmoves) + " " + std::to_string(fullmoves);
+    return fen;
+}
+
+Bitboard Position::attackersTo(int sq, Bitboard occ) const {
+    return (pawnAttacks[1][sq] & byType[0][(int)PieceType::Pawn])
+         | (pawnAttacks[0][sq] & byType[1][(int)PieceType::Pawn])
+         | (knightAttacks[sq] & (byType[0][(int)PieceType::Knight] | byType[1][(int)PieceType::Knight]))
+         | (kingAttacks[sq] & (byType[0][(int)PieceType::King] | byType[1][(int)PieceType::King]))
+         | (bishopAttacks(sq, occ) & (byType[0][(int)PieceType::Bishop] | byType[1][(int)PieceType::Bishop]
+                                    | byType[0][(int)PieceType::Queen] | byType[1][(int)PieceType::Queen]))
+         | (rookAttacks(sq, occ) & (byType[0][(int)PieceType::Rook] | byType[1][(int)PieceType::Rook]
+                                  | byType[0][(int)PieceType::Queen] | byType[1][(int)PieceType::Queen]));
+}
+
+bool Position::isSquareAttacked(int sq, Color byColor) const {
+    return isSquareAttacked(sq, byColor, occupied());
+}
+
+bool Position::isSquareAttacked(int sq, Color byColor, Bitboard occ) const {
+    return byColor == Color::White ? isSquareAttackedBy<Color::White>(sq, occ)
+                                   : isSquareAttackedBy<Color::Black>(sq, occ);
+}
+
+template <Color By>
+bool Position::isSquareAttackedBy(int sq, Bitboard occ) const {
+    constexpr int c = colorIndexOf<By>();
+    if (pawnAttacks[c ^ 1][sq] & byType[c][(int)PieceType::Pawn]) return true;
+    if (knightAttacks[sq] & byType[c][(int)PieceType::Knight]) return true;
+    if (kingAttacks[sq] & byType[c][(int)PieceType::King]) return true;
+    Bitboard queens = byType[c][(int)PieceType::Queen];
+    if (bishopAttacks(sq, occ) & (byType[c][(int)PieceType::Bishop] | queens)) return true;
+    if (rookAttacks(sq, occ) & (byType[c][(int)PieceType::Rook] | queens)) return true;
+    return false;
+}
+
+bool Position::inCheck() const {
+    return isSquareAttacked(kingSquare(side), ~side);
+}
+
+static void addPawnMoves(MoveList& list, int from, int to, bool capture, bool promotion) {
+    if (promotion) {
+        int base = capture ? FlagPromotionCapture : FlagPromotion;
+        for (int piece = 3; piece >= 0; piece--) {
+            list.add(packMove(from, to, base + piece));
+        }
+    }
+    else {
+        list.add(packMove(from, to, capture ? FlagCapture : FlagQuiet));
+    }
+}
+
+void Position::generatePseudoLegal(MoveList& list) const {
+    if (side == Color::White) generatePseudoLegalFor<Color::White>(list);
+    else generatePseudoLegalFor<Color::Black>(list);
+}
+
+template <Color Us>
+void Position::generatePseudoLegalFor(MoveList& list) const {
+    constexpr Color us = Us;
+    constexpr Color them = ~Us;
+    constexpr int c = colorIndexOf<Us>();
+    Bitboard own = pieces(us);
+    Bitboard enemies = pieces(them);
+    Bitboard occ = own | enemies;
+    Bitboard empty = ~occ;
+
+    // Pawns
+    Bitboard pawns = pieces(us, PieceType::Pawn);
+    constexpr int push = pawnPush<Us>();
+    constexpr Bitboard promotionRank = promotionRankBB<Us>();
+    Bitboard singles = pushPawns<Us>(pawns) & empty;
+    Bitboard doubles = pushPawns<Us>(singles & pushPawns<Us>(doublePushRankBB<Us>())) & empty;
+    while (singles) {
+        int to = popLsb(singles);
+        addPawnMoves(list, to - push, to, false, (squareBB(to) & promotionRank) != 0);
+    }
+    while (doubles) {
+        int to = popLsb(doubles);
+        list.add(packMove(to - 2 * push, to, FlagDoublePush));
+    }
+    Bitboard capturers = pawns;
+    while (capturers) {
+        int from = popLsb(capturers);
+        Bitboard targets = pawnAttacks[c][from] & enemies;
+        while (targets) {
+            int to = popLsb(targets);
+            addPawnMoves(list, from, to, true, (squareBB(to) & promotionRank) != 0);
+        }
+    }
+    if (enPassant != -1) {
+        Bitboard epPawns = pawnAttacks[c ^ 1][enPassant] & pawns;
+        while (epPawns) {
+            list.add(packMove(popLsb(epPawns), enPassant, FlagEnPassant));
+        }
+    }
+
+    // Pieces
+    const PieceType pieceTypes[5] = { PieceType::Knight, PieceType::Bishop, PieceType::Rook, PieceType::Queen, PieceType::King };
+    for (PieceType type : pieceTypes) {
+        Bitboard movers = pieces(us, type);
+        while (movers) {
+            int from = popLsb(movers);
+            Bitboard targets = 0;
+            switch (type) {
+            case PieceType::Knight: targets = knightAttacks[from]; break;
+            case PieceType::Bishop: targets = bishopAttacks(from, occ); break;
+            case PieceType::Rook:   targets = rookAttacks(from, occ); break;
+            case PieceType::Queen:  targets = queenAttacks(from, occ); break;
+            case PieceType::King:   targets = kingAttacks[from]; break;
+            default: break;
+            }
+            targets &= ~own;
+            while (targets) {
+                int to = popLsb(targets);
+                list.add(packMove(from, to, (squareBB(to) & enemies) ? FlagCapture : FlagQuiet));
+            }
+        }
+    }
+
+    // Castling: squares between king and rook empty, king not in or passing through check
+    constexpr int kingside = kingsideRight<Us>();
+    constexpr int queenside = queensideRight<Us>();
+    constexpr int kingFrom = kingHome<Us>();
+    if ((castling & (kingside | queenside)) && !isSquareAttackedBy<them>(kingFrom, occ)) {
+        if ((castling & kingside)
+            && !(occ & (squareBB(kingFrom + 1) | squareBB(kingFrom + 2)))
+            && !isSquareAttackedBy<them>(kingFrom + 1, occ) && !isSquareAttackedBy<them>(kingFrom + 2, occ)) {
+            list.add(packMove(kingFrom, kingFrom + 2, FlagKingCastle));
+        }
+        if ((castling & queenside)
+            && !(occ & (squareBB(kingFrom - 1) | squareBB(kingFrom - 2) | squareBB(kingFrom - 3)))
+            && !isSquareAttackedBy<them>(kingFrom - 1, occ) && !isSquareAttackedBy<them>(kingFrom - 2, occ)) {
+            list.add(packMove(kingFrom, kingFrom - 2, FlagQueenCastle));
+        }
+    }
+}
+
+bool Position::isLegal(PackedMove move) {
+    Color us = side;
+    makeMove(move);
+    bool legal = !isSquareAttacked(kingSquare(us), ~us);
+    unmakeMove(move);
+    return legal;
+}
+
+void Position::generateLegalReference(MoveList& list) const {
+    MoveList pseudo;
+    generatePseudoLegal(pseudo);
+    Position& self = const_cast<Position&>(*this);
+    for (PackedMove move : pseudo) {
+        if (self.isLegal(move)) {
+            list.add(move);
+        }
+    }
+}
+
+template <GenType Type>
+void Position::generateLegal(MoveList& list) const {
+    if (side == Color::White) generateLegalFor<Color::White, Type>(list);
+    else generateLegalFor<Color::Black, Type>(list);
+}
+
+// Strictly legal generation: checkers, the check-evasion mask and pinned
+// pieces are computed once, so only king moves and en passant need an attack test.
+// Side and move class are template arguments, so the colour branches and the
+// capture / quiet filters fold away at compile time
+template <Color Us, GenType Type>
+void Position::generateLegalFor(MoveList& list) const {
+    constexpr Color us = Us;
+    constexpr Color them = ~Us;
+    constexpr int c = colorIndexOf<Us>();
+    int ksq = kingSquare(us);
+    Bitboard own = pieces(us);
+    Bitboard enemies = pieces(them);
+    Bitboard occ = own | enemies;
+    Bitboard checkers = attackersTo(ksq, occ) & enemies;
+
+    // Destinations the requested move class allows for piece moves
+    Bitboard classMask = Type == GenCaptures ? enemies : Type == GenQuiets ? ~occ : ~own;
+
+    // King: target squares must stay safe once the king has left its square
+    Bitboard kingTargets = kingAttacks[ksq] & classMask;
+    Bitboard occWithoutKing = occ ^ squareBB(ksq);
+    while (kingTargets) {
+        int to = popLsb(kingTargets);
+        if (!isSquareAttackedBy<them>(to, occWithoutKing)) {
+            list.add(packMove(ksq, to, (squareBB(to) & enemies) ? FlagCapture : FlagQuiet));
+        }
+    }
+
+    // Double check: only the king may move
+    if (popCount(checkers) > 1) return;
+
+    // Single check: capture the checker or block between it and the king
+    Bitboard checkMask = ~Bitboard(0);
+    if (checkers) {
+        checkMask = checkers | betweenBB[ksq][lsb(checkers)];
+    }
+
+    // Own pieces alone between the king and an enemy slider are pinned to that line
+    Bitboard pinned = 0;
+    Bitboard enemyQueens = pieces(them, PieceType::Queen);
+    Bitboard snipers = (rookAttacks(ksq, 0) & (pieces(them, PieceType::Rook) | enemyQueens))
+                     | (bishopAttacks(ksq, 0) & (pieces(them, PieceType::Bishop) | enemyQueens));
+    while (snipers) {
+        Bitboard blockers = betweenBB[ksq][popLsb(snipers)] & occ;
+        if (popCount(blockers) == 1) {
+            pinned |= blockers & own;
+        }
+    }
+
+    // Pawns: promotions belong to the capture class, so quiet generation
+    // only pushes to non-promotion squares
+    constexpr int push = pawnPush<Us>();
+    constexpr Bitboard promotionRank = promotionRankBB<Us>();
+    constexpr Bitboard doublePushRank = doublePushRankBB<Us>();
+    Bitboard pawns = pieces(us, PieceType::Pawn);
+    while (pawns) {
+        int from = popLsb(pawns);
+        Bitboard allowed = checkMask;
+        if (pinned & squareBB(from)) allowed &= lineBB[ksq][from];
+
+        int to = from + push;
+        if (!(occ & squareBB(to))) {
+            bool promotion = (squareBB(to) & promotionRank) != 0;
+            if ((allowed & squareBB(to)) && (Type == GenAll || (Type == GenCaptures) == promotion)) {
+                addPawnMoves(list, from, to, false, promotion);
+            }
+            if (Type != GenCaptures && (squareBB(from) & doublePushRank)
+                && !(occ & squareBB(to + push)) && (allowed & squareBB(to + push))) {
+                list.add(packMove(from, to + push, FlagDoublePush));
+            }
+        }
+        if (Type != GenQuiets) {
+            Bitboard targets = pawnAttacks[c][from] & enemies & allowed;
+            while (targets) {
+                int target = popLsb(targets);
+                addPawnMoves(list, from, target, true, (squareBB(target) & promotionRank) != 0);
+            }
+        }
+    }
+
+    // En passant removes two pawns from one rank, so test the resulting occupancy directly
+    if (Type != GenQuiets && enPassant != -1) {
+        int capSq = enPassant - push;
+        Bitboard epPawns = pawnAttacks[c ^ 1][enPassant] & pieces(us, PieceType::Pawn);
+        while (epPawns) {
+            int from = popLsb(epPawns);
+            Bitboard after = (occ ^ squareBB(from) ^ squareBB(capSq)) | squareBB(enPassant);
+            bool exposed = (rookAttacks(ksq, after) & (pieces(them, PieceType::Rook) | enemyQueens))
+                        || (bishopAttacks(ksq, after) & (pieces(them, PieceType::Bishop) | enemyQueens))
+                        || (checkers & ~squareBB(capSq) & (pieces(them, PieceType::Knight) | pieces(them, PieceType::Pawn)));
+            if (!exposed) {
+                list.add(packMove(from, enPassant, FlagEnPassant));
+            }
+        }
+    }
+
+    // Knights, bishops, rooks, queens
+    const PieceType pieceTypes[4] = { PieceType::Knight, PieceType::Bishop, PieceType::Rook, PieceType::Queen };
+    for (PieceType type : pieceTypes) {
+        Bitboard movers = pieces(us, type);
+        while (movers) {
+            int from = popLsb(movers);
+            Bitboard targets = 0;
+            switch (type) {
+            case PieceType::Knight: targets = knightAttacks[from]; break;
+            case PieceType::Bishop: targets = bishopAttacks(from, occ); break;
+            case PieceType::Rook:   targets = rookAttacks(from, occ); break;
+            case PieceType::Queen:  targets = queenAttacks(from, occ); break;
+            default: break;
+            }
+            targets &= classMask & checkMask;
+            if (pinned & squareBB(from)) targets &= lineBB[ksq][from];
+            while (targets) {
+                int to = popLsb(targets);
+                list.add(packMove(from, to, (squareBB(to) & enemies) ? FlagCapture : FlagQuiet));
+            }
+        }
+    }
+
+    // Castling is never legal out of check
+    if (Type == GenCaptures || checkers) return;
+    constexpr int kingside = kingsideRight<Us>();
+    constexpr int queenside = queensideRight<Us>();
+    constexpr int kingFrom = kingHome<Us>();
+    if ((castling & kingside)
+        && !(occ & (squareBB(kingFrom + 1) | squareBB(kingFrom + 2)))
+        && !isSquareAttackedBy<them>(kingFrom + 1, occ) && !isSquareAttackedBy<them>(kingFrom + 2, occ)) {
+        list.add(packMove(kingFrom, kingFrom + 2, FlagKingCastle));
+    }
+    if ((castling & queenside)
+        && !(occ & (squareBB(kingFrom - 1) | squareBB(kingFrom - 2) | squareBB(kingFrom - 3)))
+        && !isSquareAttackedBy<them>(kingFrom - 1, occ) && !isSquareAttackedBy<them>(kingFrom - 2, occ)) {
+        list.add(packMove(kingFrom, kingFrom - 2, FlagQueenCastle));
+    }
+}
+
+template void Position::generateLegal<GenAll>(MoveList& list) const;
+template void Position::generateLegal<GenCaptures>(MoveList& list) const;
+template void Position::generateLegal<GenQuiets>(MoveList& list) const;
+
+PackedMove Position::findMove(int from, int to, PieceType promotion) const {
+    MoveList legal;
+    generateLegal(legal);
+    for (PackedMove move : legal) {
+        if (moveFrom(move) == from && moveTo(move) == to
+            && (!isPromotionMove(move) || promotionType(move) == promotion)) {
+            return move;
+        }
+    }
+    return NullMove;
+}
+
+void Position::makeMove(PackedMove move) {
+    if (side == Color::White) doMove<Color::White>(move);
+    else doMove<Color::Black>(move);
+}
+
+void Position::unmakeMove(PackedMove move) {
+    if (side == Color::White) undoMove<Color::Black>(move);
+    else undoMove<Color::White>(move);
+}
+
+template <Color Us>
+void Position::doMove(PackedMove move) {
+    StateInfo st = { zobristKey, castling, enPassant, halfmoves, pliesFromNull, PieceType::None };
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    int flag = moveFlag(move);
+    constexpr Color us = Us;
+    PieceType moving = squares[from];
+
+    halfmoves++;
+    pliesFromNull++;
+    if (enPassant != -1) {
+        zobristKey ^= zobristEnPassant[squareCol(enPassant)];
+        enPassant = -1;
+    }
+
+    if (flag == FlagEnPassant) {
+        st.captured = PieceType::Pawn;
+        removePiece(to - pawnPush<Us>());
+    }
+    else if (isCaptureMove(move)) {
+        st.captured = squares[to];
+        removePiece(to);
+    }
+    if (st.captured != PieceType::None) halfmoves = 0;
+
+    movePieceBB(from, to);
+
+    if (moving == PieceType::Pawn) {
+        halfmoves = 0;
+        if (isPromotionMove(move)) {
+            removePiece(to);
+            putPiece(to, promotionType(move), us);
+        }
+    }
+    else if (flag == FlagKingCastle) {
+        movePieceBB(to + 1, to - 1);
+    }
+    else if (flag == FlagQueenCastle) {
+        movePieceBB(to - 2, to + 1);
+    }
+
+    zobristKey ^= zobristCastling[castling];
+    castling &= castlingMask[from] & castlingMask[to];
+    zobristKey ^= zobristCastling[castling];
+
+    if (us == Color::Black) fullmoves++;
+    side = ~us;
+    zobristKey ^= zobristSide;
+
+    if (flag == FlagDoublePush) {
+        setEnPassant((from + to) / 2);
+    }
+
+    history.push_back(st);
+}
+
+template <Color Us>
+void Position::undoMove(PackedMove move) {
+    const StateInfo& st = history.back();
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    int flag = moveFlag(move);
+    constexpr Color us = Us;
+    side = us;
+
+    if (us == Color::Black) fullmoves--;
+
+    if (isPromotionMove(move)) {
+        removePiece(to);
+        putPiece(to, PieceType::Pawn, us);
+    }
+    else if (flag == FlagKingCastle) {
+        movePieceBB(to - 1, to + 1);
+    }
+    else if (flag == FlagQueenCastle) {
+        movePieceBB(to + 1, to - 2);
+    }
+
+    movePieceBB(to, from);
+
+    if (st.captured != PieceType::None) {
+        int capSq = (flag == FlagEnPassant) ? to - pawnPush<Us>() : to;
+        putPiece(capSq, st.captured, ~us);
+    }
+
+    castling = st.castlingRights;
+    enPassant = st.epSquare;
+    halfmoves = st.halfmoveClock;
+    pliesFromNull = st.pliesFromNull;
+    zobristKey = st.key;
+    history.pop_back();
+}
+
+// Pass the turn (null-move pruning); repetition scans never cross a null move
+void Position::makeNullMove() {
+    StateInfo st = { zobristKey, castling, enPassant, halfmoves, pliesFromNull, PieceType::None };
+    if (enPassant != -1) {
+        zobristKey ^= zobristEnPassant[squareCol(enPassant)];
+        enPassant = -1;
+    }
+    halfmoves++;
+    pliesFromNull = 0;
+    side = ~side;
+    zobristKey ^= zobristSide;
+    history.push_back(st);
+}
+
+void Position::unmakeNullMove() {
+    const StateInfo& st = history.back();
+    side = ~side;
+    enPassant = st.epSquare;
+    halfmoves = st.halfmoveClock;
+    pliesFromNull = st.pliesFromNull;
+    zobristKey = st.key;
+    history.pop_back();
+}
+
+bool Position::hasNonPawnMaterial(Color color) const {
+    return (pieces(color) & ~pieces(color, PieceType::Pawn) & ~pieces(color, PieceType::King)) != 0;
+}
+
+// Positions can only repeat since the last capture or pawn move, and only
+// with the same side to move, so scan every second key back to that point
+int Position::repetitionCount() const {
+    int count = 1;
+    int n = (int)history.size();
+    int limit = std::min(std::min(halfmoves, pliesFromNull), n);
+    for (int i = 4; i <= limit; i += 2) {
+        if (history[n - i].key == zobristKey) count++;
+    }
+    return count;
+}
+
+// Search variant: any earlier occurrence is scored as a draw
+bool Position::isRepetition() const {
+    int n = (int)history.size();
+    int limit = std::min(std::min(halfmoves, pliesFromNull), n);
+    for (int i = 4; i <= limit; i += 2) {
+        if (history[n - i].key == zobristKey) return true;
+    }
+    return false;
+}
+
+bool Position::hasInsufficientMaterial() const {
+    for (int c = 0; c < 2; c++) {
+        if (counts[c][(int)PieceType::Pawn] || counts[c][(int)PieceType::Rook] || counts[c][(int)PieceType::Queen]) {
+            return false;
+        }
+    }
+    int knights = counts[0][(int)PieceType::Knight] + counts[1][(int)PieceType::Knight];
+    int bishops = counts[0][(int)PieceType::Bishop] + counts[1][(int)PieceType::Bishop];
+
+    // K vs K, K+minor vs K
+    if (knights + bishops <= 1) return true;
+
+    // Bishops only, all on one square colour: no mate is possible
+    if (knights == 0) {
+        Bitboard allBishops = byType[0][(int)PieceType::Bishop] | byType[1][(int)PieceType::Bishop];
+        return (allBishops & LightSquaresBB) == 0 || (allBishops & DarkSquaresBB) == 0;
+    }
+    return false;
+}
+
+// Automatic draws take precedence over claimable ones; the caller handles mate/stalemate
+GameState Position::drawState() const {
+    int repetitions = repetitionCount();
+    if (repetitions >= 5) return GameState::FivefoldRepetition;
+    if (isSeventyFiveMoveDraw()) return GameState::SeventyFiveMoveRule;
+    if (hasInsufficientMaterial()) return GameState::InsufficientMaterial;
+    if (repetitions >= 3) return GameState::ThreefoldRepetition;
+    if (isFiftyMoveDraw()) return GameState::FiftyMoveRule;
+    return GameState::Playing;
+}
+
+std::string Position::squareName(int sq) {
+    return std::string(1, char('a' + squareCol(sq))) + char('1' + squareRow(sq));
+}
+
+std::string Position::moveToUci(PackedMove move) {
+    if (move == NullMove) return "0000";
+    std::string text = squareName(moveFrom(move)) + squareName(moveTo(move));
+    if (isPromotionMove(move)) {
+        text += "nbrq"[moveFlag(move) & 3];
+    }
+    return text;
+}
+
+PackedMove Position::parseUciMove(const std::string& text) const {
+    if (text.size() < 4) return NullMove;
+    MoveList legal;
+    generateLegal(legal);
+    for (PackedMove move : legal) {
+        if (moveToUci(move) == text) return move;
+    }
+    return NullMove;
+}
+
+// Standard algebraic notation with minimal disambiguation and check / mate suffix
+std::string Position::moveToSan(PackedMove move) {
+    if (move == NullMove) return "--";
+    int from = moveFrom(move), to = moveTo(move);
+    PieceType type = pieceAt(from);
+    std::string text;
+
+    if (isCastlingMove(move)) {
+        text = moveFlag(move) == FlagKingCastle ? "O-O" : "O-O-O";
+    }
+    else if (type == PieceType::Pawn) {
+        if (isCaptureMove(move)) text += char('a' + squareCol(from)) + std::string("x");
+        text += squareName(to);
+        if (isPromotionMove(move)) text += std::string("=") + "NBRQ"[moveFlag(move) & 3];
+    }
+    else {
+        text += " KQRBN"[(int)type];
+        MoveList legal;
+        generateLegal(legal);
+        bool ambiguous = false, sameCol = false, sameRow = false;
+        for (PackedMove other : legal) {
+            int otherFrom = moveFrom(other);
+            if (other == move || moveTo(other) != to || pieceAt(otherFrom) != type) continue;
+            ambiguous = true;
+            if (squareCol(otherFrom) == squareCol(from)) sameCol = true;
+            if (squareRow(otherFrom) == squareRow(from)) sameRow = true;
+        }
+        if (ambiguous) {
+            if (!sameCol) text += char('a' + squareCol(from));
+            else if (!sameRow) text += char('1' + squareRow(from));
+            else text += squareName(from);
+        }
+        if (isCaptureMove(move)) text += 'x';
+        text += squareName(to);
+    }
+
+    makeMove(move);
+    if (inCheck()) {
+        MoveList replies;
+        generateLegal(replies);
+        text += replies.empty() ? '#' : '+';
+    }
+    unmakeMove(move);
+    return text;
+}
+
+// Reads the SAN fields - piece, optional origin file / rank, target and
+// promotion - and matches them against the legal moves. Over-specified
+// origins ("Ngf3") and promotions without '=' ("e8Q") are accepted.
+PackedMove Position::parseSanMove(const std::string& text) const {
+    // Annotations and check marks are not part of the match
+    std::string san = text;
+    while (!san.empty() && strchr("+#!?", san.back())) san.pop_back();
+    for (char& c : san) {
+        if (c == '0') c = 'O';
+    }
+    if (san.empty()) return NullMove;
+
+    MoveList legal;
+    generateLegal(legal);
+    if (san == "O-O" || san == "O-O-O") {
+        int flag = san == "O-O" ? FlagKingCastle : FlagQueenCastle;
+        for (PackedMove move : legal) {
+            if (moveFlag(move) == flag) return move;
+        }
+        return NullMove;
+    }
+
+    PieceType type = PieceType::Pawn;
+    size_t begin = 0;
+    if (strchr("KQRBN", san[0])) {
+        type = PieceType(strchr(" KQRBN", san[0]) - " KQRBN");
+        begin = 1;
+    }
+    char promotion = 0;
+    if (type == PieceType::Pawn && san.size() >= 3 && strchr("NBRQnbrq", san.back())
+        && (isdigit((unsigned char)san[san.size() - 2]) || san[san.size() - 2] == '=')) {
+        promotion = char(toupper((unsigned char)san.back()));
+        san.pop_back();
+        if (san.back() == '=') san.pop_back();
+    }
+    if (san.size() < begin + 2) return NullMove;
+    char targetCol = san[san.size() - 2], targetRow = san[san.size() - 1];
+    if (targetCol < 'a' || targetCol > 'h' || targetRow < '1' || targetRow > '8') return NullMove;
+    int to = makeSquare(targetCol - 'a', targetRow - '1');
+
+    int fromCol = -1, fromRow = -1;
+    for (size_t i = begin; i + 2 < san.size(); i++) {
+        char c = san[i];
+        if (c >= 'a' && c <= 'h') fromCol = c - 'a';
+        else if (c >= '1' && c <= '8') fromRow = c - '1';
+        else if (c != 'x' && c != '-') return NullMove;
+    }
+
+    PackedMove found = NullMove;
+    for (PackedMove move : legal) {
+        int from = moveFrom(move);
+        if (moveTo(move) != to || pieceAt(from) != type || isCastlingMove(move)) continue;
+        if (fromCol != -1 && squareCol(from) != fromCol) continue;
+        if (fromRow != -1 && squareRow(from) != fromRow) continue;
+        // A pawn capture always names its file
+        if (type == PieceType::Pawn && fromCol == -1 && isCaptureMove(move)) continue;
+        if (isPromotionMove(move) ? "NBRQ"[moveFlag(move) & 3] != promotion : promotion != 0) continue;
+        if (found != NullMove) return NullMove;     // still ambiguous
+        found = move;
+    }
+    return found;
+}
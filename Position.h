@@ -0,0 +1,179 @@
+#pragma once
+#include "Types.h"
+#include "Bitboard.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 16-bit move: from (6 bits) | to (6 bits) | flag (4 bits)
+typedef uint16_t PackedMove;
+
+enum MoveFlag {
+    FlagQuiet = 0,
+    FlagDoublePush = 1,
+    FlagKingCastle = 2,
+    FlagQueenCastle = 3,
+    FlagCapture = 4,
+    FlagEnPassant = 5,
+    FlagPromotion = 8,          // + 0..3 for Knight, Bishop, Rook, Queen
+    FlagPromotionCapture = 12   // + 0..3 for Knight, Bishop, Rook, Queen
+};
+
+const PackedMove NullMove = 0;
+
+inline PackedMove packMove(int from, int to, int flag) {
+    return PackedMove(from | (to << 6) | (flag << 12));
+}
+inline int moveFrom(PackedMove move) { return move & 63; }
+inline int moveTo(PackedMove move) { return (move >> 6) & 63; }
+inline int moveFlag(PackedMove move) { return move >> 12; }
+inline bool isCaptureMove(PackedMove move) { return (moveFlag(move) & 4) != 0; }
+inline bool isPromotionMove(PackedMove move) { return (moveFlag(move) & 8) != 0; }
+inline bool isCastlingMove(PackedMove move) { return moveFlag(move) == FlagKingCastle || moveFlag(move) == FlagQueenCastle; }
+inline PieceType promotionType(PackedMove move) {
+    static const PieceType types[4] = { PieceType::Knight, PieceType::Bishop, PieceType::Rook, PieceType::Queen };
+    return types[moveFlag(move) & 3];
+}
+
+struct MoveList {
+    PackedMove moves[256];
+    int count = 0;
+
+    void add(PackedMove move) { moves[count++] = move; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    PackedMove operator[](int i) const { return moves[i]; }
+    PackedMove* begin() { return moves; }
+    PackedMove* end() { return moves + count; }
+    const PackedMove* begin() const { return moves; }
+    const PackedMove* end() const { return moves + count; }
+};
+
+// Move classes for generateLegal: every promotion counts as a capture so
+// quiescence search sees it, quiets are everything else
+enum GenType {
+    GenAll, GenCaptures, GenQuiets
+};
+
+enum CastlingRight {
+    WhiteKingside = 1, WhiteQueenside = 2, BlackKingside = 4, BlackQueenside = 8
+};
+
+// Everything makeMove cannot recompute when the move is taken back
+struct StateInfo {
+    uint64_t key;
+    int castlingRights;
+    int epSquare;
+    int halfmoveClock;
+    int pliesFromNull;
+    PieceType captured;
+};
+
+// Board and state without the move history, 40 bytes: checkpoints of long games
+struct PositionSnapshot {
+    uint8_t squares[32];        // two squares per byte, low nibble first: colour * 8 + PieceType
+    uint8_t side;
+    uint8_t castlingRights;
+    int8_t epSquare;
+    uint8_t unused;
+    uint16_t halfmoveClock;
+    uint16_t fullmoveNumber;
+};
+
+// SFML-free rules core: bitboards + mailbox, incremental Zobrist key and material counts
+class Position {
+public:
+    static const char* StartFen;
+
+    Position();
+    void setStartPosition();
+    bool setFromFen(const std::string& fen);
+    std::string toFen() const;
+
+    PieceType pieceAt(int sq) const { return squares[sq]; }
+    Color colorAt(int sq) const { return (byColor[1] & squareBB(sq)) ? Color::Black : Color::White; }
+    Color sideToMove() const { return side; }
+    Bitboard pieces(Color color, PieceType type) const { return byType[colorIndex(color)][(int)type]; }
+    Bitboard pieces(Color color) const { return byColor[colorIndex(color)]; }
+    Bitboard occupied() const { return byColor[0] | byColor[1]; }
+    int pieceCount(Color color, PieceType type) const { return counts[colorIndex(color)][(int)type]; }
+    int kingSquare(Color color) const { return lsb(pieces(color, PieceType::King)); }
+    uint64_t key() const { return zobristKey; }
+    int castlingRights() const { return castling; }
+    int epSquare() const { return enPassant; }
+    int halfmoveClock() const { return halfmoves; }
+    int fullmoveNumber() const { return fullmoves; }
+    int gamePly() const { return (int)history.size(); }
+    void reserveHistory(size_t plies) { history.reserve(plies); }
+
+    // restore keeps the keys of the `count` positions before the snapshot (oldest
+    // first) for repetition detection; moves before it cannot be unmade
+    PositionSnapshot snapshot() const;
+    void restore(const PositionSnapshot& snapshot, const uint64_t* previousKeys = nullptr, int count = 0);
+
+    // Attacks
+    bool isSquareAttacked(int sq, Color byColor) const;
+    bool isSquareAttacked(int sq, Color byColor, Bitboard occ) const;
+    Bitboard attackersTo(int sq, Bitboard occ) const;
+    bool inCheck() const;
+
+    // Move generation
+    void generatePseudoLegal(MoveList& list) const;
+    template <GenType Type = GenAll> void generateLegal(MoveList& list) const;
+    void generateLegalReference(MoveList& list) const;  // pseudo-legal + make/unmake filter, for validation
+    bool isLegal(PackedMove move);
+    PackedMove findMove(int from, int to, PieceType promotion = PieceType::Queen) const;
+
+    // Make / unmake
+    void makeMove(PackedMove move);
+    void unmakeMove(PackedMove move);
+    void makeNullMove();
+    void unmakeNullMove();
+    bool hasNonPawnMaterial(Color color) const;
+
+    // Draw detection
+    int repetitionCount() const;
+    bool isRepetition() const;
+    bool isFiftyMoveDraw() const { return halfmoves >= 100; }
+    bool isSeventyFiveMoveDraw() const { return halfmoves >= 150; }
+    bool hasInsufficientMaterial() const;
+    GameState drawState() const;
+
+    // Notation
+    static std::string squareName(int sq);
+    static std::string moveToUci(PackedMove move);
+    PackedMove parseUciMove(const std::string& text) const;
+    std::string moveToSan(PackedMove move);
+    PackedMove parseSanMove(const std::string& text) const;
+
+private:
+    static int colorIndex(Color color) { return color == Color::White ? 0 : 1; }
+
+    template <Color By> bool isSquareAttackedBy(int sq, Bitboard occ) const;
+    template <Color Us> void generatePseudoLegalFor(MoveList& list) const;
+    template <Color Us, GenType Type> void generateLegalFor(MoveList& list) const;
+    template <Color Us> void doMove(PackedMove move);
+    template <Color Us> void undoMove(PackedMove move);
+
+    void clear();
+    void putPiece(int sq, PieceType type, Color color);
+    void removePiece(int sq);
+    void movePieceBB(int from, int to);
+    bool canCaptureEnPassant(int sq) const;
+    void setEnPassant(int sq);
+
+    Bitboard byType[2][7];
+    Bitboard byColor[2];
+    PieceType squares[64];
+    int counts[2][7];
+
+    Color side = Color::White;
+    int castling = 0;
+    int enPassant = -1;
+    int halfmoves = 0;
+    int pliesFromNull = 0;
+    int fullmoves = 1;
+    uint64_t zobristKey = 0;
+
+    std::vector<StateInfo> history;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Compact binary protocol shared by the game server, the SFML network mode,
+// the load and fan-out benchmarks and the distributed analysis coordinator / workers.
+//
+// Frame: [type u8][payload length u8][payload], integers little-endian.
+// Moves are PackedMove values from the rules core.
+
+enum class MessageType : uint8_t {
+    Join = 1,       // C->S  gameId u32
+    Joined,         // S->C  gameId u32, color u8 (0 white, 1 black)
+    Start,          // S->C  whiteMs u32, blackMs u32, incrementMs u32
+    Move,           // C->S  move u16
+    MoveMade,       // S->C  move u16, whiteMs u32, blackMs u32
+    Resign,         // C->S  (empty)
+    ClockRequest,   // C->S  (empty)
+    Clock,          // S->C  whiteMs u32, blackMs u32, sideToMove u8
+    GameOver,       // S->C  winner u8 (0 white, 1 black, 2 draw), reason u8, state u8 (GameState)
+    Error,          // S->C  code u8
+    Spectate,       // C->S  gameId u32; the game's Start / MoveMade / GameOver frames follow
+    Snapshot,       // S->C  gameId u32, ply u16, whiteMs u32, blackMs u32, started u8, fen (rest);
+                    //       the first frame for a spectator, and what a lagging one gets instead of its backlog
+
+    // Distributed analysis: W = worker process, C = coordinator
+    WorkerHello = 32,   // W->C  slots u8, threads u8, pid u32
+    Job,                // C->W  jobId u32, depth u8, nodes u32, fen (rest of the payload)
+    Heartbeat,          // W->C  (empty) renews the leases of every job the worker holds
+    JobResult,          // W->C  jobId u32, best u16, score i32, depth u8, nodes u32, timeMs u32, pv u16 * n
+    NoMoreJobs,         // C->W  (empty) the workload is finished, the worker exits
+    JobError            // W->C  jobId u32: the job's FEN is not a valid position
+};
+
+enum class EndReason : uint8_t {
+    Checkmate, Draw, Resignation, Timeout, Abandoned
+};
+
+enum class ErrorCode : uint8_t {
+    BadMessage, GameFull, NotInGame, NotYourTurn, IllegalMove, GameNotStarted, NoSuchGame
+};
+
+const size_t FrameHeaderSize = 2;
+const size_t MaxFrameSize = FrameHeaderSize + 255;
+
+inline void putU16(uint8_t* out, uint16_t value) {
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+inline void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = uint8_t(value >> (8 * i));
+}
+
+inline uint16_t getU16(const uint8_t* in) {
+    return uint16_t(in[0] | (in[1] << 8));
+}
+
+inline uint32_t getU32(const uint8_t* in) {
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+
+// Fixed-size frame built on the stack, appended to a connection's output buffer
+struct Frame {
+    uint8_t data[MaxFrameSize];
+    size_t size = FrameHeaderSize;
+
+    explicit Frame(MessageType type) {
+        data[0] = uint8_t(type);
+        data[1] = 0;
+    }
+    Frame& u8(uint8_t value) { data[size++] = value; data[1]++; return *this; }
+    Frame& u16(uint16_t value) { putU16(data + size, value); size += 2; data[1] += 2; return *this; }
+    Frame& u32(uint32_t value) { putU32(data + size, value); size += 4; data[1] += 4; return *this; }
+    Frame& text(const std::string& value) {
+        size_t length = std::min(value.size(), MaxFrameSize - size);
+        std::memcpy(data + size, value.data(), length);
+        size += length;
+        data[1] = uint8_t(data[1] + length);
+        return *this;
+    }
+    size_t room() const { return MaxFrameSize - size; }
+
+    void appendTo(std::vector<uint8_t>& out) const { out.insert(out.end(), data, data + size); }
+};
+
+// Size of the first complete frame in the buffer, or 0 if more bytes are needed
+inline size_t completeFrameSize(const uint8_t* data, size_t available) {
+    if (available < FrameHeaderSize) return 0;
+    size_t size = FrameHeaderSize + data[1];
+    return available >= size ? size : 0;
+}
@@ -0,0 +1,622 @@
+#include "Search.h"
+#include "AllocationCounter.h"
+#include "Evaluate.h"
+#include "Tablebase.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Late move reductions indexed by [depth][move number]
+static int reductions[MaxPly][64];
+
+static void initReductions() {
+    static bool initialized = false;
+    if (initialized) return;
+    initialized = true;
+    for (int depth = 1; depth < MaxPly; depth++) {
+        for (int moves = 1; moves < 64; moves++) {
+            reductions[depth][moves] = int(0.75 + std::log(depth) * std::log(moves) / 2.25);
+        }
+    }
+}
+
+// Mate scores are stored relative to the node, not the root
+static int scoreToTT(int score, int ply) {
+    if (score >= MateInMaxPly) return score + ply;
+    if (score <= -MateInMaxPly) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    if (score >= MateInMaxPly) return score - ply;
+    if (score <= -MateInMaxPly) return score + ply;
+    return score;
+}
+
+SearchWorker::SearchWorker(Search& search, int id)
+    : id(id), stack(new SearchStack[MaxPly + 1]), history(new HistoryTables), search(search) {
+    rootPv.reserve(MaxPly + 1);
+    history->clear();
+}
+
+// Everything the tree search writes lives in memory allocated before it starts
+void SearchWorker::prepare(const Position& root) {
+    pos = root;
+    pos.reserveHistory(root.gamePly() + MaxPly + 1);
+    for (int ply = 0; ply <= MaxPly; ply++) {
+        stack[ply].pvLength = 0;
+        stack[ply].killers[0] = stack[ply].killers[1] = NullMove;
+        stack[ply].pieceTo = -1;
+    }
+    orderingFeatures = search.orderingFeatures;
+    nodes = 0;
+    completedDepth = 0;
+    bestScore = 0;
+    rootPv.clear();
+    for (RootLine& line : lines) line.depth = line.pvLength = 0;
+    MoveList rootMoves;
+    pos.generateLegal(rootMoves);
+    rootMoveCount = rootMoves.size();
+    // Helpers only fill the shared table, so they always search a single line
+    lineCount = id == 0 ? std::max(1, std::min(search.multiPv, rootMoveCount)) : 1;
+    pvIndex = 0;
+    stats.reset();
+    collectStats = search.collectStats;
+    searchAllocations = 0;
+}
+
+void SearchWorker::countNode() {
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (id == 0 && (nodes.load(std::memory_order_relaxed) & 511) == 0) {
+        search.checkLimits();
+    }
+}
+
+// Counter move and continuation rows come from the moves that led to this node
+OrderingContext SearchWorker::orderingContext(int ply, PackedMove ttMove) const {
+    OrderingContext context;
+    context.ttMove = ttMove;
+    context.killers = stack[ply].killers;
+    context.history = history.get();
+    context.features = orderingFeatures;
+    for (int back = 1; back <= 2 && back <= ply; back++) {
+        int previous = stack[ply - back].pieceTo;
+        if (previous < 0) continue;
+        if (back == 1) context.counterMove = history->counterMoves[previous / 64][previous % 64];
+        context.continuation[back - 1] = &history->continuation[previous / 64][previous % 64][0][0];
+    }
+    return context;
+}
+
+// A quiet move caused a cutoff: reward it and penalise the quiet moves tried before it
+void SearchWorker::updateQuietStats(int ply, int depth, PackedMove best) {
+    SearchStack& ss = stack[ply];
+    if (ss.killers[0] != best) {
+        ss.killers[1] = ss.killers[0];
+        ss.killers[0] = best;
+    }
+
+    Color us = pos.sideToMove();
+    int c = us == Color::White ? 0 : 1;
+    int bonus = historyBonus(depth);
+    int16_t* rows[2] = { nullptr, nullptr };
+    for (int back = 1; back <= 2 && back <= ply; back++) {
+        int previous = stack[ply - back].pieceTo;
+        if (previous < 0) continue;
+        if (back == 1) history->counterMoves[previous / 64][previous % 64] = best;
+        rows[back - 1] = &history->continuation[previous / 64][previous % 64][0][0];
+    }
+
+    for (int i = -1; i < ss.quietCount; i++) {
+        PackedMove move = i < 0 ? best : ss.quietsTried[i];
+        int delta = i < 0 ? bonus : -bonus;
+        int from = moveFrom(move);
+        int to = moveTo(move);
+        updateHistory(history->butterfly[c][from][to], delta);
+        int piece = pieceIndex(us, pos.pieceAt(from)) * 64 + to;
+        for (int16_t* row : rows) {
+            if (row) updateHistory(row[piece], delta);
+        }
+    }
+}
+
+bool SearchWorker::excludedAtRoot(PackedMove move) const {
+    for (int i = 0; i < pvIndex; i++) {
+        if (lines[i].pv[0] == move) return true;
+    }
+    return false;
+}
+
+void SearchWorker::iterativeDeepening() {
+    const SearchLimits& limits = search.limits;
+    // Reporting allocates (info strings, PV copies); the tree search must not
+    uint64_t allocationsBefore = threadAllocationCount();
+
+    // Helpers start one ply deeper on odd ids so the threads do not all search the same tree
+    int firstDepth = 1 + (id & 1);
+    for (int depth = firstDepth; depth < MaxPly; depth++) {
+        if (limits.depth && depth > limits.depth) break;
+        selDepth = 0;
+
+        // Multi-PV: each further line is searched with the earlier lines' first moves excluded
+        int score = 0;
+        for (pvIndex = 0; pvIndex < lineCount; pvIndex++) {
+            RootLine& line = lines[pvIndex];
+
+            // Aspiration window around the line's previous score once the score has settled
+            int delta = 25;
+            int alpha = -InfiniteScore, beta = InfiniteScore;
+            if (depth >= 5 && line.depth > 0) {
+                alpha = std::max(line.score - delta, -InfiniteScore);
+                beta = std::min(line.score + delta, InfiniteScore);
+            }
+
+            while (true) {
+                score = negamax(depth, 0, alpha, beta, false);
+                if (search.stopFlag.load(std::memory_order_relaxed)) break;
+                if (score <= alpha) {
+                    beta = (alpha + beta) / 2;
+                    alpha = std::max(score - delta, -InfiniteScore);
+                }
+                else if (score >= beta) {
+                    beta = std::min(score + delta, InfiniteScore);
+                }
+                else {
+                    break;
+                }
+                delta += delta / 2;
+            }
+
+            // A partial iteration is only used if nothing was completed yet
+            if (search.stopFlag.load(std::memory_order_relaxed) && completedDepth > 0) break;
+            const SearchStack& root = stack[0];
+            if (root.pvLength > 0) {
+                line.score = score;
+                line.depth = depth;
+                line.pvLength = root.pvLength;
+                std::copy(root.pv, root.pv + root.pvLength, line.pv);
+            }
+            if (search.stopFlag.load(std::memory_order_relaxed)) break;
+        }
+        if (search.stopFlag.load(std::memory_order_relaxed) && completedDepth > 0) break;
+
+        if (lines[0].depth == depth) {
+            // Later lines can outscore earlier ones after a re-search: keep best first
+            // (insertion sort, stable and allocation-free)
+            for (int i = 1; i < lineCount && pvIndex == lineCount; i++) {
+                for (int j = i; j > 0 && lines[j].score > lines[j - 1].score; j--) {
+                    std::swap(lines[j], lines[j - 1]);
+                }
+            }
+            rootPv.assign(lines[0].pv, lines[0].pv + lines[0].pvLength);
+            bestScore = lines[0].score;
+            completedDepth = depth;
+        }
+        if (search.stopFlag.load(std::memory_order_relaxed)) break;
+
+        if (id == 0) {
+            uint64_t reportStart = threadAllocationCount();
+            search.reportIteration(*this);
+            allocationsBefore += threadAllocationCount() - reportStart;
+            if (search.softTimeUp()) break;
+            if (!limits.infinite && std::abs(bestScore) >= MateInMaxPly && depth >= 2 * (MateScore - std::abs(bestScore)) + 2) break;
+        }
+    }
+
+    searchAllocations = threadAllocationCount() - allocationsBefore;
+    assert(searchAllocations == 0 && "heap allocation inside the search");
+}
+
+int SearchWorker::negamax(int depth, int ply, int alpha, int beta, bool allowNull) {
+    SearchStack& ss = stack[ply];
+    ss.pvLength = 0;
+    if (depth <= 0) return quiescence(ply, alpha, beta);
+
+    countNode();
+    if (search.stopFlag.load(std::memory_order_relaxed)) return 0;
+    selDepth = std::max(selDepth, ply);
+
+    bool pvNode = beta - alpha > 1;
+    bool rootNode = ply == 0;
+
+    if (!rootNode) {
+        if (pos.isRepetition() || pos.isFiftyMoveDraw() || pos.hasInsufficientMaterial()) return 0;
+
+        // Mate distance pruning
+        alpha = std::max(alpha, -MateScore + ply);
+        beta = std::min(beta, MateScore - ply - 1);
+        if (alpha >= beta) return alpha;
+
+        if (ply >= MaxPly - 1) return evaluate(pos);
+
+        // Distance to mate from the tables, counted from the root like any mate score
+        TablebaseResult tb;
+        if (search.tablebases && popCount(pos.occupied()) <= search.tablebases->maxPieces()
+            && search.tablebases->probe(pos, tb)) {
+            return tb.wdl > 0 ? MateScore - ply - tb.dtm : tb.wdl < 0 ? -MateScore + ply + tb.dtm : 0;
+        }
+    }
+
+    TTEntry entry;
+    PackedMove ttMove = NullMove;
+    if (collectStats) stats.ttProbes.add();
+    if (search.tt.probe(pos.key(), entry)) {
+        if (collectStats) stats.ttHits.add();
+        ttMove = entry.move;
+        int ttScore = scoreFromTT(entry.score, ply);
+        if (!pvNode && entry.depth >= depth
+            && ((entry.bound == BoundExact)
+                || (entry.bound == BoundLower && ttScore >= beta)
+                || (entry.bound == BoundUpper && ttScore <= alpha))) {
+            return ttScore;
+        }
+    }
+
+    bool inCheck = pos.inCheck();
+    if (inCheck) depth++;
+    int staticEval = inCheck ? -InfiniteScore : evaluate(pos);
+
+    // Null move pruning: if passing still fails high, the position is good enough
+    if (allowNull && !pvNode && !inCheck && depth >= 3 && staticEval >= beta
+        && pos.hasNonPawnMaterial(pos.sideToMove())) {
+        int reduction = 3 + depth / 6;
+        if (collectStats) stats.nullTries.add();
+        ss.pieceTo = -1;
+        pos.makeNullMove();
+        int score = -negamax(depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+        pos.unmakeNullMove();
+        if (search.stopFlag.load(std::memory_order_relaxed)) return 0;
+        if (score >= beta) {
+            if (collectStats) stats.nullCutoffs.add();
+            return score >= MateInMaxPly ? beta : score;
+        }
+    }
+
+    MoveList& moves = ss.moves;
+    moves.count = 0;
+    pos.generateLegal(moves);
+    if (moves.empty()) {
+        return inCheck ? -MateScore + ply : 0;
+    }
+    orderMoves(pos, moves, ss.scores, orderingContext(ply, ttMove));
+
+    int originalAlpha = alpha;
+    int bestScore = -InfiniteScore;
+    PackedMove bestMove = NullMove;
+    int moveCount = 0;
+    ss.quietCount = 0;
+
+    for (PackedMove move : moves) {
+        if (rootNode && pvIndex > 0 && excludedAtRoot(move)) continue;
+        moveCount++;
+        bool quiet = !isCaptureMove(move) && !isPromotionMove(move);
+
+        ss.pieceTo = pieceIndex(pos.sideToMove(), pos.pieceAt(moveFrom(move))) * 64 + moveTo(move);
+        pos.makeMove(move);
+        bool givesCheck = pos.inCheck();
+        int newDepth = depth - 1;
+        int score;
+
+        if (moveCount == 1) {
+            score = -negamax(newDepth, ply + 1, -beta, -alpha, true);
+        }
+        else {
+            // Late move reductions for quiet moves, re-searched at full depth if they beat alpha
+            int reduction = 0;
+            if (depth >= 3 && moveCount > 3 && quiet && !inCheck && !givesCheck) {
+                reduction = reductions[std::min(depth, MaxPly - 1)][std::min(moveCount, 63)];
+                if (pvNode) reduction--;
+                reduction = std::max(0, std::min(reduction, newDepth - 1));
+            }
+            if (collectStats && reduction > 0) stats.lmrTries.add();
+            score = -negamax(newDepth - reduction, ply + 1, -alpha - 1, -alpha, true);
+            if (score > alpha && reduction > 0) {
+                if (collectStats) stats.lmrResearches.add();
+                score = -negamax(newDepth, ply + 1, -alpha - 1, -alpha, true);
+            }
+            if (score > alpha && score < beta) {
+                score = -negamax(newDepth, ply + 1, -beta, -alpha, true);
+            }
+        }
+        pos.unmakeMove(move);
+
+        if (search.stopFlag.load(std::memory_order_relaxed)) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                bestMove = move;
+                alpha = score;
+                const SearchStack& child = stack[ply + 1];
+                ss.pv[0] = move;
+                std::copy(child.pv, child.pv + child.pvLength, ss.pv + 1);
+                ss.pvLength = child.pvLength + 1;
+                if (alpha >= beta) {
+                    if (quiet) updateQuietStats(ply, depth, move);
+                    if (collectStats) {
+                        stats.betaCutoffs.add();
+                        if (moveCount == 1) stats.firstMoveCutoffs.add();
+                    }
+                    break;
+                }
+            }
+        }
+        if (quiet && ss.quietCount < 64) ss.quietsTried[ss.quietCount++] = move;
+    }
+
+    // A root search with excluded moves is not a result for the position itself
+    if (!(rootNode && pvIndex > 0)) {
+        Bound bound = bestScore >= beta ? BoundLower : bestScore > originalAlpha ? BoundExact : BoundUpper;
+        search.tt.store(pos.key(), bestMove, scoreToTT(bestScore, ply), depth, bound);
+    }
+    return bestScore;
+}
+
+int SearchWorker::quiescence(int ply, int alpha, int beta) {
+    countNode();
+    if (collectStats) stats.qnodes.add();
+    if (search.stopFlag.load(std::memory_order_relaxed)) return 0;
+    selDepth = std::max(selDepth, ply);
+
+    if (pos.isRepetition() || pos.hasInsufficientMaterial()) return 0;
+    if (ply >= MaxPly - 1) return evaluate(pos);
+
+    bool inCheck = pos.inCheck();
+    int bestScore = -InfiniteScore;
+    if (!inCheck) {
+        bestScore = evaluate(pos);
+        if (bestScore >= beta) return bestScore;
+        alpha = std::max(alpha, bestScore);
+    }
+
+    SearchStack& ss = stack[ply];
+    MoveList& moves = ss.moves;
+    moves.count = 0;
+    // Out of check every evasion is searched, otherwise only captures and queen promotions
+    if (inCheck) pos.generateLegal(moves);
+    else pos.generateLegal<GenCaptures>(moves);
+    if (inCheck && moves.empty()) return -MateScore + ply;
+    OrderingContext context;
+    context.features = orderingFeatures;
+    orderMoves(pos, moves, ss.scores, context);
+
+    for (int i = 0; i < moves.size(); i++) {
+        PackedMove move = moves[i];
+        if (!inCheck) {
+            if (!isCaptureMove(move) && promotionType(move) != PieceType::Queen) continue;
+            // SEE pruning: a capture that loses material cannot beat the stand-pat score,
+            // and the losing captures are sorted last
+            if (isLosingCaptureScore(ss.scores[i])) break;
+        }
+        pos.makeMove(move);
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        pos.unmakeMove(move);
+
+        if (search.stopFlag.load(std::memory_order_relaxed)) return 0;
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    return bestScore;
+}
+
+Search::Search() {
+    initReductions();
+    setThreads(1);
+}
+
+Search::~Search() {
+    stop();
+    wait();
+}
+
+void Search::clear() {
+    wait();
+    tt.clear();
+    for (auto& worker : workers) worker->clearHistory();
+}
+
+void Search::setHashSize(size_t megabytes) {
+    wait();
+    tt.resize(std::max<size_t>(1, megabytes));
+}
+
+void Search::setThreads(int count) {
+    wait();
+    threadCount = std::max(1, count);
+    workers.clear();
+    for (int i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<SearchWorker>(*this, i));
+    }
+}
+
+void Search::start(const Position& pos, const SearchLimits& searchLimits) {
+    stop();
+    wait();
+
+    rootPosition = pos;
+    limits = searchLimits;
+    startTimeUs = nowUs();
+    stopFlag = false;
+    pondering = limits.ponder;
+    allocateTime(pos.sideToMove());
+
+    searching = true;
+    controller = std::thread(&Search::mainThread, this);
+}
+
+void Search::stop() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        stopFlag = true;
+        pondering = false;
+    }
+    waitCondition.notify_all();
+}
+
+// The opponent played the expected move: our clock starts now
+void Search::ponderHit() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        startTimeUs = nowUs();
+        pondering = false;
+    }
+    waitCondition.notify_all();
+}
+
+void Search::wait() {
+    if (controller.joinable()) controller.join();
+}
+
+uint64_t Search::nodesSearched() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers) {
+        total += worker->nodes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t Search::elapsedMs() const {
+    return (nowUs() - startTimeUs.load(std::memory_order_relaxed)) / 1000;
+}
+
+// Budget per move from the clock: an optimum checked between iterations and a
+// hard maximum checked during search that always leaves a reserve on the clock
+void Search::allocateTime(Color us) {
+    int side = us == Color::White ? 0 : 1;
+    optimumMs = maximumMs = -1;
+
+    if (limits.moveTime >= 0) {
+        optimumMs = maximumMs = std::max<int64_t>(1, limits.moveTime - moveOverhead);
+        return;
+    }
+    if (limits.time[side] < 0) return;
+
+    int64_t available = std::max<int64_t>(1, limits.time[side] - moveOverhead);
+    int movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, 50) : 40;
+    int64_t increment = limits.increment[side];
+
+    optimumMs = available / movesToGo + increment * 3 / 4;
+    int64_t ceiling = movesToGo == 1 ? available * 9 / 10 : available * 4 / 10;
+    maximumMs = std::max<int64_t>(1, std::min(optimumMs * 5, ceiling));
+    optimumMs = std::max<int64_t>(1, std::min(optimumMs, maximumMs));
+}
+
+void Search::checkLimits() {
+    if (limits.nodes && nodesSearched() >= limits.nodes) {
+        stopFlag = true;
+    }
+    if (maximumMs >= 0 && !pondering.load(std::memory_order_relaxed) && elapsedMs() >= maximumMs) {
+        stopFlag = true;
+    }
+}
+
+bool Search::softTimeUp() const {
+    if (limits.infinite || pondering.load(std::memory_order_relaxed) || optimumMs < 0) return false;
+    if (limits.moveTime >= 0) return elapsedMs() >= maximumMs;
+    // Another iteration would most likely not finish within the optimum
+    return elapsedMs() >= optimumMs * 6 / 10;
+}
+
+uint64_t Search::searchAllocations() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers) total += worker->searchAllocations;
+    return total;
+}
+
+SearchStats Search::statistics() const {
+    SearchStats result;
+    for (const auto& worker : workers) {
+        StatsTotals thread;
+        thread.add(worker->nodes.load(std::memory_order_relaxed), worker->stats);
+        result.threads.push_back(thread);
+        result.total.add(thread);
+    }
+    int64_t finished = finishedMs.load(std::memory_order_relaxed);
+    result.timeMs = finished >= 0 ? finished : elapsedMs();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    result.iterations = iterations;
+    return result;
+}
+
+void Search::reportIteration(SearchWorker& worker) {
+    if (collectStats) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        iterations.push_back({ worker.completedDepth, nodesSearched(), elapsedMs() });
+    }
+    if (!onInfo) return;
+    for (int i = 0; i < worker.lineCount; i++) {
+        const RootLine& line = worker.lines[i];
+        if (line.pvLength == 0) continue;
+        SearchInfo info;
+        info.multiPv = i + 1;
+        info.depth = line.depth;
+        info.selDepth = worker.selDepth;
+        info.score = line.score;
+        info.nodes = nodesSearched();
+        info.timeMs = elapsedMs();
+        info.hashfull = tt.hashfull();
+        info.pv.assign(line.pv, line.pv + line.pvLength);
+        if (collectStats && i + 1 == worker.lineCount) {
+            info.hasStats = true;
+            info.stats = statistics();
+        }
+        onInfo(info);
+    }
+}
+
+void Search::mainThread() {
+    MoveList rootMoves;
+    rootPosition.generateLegal(rootMoves);
+
+    for (auto& worker : workers) {
+        worker->prepare(rootPosition);
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        iterations.clear();
+    }
+    finishedMs = -1;
+
+    std::vector<std::thread> helpers;
+    if (!rootMoves.empty()) {
+        for (size_t i = 1; i < workers.size(); i++) {
+            helpers.emplace_back(&SearchWorker::iterativeDeepening, workers[i].get());
+        }
+        workers[0]->iterativeDeepening();
+    }
+
+    // UCI: never answer an infinite or ponder search before stop / ponderhit
+    {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitCondition.wait(lock, [this] {
+            return stopFlag.load() || (!pondering.load() && !limits.infinite);
+        });
+    }
+
+    stopFlag = true;
+    for (auto& helper : helpers) helper.join();
+    finishedMs = elapsedMs();
+
+    PackedMove best = NullMove, ponder = NullMove;
+    const std::vector<PackedMove>& pv = workers[0]->rootPv;
+    if (!pv.empty()) {
+        best = pv[0];
+        if (pv.size() > 1) ponder = pv[1];
+    }
+    else if (!rootMoves.empty()) {
+        best = rootMoves[0];
+    }
+
+    searching = false;
+    if (onBestMove) onBestMove(best, ponder);
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include "MoveOrdering.h"
+#include "Position.h"
+#include "SearchStats.h"
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const int MaxPly = 128;
+const int MateScore = 32000;
+const int MateInMaxPly = MateScore - MaxPly;
+const int InfiniteScore = 32001;
+const int MaxMultiPv = 8;
+
+struct SearchLimits {
+    int64_t time[2] = { -1, -1 };       // remaining ms for White / Black, -1 = untimed
+    int64_t increment[2] = { 0, 0 };
+    int movesToGo = 0;
+    int64_t moveTime = -1;
+    int depth = 0;                      // 0 = no limit
+    uint64_t nodes = 0;                 // 0 = no limit
+    bool infinite = false;
+    bool ponder = false;
+};
+
+struct SearchInfo {
+    int multiPv = 1;                    // 1-based line number, best line first
+    int depth = 0;
+    int selDepth = 0;
+    int score = 0;
+    uint64_t nodes = 0;
+    int64_t timeMs = 0;
+    int hashfull = 0;
+    std::vector<PackedMove> pv;
+    bool hasStats = false;              // set when statistics are being collected
+    SearchStats stats;
+};
+
+class Search;
+class Tablebases;
+
+// One root line of a multi-PV search
+struct RootLine {
+    int score = 0;
+    int depth = 0;
+    int pvLength = 0;
+    PackedMove pv[MaxPly + 1];
+};
+
+// Per-ply scratch space of one search thread. A worker allocates MaxPly + 1 of
+// these once, so the tree search itself never touches the heap.
+struct SearchStack {
+    MoveList moves;
+    int scores[256];                    // ordering keys of moves
+    PackedMove pv[MaxPly + 1];
+    int pvLength = 0;
+    PackedMove killers[2] = { NullMove, NullMove };
+    PackedMove quietsTried[64];         // quiet moves that did not cut off, for the history malus
+    int quietCount = 0;
+    int pieceTo = -1;                   // pieceIndex * 64 + to of the move made here, -1 for a null move
+};
+
+// One search thread (lazy SMP): private position copy, shared transposition table
+class SearchWorker {
+public:
+    SearchWorker(Search& search, int id);
+
+    void prepare(const Position& root);
+    void clearHistory() { history->clear(); }
+    void iterativeDeepening();
+
+    Position pos;
+    int id;
+    std::atomic<uint64_t> nodes{ 0 };
+    int selDepth = 0;
+    int completedDepth = 0;
+    int bestScore = 0;
+    std::vector<PackedMove> rootPv;
+    RootLine lines[MaxMultiPv];         // sorted best first after each completed iteration
+    int lineCount = 1;
+    ThreadStats stats;
+    bool collectStats = false;
+    uint64_t searchAllocations = 0;     // heap allocations by the last tree search
+
+private:
+    int negamax(int depth, int ply, int alpha, int beta, bool allowNull);
+    int quiescence(int ply, int alpha, int beta);
+    void countNode();
+    bool excludedAtRoot(PackedMove move) const;
+    OrderingContext orderingContext(int ply, PackedMove ttMove) const;
+    void updateQuietStats(int ply, int depth, PackedMove best);
+
+    std::unique_ptr<SearchStack[]> stack;
+    std::unique_ptr<HistoryTables> history;
+    int orderingFeatures = OrderAll;
+    int rootMoveCount = 0;
+    int pvIndex = 0;                    // root line being searched; earlier lines' moves are skipped
+    Search& search;
+};
+
+class Search {
+public:
+    Search();
+    ~Search();
+
+    void setHashSize(size_t megabytes);
+    void setThreads(int count);
+    void setMoveOverhead(int ms) { moveOverhead = ms; }
+    void setMultiPv(int lines) { multiPv = std::max(1, std::min(lines, MaxMultiPv)); }
+    void setOrdering(int features) { orderingFeatures = features; }   // OrderingFeature bits
+    // Forget everything learned from earlier searches: hash table and move-ordering history
+    void clear();
+    void setCollectStats(bool enabled) { collectStats = enabled; }
+    // Positions the tables cover get their exact score instead of a search; set while stopped
+    void setTablebases(const Tablebases* tables) { tablebases = tables; }
+    bool collectingStats() const { return collectStats; }
+
+    // Asynchronous: returns immediately, results arrive through the callbacks
+    void start(const Position& pos, const SearchLimits& limits);
+    void stop();
+    void ponderHit();
+    void wait();
+    bool isSearching() const { return searching; }
+
+    uint64_t nodesSearched() const;
+    int64_t elapsedMs() const;
+    // Counters of the current or last search; all zero unless collection is on
+    SearchStats statistics() const;
+    // Heap allocations made inside the tree search of the last search (debug builds)
+    uint64_t searchAllocations() const;
+
+    std::function<void(const SearchInfo&)> onInfo;
+    std::function<void(PackedMove best, PackedMove ponder)> onBestMove;
+
+private:
+    friend class SearchWorker;
+
+    void mainThread();
+    void allocateTime(Color us);
+    void checkLimits();
+    void reportIteration(SearchWorker& worker);
+    bool softTimeUp() const;
+
+    TranspositionTable tt;
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+    int threadCount = 1;
+    int moveOverhead = 30;
+    int multiPv = 1;
+    int orderingFeatures = OrderAll;
+    bool collectStats = false;
+    const Tablebases* tablebases = nullptr;
+
+    Position rootPosition;
+    SearchLimits limits;
+    std::atomic<int64_t> startTimeUs{ 0 };    // reset on ponderhit, read by the main worker
+    int64_t optimumMs = -1;
+    int64_t maximumMs = -1;
+
+    std::thread controller;
+    std::atomic<bool> stopFlag{ false };
+    std::atomic<bool> pondering{ false };
+    std::atomic<bool> searching{ false };
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+
+    mutable std::mutex statsMutex;
+    std::vector<IterationStats> iterations;
+    std::atomic<int64_t> finishedMs{ -1 };
+};
@@ -0,0 +1,180 @@
+#include "SearchStats.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+void ThreadStats::reset() {
+    qnodes.reset();
+    ttProbes.reset();
+    ttHits.reset();
+    betaCutoffs.reset();
+    firstMoveCutoffs.reset();
+    nullTries.reset();
+    nullCutoffs.reset();
+    lmrTries.reset();
+    lmrResearches.reset();
+}
+
+void StatsTotals::add(uint64_t threadNodes, const ThreadStats& stats) {
+    nodes += threadNodes;
+    qnodes += stats.qnodes.get();
+    ttProbes += stats.ttProbes.get();
+    ttHits += stats.ttHits.get();
+    betaCutoffs += stats.betaCutoffs.get();
+    firstMoveCutoffs += stats.firstMoveCutoffs.get();
+    nullTries += stats.nullTries.get();
+    nullCutoffs += stats.nullCutoffs.get();
+    lmrTries += stats.lmrTries.get();
+    lmrResearches += stats.lmrResearches.get();
+}
+
+void StatsTotals::add(const StatsTotals& other) {
+    nodes += other.nodes;
+    qnodes += other.qnodes;
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    betaCutoffs += other.betaCutoffs;
+    firstMoveCutoffs += other.firstMoveCutoffs;
+    nullTries += other.nullTries;
+    nullCutoffs += other.nullCutoffs;
+    lmrTries += other.lmrTries;
+    lmrResearches += other.lmrResearches;
+}
+
+static double ratio(uint64_t part, uint64_t whole) {
+    return whole ? double(part) / double(whole) : 0.0;
+}
+
+double SearchStats::ttHitRate() const {
+    return ratio(total.ttHits, total.ttProbes);
+}
+
+double SearchStats::firstMoveCutoffRate() const {
+    return ratio(total.firstMoveCutoffs, total.betaCutoffs);
+}
+
+double SearchStats::nullMoveSuccessRate() const {
+    return ratio(total.nullCutoffs, total.nullTries);
+}
+
+double SearchStats::lmrSuccessRate() const {
+    return total.lmrTries ? 1.0 - ratio(total.lmrResearches, total.lmrTries) : 0.0;
+}
+
+// N = b^d over the deepest completed iteration
+double SearchStats::branchingFactor() const {
+    if (iterations.empty() || iterations.back().depth <= 0) return 0.0;
+    return std::pow(double(iterations.back().nodes), 1.0 / iterations.back().depth);
+}
+
+double SearchStats::nodesPerSecond() const {
+    return timeMs > 0 ? total.nodes * 1000.0 / timeMs : 0.0;
+}
+
+void SearchStats::add(const SearchStats& other) {
+    total.add(other.total);
+    if (threads.size() < other.threads.size()) threads.resize(other.threads.size());
+    for (size_t i = 0; i < other.threads.size(); i++) threads[i].add(other.threads[i]);
+    iterations = other.iterations;
+    timeMs += other.timeMs;
+}
+
+std::string statsSummary(const SearchStats& stats) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "nodes " << stats.total.nodes << " qnodes " << stats.total.qnodes
+        << " nps " << int64_t(stats.nodesPerSecond())
+        << " tthit " << stats.ttHitRate() * 100 << "%"
+        << " firstcut " << stats.firstMoveCutoffRate() * 100 << "%"
+        << " null " << stats.nullMoveSuccessRate() * 100 << "%"
+        << " lmr " << stats.lmrSuccessRate() * 100 << "%"
+        << std::setprecision(2) << " ebf " << stats.branchingFactor();
+    if (!stats.iterations.empty()) {
+        const IterationStats& last = stats.iterations.back();
+        int64_t previous = stats.iterations.size() > 1 ? stats.iterations[stats.iterations.size() - 2].timeMs : 0;
+        out << " depth " << last.depth << " itertime " << last.timeMs - previous;
+    }
+    return out.str();
+}
+
+static void writeTotalsJson(std::ostream& out, const StatsTotals& t) {
+    out << "{\"nodes\": " << t.nodes << ", \"qnodes\": " << t.qnodes
+        << ", \"tt_probes\": " << t.ttProbes << ", \"tt_hits\": " << t.ttHits
+        << ", \"beta_cutoffs\": " << t.betaCutoffs << ", \"first_move_cutoffs\": " << t.firstMoveCutoffs
+        << ", \"null_tries\": " << t.nullTries << ", \"null_cutoffs\": " << t.nullCutoffs
+        << ", \"lmr_tries\": " << t.lmrTries << ", \"lmr_researches\": " << t.lmrResearches << "}";
+}
+
+void writeStatsJson(std::ostream& out, const SearchStats& stats) {
+    out << std::fixed << std::setprecision(4);
+    out << "{\n  \"time_ms\": " << stats.timeMs
+        << ",\n  \"nps\": " << int64_t(stats.nodesPerSecond())
+        << ",\n  \"tt_hit_rate\": " << stats.ttHitRate()
+        << ",\n  \"first_move_cutoff_rate\": " << stats.firstMoveCutoffRate()
+        << ",\n  \"null_move_success_rate\": " << stats.nullMoveSuccessRate()
+        << ",\n  \"lmr_success_rate\": " << stats.lmrSuccessRate()
+        << ",\n  \"branching_factor\": " << stats.branchingFactor()
+        << ",\n  \"total\": ";
+    writeTotalsJson(out, stats.total);
+    out << ",\n  \"threads\": [";
+    for (size_t i = 0; i < stats.threads.size(); i++) {
+        out << (i ? ",\n    " : "\n    ");
+        writeTotalsJson(out, stats.threads[i]);
+    }
+    out << "\n  ],\n  \"iterations\": [";
+    for (size_t i = 0; i < stats.iterations.size(); i++) {
+        const IterationStats& it = stats.iterations[i];
+        out << (i ? ",\n    " : "\n    ")
+            << "{\"depth\": " << it.depth << ", \"nodes\": " << it.nodes << ", \"time_ms\": " << it.timeMs << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static void writeMetric(std::ostream& out, const std::string& name, const char* type, const char* help, double value) {
+    out << "# HELP chess_search_" << name << " " << help << "\n"
+        << "# TYPE chess_search_" << name << " " << type << "\n"
+        << "chess_search_" << name << " " << value << "\n";
+}
+
+void writeStatsPrometheus(std::ostream& out, const SearchStats& stats) {
+    const StatsTotals& t = stats.total;
+    out << std::setprecision(10);
+    writeMetric(out, "nodes_total", "counter", "Nodes searched", double(t.nodes));
+    writeMetric(out, "qnodes_total", "counter", "Quiescence nodes searched", double(t.qnodes));
+    writeMetric(out, "tt_probes_total", "counter", "Transposition table probes", double(t.ttProbes));
+    writeMetric(out, "tt_hits_total", "counter", "Transposition table hits", double(t.ttHits));
+    writeMetric(out, "beta_cutoffs_total", "counter", "Beta cutoffs", double(t.betaCutoffs));
+    writeMetric(out, "first_move_cutoffs_total", "counter", "Beta cutoffs on the first move", double(t.firstMoveCutoffs));
+    writeMetric(out, "null_tries_total", "counter", "Null move searches", double(t.nullTries));
+    writeMetric(out, "null_cutoffs_total", "counter", "Null move searches that failed high", double(t.nullCutoffs));
+    writeMetric(out, "lmr_tries_total", "counter", "Reduced late move searches", double(t.lmrTries));
+    writeMetric(out, "lmr_researches_total", "counter", "Reduced searches repeated at full depth", double(t.lmrResearches));
+    writeMetric(out, "time_seconds", "gauge", "Search time", stats.timeMs / 1000.0);
+    writeMetric(out, "nps", "gauge", "Nodes per second", stats.nodesPerSecond());
+    writeMetric(out, "tt_hit_ratio", "gauge", "Transposition table hit rate", stats.ttHitRate());
+    writeMetric(out, "branching_factor", "gauge", "Effective branching factor", stats.branchingFactor());
+
+    out << "# HELP chess_search_thread_nodes_total Nodes searched per thread\n"
+        << "# TYPE chess_search_thread_nodes_total counter\n";
+    for (size_t i = 0; i < stats.threads.size(); i++) {
+        out << "chess_search_thread_nodes_total{thread=\"" << i << "\"} " << stats.threads[i].nodes << "\n";
+    }
+    out << "# HELP chess_search_iteration_seconds Cumulative time at the end of each iteration\n"
+        << "# TYPE chess_search_iteration_seconds gauge\n";
+    for (const IterationStats& it : stats.iterations) {
+        out << "chess_search_iteration_seconds{depth=\"" << it.depth << "\"} " << it.timeMs / 1000.0 << "\n";
+    }
+}
+
+bool saveStatsPrometheus(const std::string& path, const SearchStats& stats) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) return false;
+        writeStatsPrometheus(file, stats);
+        if (!file) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
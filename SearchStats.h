@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Counter written by a single search thread and read by others: a relaxed
+// load + store instead of a locked read-modify-write
+struct StatCounter {
+    std::atomic<uint64_t> value{ 0 };
+
+    void add(uint64_t n = 1) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    void reset() { value.store(0, std::memory_order_relaxed); }
+};
+
+// Live counters owned by one search thread
+struct ThreadStats {
+    StatCounter qnodes;
+    StatCounter ttProbes;
+    StatCounter ttHits;
+    StatCounter betaCutoffs;
+    StatCounter firstMoveCutoffs;
+    StatCounter nullTries;
+    StatCounter nullCutoffs;
+    StatCounter lmrTries;
+    StatCounter lmrResearches;     // reduced search beat alpha and had to be repeated
+
+    void reset();
+};
+
+// Plain snapshot of the counters, summed over threads or for a single thread
+struct StatsTotals {
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+    uint64_t nullTries = 0;
+    uint64_t nullCutoffs = 0;
+    uint64_t lmrTries = 0;
+    uint64_t lmrResearches = 0;
+
+    void add(uint64_t threadNodes, const ThreadStats& stats);
+    void add(const StatsTotals& other);
+};
+
+struct IterationStats {
+    int depth = 0;
+    uint64_t nodes = 0;            // all threads, cumulative at the end of the iteration
+    int64_t timeMs = 0;            // cumulative
+};
+
+struct SearchStats {
+    StatsTotals total;
+    std::vector<StatsTotals> threads;
+    std::vector<IterationStats> iterations;
+    int64_t timeMs = 0;
+
+    double ttHitRate() const;
+    double firstMoveCutoffRate() const;
+    double nullMoveSuccessRate() const;
+    double lmrSuccessRate() const;
+    double branchingFactor() const;
+    double nodesPerSecond() const;
+
+    // Accumulates searches, e.g. over a bench run; iterations are those of the last one
+    void add(const SearchStats& other);
+};
+
+// One-line summary for `info string`
+std::string statsSummary(const SearchStats& stats);
+void writeStatsJson(std::ostream& out, const SearchStats& stats);
+void writeStatsPrometheus(std::ostream& out, const SearchStats& stats);
+// Written to a temporary file and renamed, so a scraper never reads half a file
+bool saveStatsPrometheus(const std::string& path, const SearchStats& stats);
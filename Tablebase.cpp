@@ -0,0 +1,457 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const Bitboard PawnSquares = 0x00FFFFFFFFFFFF00ULL;
+static const PieceType GroupOrder[4] = { PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight };
+static const char PieceLetters[] = " KQRBNP";
+
+static_assert(sizeof(TablebaseHeader) == 72, "the header is written as is");
+
+// Binomial coefficients C(n, k) for n < 65, k <= MaxTablebasePieces
+struct Binomials {
+    uint64_t value[65][MaxTablebasePieces + 1] = {};
+
+    Binomials() {
+        for (int n = 0; n <= 64; n++) {
+            value[n][0] = 1;
+            for (int k = 1; k <= MaxTablebasePieces && k <= n; k++) {
+                value[n][k] = value[n - 1][k - 1] + (k < n ? value[n - 1][k] : 0);
+            }
+        }
+    }
+};
+
+static const Binomials binomials;
+
+static uint64_t choose(int n, int k) {
+    return n < k ? 0 : binomials.value[n][k];
+}
+
+// Non-adjacent king placements under the symmetries, [0] without pawns, [1] with them
+struct KingPairs {
+    int16_t index[2][64][64];
+    std::vector<std::pair<int, int>> pairs[2];
+
+    KingPairs() {
+        for (int mode = 0; mode < 2; mode++) {
+            for (int white = 0; white < 64; white++) {
+                for (int black = 0; black < 64; black++) {
+                    index[mode][white][black] = -1;
+                    int wc = squareCol(white), wr = squareRow(white), bc = squareCol(black), br = squareRow(black);
+                    if (white == black || (kingAttacks[white] & squareBB(black))) continue;
+                    if (wc > 3) continue;
+                    if (mode == 0 && (wr > wc || (wr == wc && br > bc))) continue;
+                    index[mode][white][black] = int16_t(pairs[mode].size());
+                    pairs[mode].push_back({ white, black });
+                }
+            }
+        }
+    }
+};
+
+static const KingPairs& kingPairs() {
+    static const KingPairs table;
+    return table;
+}
+
+static int flipDiagonal(int sq) {
+    return (squareCol(sq) << 3) | squareRow(sq);
+}
+
+static int squareRank(Bitboard free, int sq) {
+    return popCount(free & (squareBB(sq) - 1));
+}
+
+static int selectSquare(Bitboard free, int rank) {
+    for (int i = 0; i < rank; i++) free &= free - 1;
+    return lsb(free);
+}
+
+int TablebaseMaterial::pieceCount() const {
+    int total = 2;
+    for (int color = 0; color < 2; color++) {
+        for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) total += counts[color][type];
+    }
+    return total;
+}
+
+uint32_t TablebaseMaterial::key() const {
+    uint32_t key = 0;
+    for (int color = 0; color < 2; color++) {
+        for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) {
+            key |= uint32_t(counts[color][type]) << (color * 15 + (type - int(PieceType::Queen)) * 3);
+        }
+    }
+    return key;
+}
+
+// Compares Queen..Pawn counts in that order; equal material is stronger both ways
+bool TablebaseMaterial::stronger(Color color) const {
+    int us = color == Color::White ? 0 : 1;
+    for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) {
+        if (counts[us][type] != counts[us ^ 1][type]) return counts[us][type] > counts[us ^ 1][type];
+    }
+    return true;
+}
+
+std::string TablebaseMaterial::name() const {
+    std::string text;
+    for (int color = 0; color < 2; color++) {
+        if (color) text += 'v';
+        text += 'K';
+        for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) {
+            text.append(counts[color][type], PieceLetters[type]);
+        }
+    }
+    return text;
+}
+
+bool TablebaseMaterial::parse(const std::string& text) {
+    *this = TablebaseMaterial();
+    size_t split = text.find('v');
+    if (split == std::string::npos) return false;
+    std::string sides[2] = { text.substr(0, split), text.substr(split + 1) };
+    for (int color = 0; color < 2; color++) {
+        if (sides[color].empty() || sides[color][0] != 'K') return false;
+        for (size_t i = 1; i < sides[color].size(); i++) {
+            const char* letter = std::strchr(PieceLetters + 2, sides[color][i]);
+            if (!letter || !*letter) return false;
+            counts[color][letter - PieceLetters]++;
+        }
+    }
+    return pieceCount() <= MaxTablebasePieces;
+}
+
+bool TablebaseLayout::setMaterial(const TablebaseMaterial& material) {
+    if (material.pieceCount() > MaxTablebasePieces) return false;
+    pieces = material;
+    pieceGroups.clear();
+    others = 0;
+    pawns = material.counts[0][int(PieceType::Pawn)] + material.counts[1][int(PieceType::Pawn)] > 0;
+
+    int first = 2;
+    for (int color = 0; color < 2; color++) {
+        int count = material.counts[color][int(PieceType::Pawn)];
+        if (count) pieceGroups.push_back({ Color(color), PieceType::Pawn, count, first });
+        first += count;
+    }
+    for (int color = 0; color < 2; color++) {
+        for (PieceType type : GroupOrder) {
+            int count = material.counts[color][int(type)];
+            if (count) pieceGroups.push_back({ Color(color), type, count, first });
+            first += count;
+        }
+    }
+    others = first - 2;
+
+    // Only the pawn groups' share of the board depends on where the kings are
+    offsets.clear();
+    uint64_t total = 0;
+    for (const auto& kings : kingPairs().pairs[pawns]) {
+        Bitboard kingsBB = squareBB(kings.first) | squareBB(kings.second);
+        int placed = 0;
+        uint64_t size = 1;
+        for (const Group& group : pieceGroups) {
+            int free = group.type == PieceType::Pawn ? popCount(PawnSquares & ~kingsBB) - placed : 62 - placed;
+            size *= choose(free, group.count);
+            placed += group.count;
+        }
+        offsets.push_back(total);
+        total += size;
+    }
+    offsets.push_back(total);
+    return true;
+}
+
+uint64_t TablebaseLayout::rawIndex(const int* squares) const {
+    uint64_t local = 0;
+    Bitboard occupied = squareBB(squares[0]) | squareBB(squares[1]);
+    for (const Group& group : pieceGroups) {
+        Bitboard free = (group.type == PieceType::Pawn ? PawnSquares : ~Bitboard(0)) & ~occupied;
+        int sorted[MaxTablebasePieces];
+        for (int i = 0; i < group.count; i++) {
+            int j = i;
+            for (; j > 0 && sorted[j - 1] > squares[group.first + i]; j--) sorted[j] = sorted[j - 1];
+            sorted[j] = squares[group.first + i];
+        }
+        uint64_t combination = 0;
+        for (int i = 0; i < group.count; i++) {
+            combination += choose(squareRank(free, sorted[i]), i + 1);
+            occupied |= squareBB(sorted[i]);
+        }
+        local = local * choose(popCount(free), group.count) + combination;
+    }
+    return offsets[kingPairs().index[pawns][squares[0]][squares[1]]] + local;
+}
+
+uint64_t TablebaseLayout::index(const int* squares) const {
+    int s[MaxTablebasePieces];
+    int count = pieceCount();
+    std::copy(squares, squares + count, s);
+
+    if (squareCol(s[0]) > 3) {
+        for (int i = 0; i < count; i++) s[i] ^= 7;
+    }
+    if (pawns) return rawIndex(s);
+
+    if (squareRow(s[0]) > 3) {
+        for (int i = 0; i < count; i++) s[i] ^= 56;
+    }
+    if (squareRow(s[0]) > squareCol(s[0])) {
+        for (int i = 0; i < count; i++) s[i] = flipDiagonal(s[i]);
+    }
+    if (squareRow(s[0]) == squareCol(s[0])) {
+        if (squareRow(s[1]) > squareCol(s[1])) {
+            for (int i = 0; i < count; i++) s[i] = flipDiagonal(s[i]);
+        }
+        else if (squareRow(s[1]) == squareCol(s[1])) {
+            uint64_t first = rawIndex(s);
+            for (int i = 0; i < count; i++) s[i] = flipDiagonal(s[i]);
+            return std::min(first, rawIndex(s));
+        }
+    }
+    return rawIndex(s);
+}
+
+void TablebaseLayout::decode(uint64_t index, int* squares) const {
+    size_t pair = std::upper_bound(offsets.begin(), offsets.end(), index) - offsets.begin() - 1;
+    squares[0] = kingPairs().pairs[pawns][pair].first;
+    squares[1] = kingPairs().pairs[pawns][pair].second;
+    uint64_t local = index - offsets[pair];
+
+    // Mixed radix: the last group is the least significant digit
+    Bitboard kingsBB = squareBB(squares[0]) | squareBB(squares[1]);
+    uint64_t combinations[8];
+    int placed = 0;
+    int frees[8];
+    for (size_t g = 0; g < pieceGroups.size(); g++) {
+        frees[g] = pieceGroups[g].type == PieceType::Pawn ? popCount(PawnSquares & ~kingsBB) - placed : 62 - placed;
+        placed += pieceGroups[g].count;
+    }
+    for (size_t g = pieceGroups.size(); g-- > 0;) {
+        uint64_t radix = choose(frees[g], pieceGroups[g].count);
+        combinations[g] = local % radix;
+        local /= radix;
+    }
+
+    Bitboard occupied = kingsBB;
+    for (size_t g = 0; g < pieceGroups.size(); g++) {
+        const Group& group = pieceGroups[g];
+        Bitboard free = (group.type == PieceType::Pawn ? PawnSquares : ~Bitboard(0)) & ~occupied;
+        uint64_t rest = combinations[g];
+        int rank = frees[g];
+        for (int i = group.count; i >= 1; i--) {
+            do rank--; while (choose(rank, i) > rest);
+            rest -= choose(rank, i);
+            squares[group.first + i - 1] = selectSquare(free, rank);
+        }
+        for (int i = 0; i < group.count; i++) occupied |= squareBB(squares[group.first + i]);
+    }
+}
+
+std::string tablebasePath(const std::string& directory, const TablebaseMaterial& material) {
+    return (directory.empty() ? "" : directory + "/") + material.name() + ".ctb";
+}
+
+struct Tablebases::Table {
+    TablebaseLayout layout;
+    const uint8_t* data = nullptr;
+    size_t bytes = 0;
+    const uint8_t* wdl[2] = {};
+    const uint8_t* dtm[2] = {};
+    int dtmBits = 1;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    ~Table() {
+        if (!data) return;
+#if defined(_WIN32)
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(const_cast<uint8_t*>(data), bytes);
+#endif
+    }
+
+    bool map(const std::string& path) {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        bytes = size_t(size.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return false;
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        return data != nullptr;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat info;
+        if (fstat(fd, &info) == -1 || info.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        data = static_cast<const uint8_t*>(mapped);
+        bytes = size_t(info.st_size);
+        return true;
+#endif
+    }
+};
+
+Tablebases::Tablebases() {
+}
+
+Tablebases::~Tablebases() {
+}
+
+void Tablebases::clear() {
+    tables.clear();
+    largest = 0;
+}
+
+int Tablebases::load(const std::string& directory) {
+    std::error_code error;
+    int added = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() == ".ctb" && add(entry.path().string())) added++;
+    }
+    if (error) std::cerr << "Cannot read " << directory << ": " << error.message() << std::endl;
+    return added;
+}
+
+bool Tablebases::add(const std::string& path) {
+    auto table = std::make_unique<Table>();
+    if (!table->map(path)) {
+        std::cerr << "Cannot map " << path << std::endl;
+        return false;
+    }
+    TablebaseHeader header;
+    TablebaseMaterial material;
+    bool valid = table->bytes >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, table->data, sizeof(header));
+        header.signature[sizeof(header.signature) - 1] = 0;
+        valid = std::memcmp(header.magic, TablebaseMagic, sizeof(TablebaseMagic)) == 0 && material.parse(header.signature)
+             && material.stronger(Color::White) && table->layout.setMaterial(material)
+             && header.positions == table->layout.size() && header.dtmBits >= 1 && header.dtmBits <= 16;
+    }
+    for (int side = 0; side < 2 && valid; side++) {
+        valid = header.wdlOffset[side] + packedBytes(header.positions, 2) <= table->bytes
+             && header.dtmOffset[side] + packedBytes(header.positions, header.dtmBits) <= table->bytes;
+        if (!valid) break;
+        table->wdl[side] = table->data + header.wdlOffset[side];
+        table->dtm[side] = table->data + header.dtmOffset[side];
+    }
+    if (!valid) {
+        std::cerr << path << " is not a tablebase file" << std::endl;
+        return false;
+    }
+    table->dtmBits = int(header.dtmBits);
+    largest = std::max(largest, material.pieceCount());
+    tables[material.key()] = std::move(table);
+    return true;
+}
+
+bool Tablebases::has(const TablebaseMaterial& material) const {
+    TablebaseMaterial flipped;
+    std::copy(&material.counts[0][0], &material.counts[0][0] + 7, &flipped.counts[1][0]);
+    std::copy(&material.counts[1][0], &material.counts[1][0] + 7, &flipped.counts[0][0]);
+    return tables.count(material.key()) || tables.count(flipped.key());
+}
+
+bool Tablebases::probeTable(const Position& pos, TablebaseResult& result) const {
+    TablebaseMaterial material;
+    for (int color = 0; color < 2; color++) {
+        for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) {
+            material.counts[color][type] = pos.pieceCount(Color(color), PieceType(type));
+        }
+    }
+    // A table whose White is the position's Black: swap colours and mirror the ranks
+    bool flip = false;
+    auto found = tables.find(material.key());
+    if (found == tables.end()) {
+        for (int type = 0; type < 7; type++) std::swap(material.counts[0][type], material.counts[1][type]);
+        found = tables.find(material.key());
+        if (found == tables.end()) return false;
+        flip = true;
+    }
+    const Table& table = *found->second;
+
+    int squares[MaxTablebasePieces];
+    int mirror = flip ? 56 : 0;
+    Color white = flip ? Color::Black : Color::White;
+    squares[0] = pos.kingSquare(white) ^ mirror;
+    squares[1] = pos.kingSquare(~white) ^ mirror;
+    for (const TablebaseLayout::Group& group : table.layout.groups()) {
+        Bitboard bb = pos.pieces(flip ? ~group.color : group.color, group.type);
+        for (int i = 0; i < group.count; i++) squares[group.first + i] = popLsb(bb) ^ mirror;
+    }
+    int side = (pos.sideToMove() == Color::White) != flip ? 0 : 1;
+
+    uint64_t index = table.layout.index(squares);
+    uint32_t wdl = readPacked(table.wdl[side], index, 2);
+    if (wdl == WdlInvalid) return false;
+    result.wdl = wdl == WdlWin ? 1 : wdl == WdlLoss ? -1 : 0;
+    result.dtm = int(readPacked(table.dtm[side], index, table.dtmBits));
+    return true;
+}
+
+// Win sooner > draw > lose later
+static bool betterResult(const TablebaseResult& a, const TablebaseResult& b) {
+    if (a.wdl != b.wdl) return a.wdl > b.wdl;
+    return a.wdl > 0 ? a.dtm < b.dtm : a.wdl < 0 && a.dtm > b.dtm;
+}
+
+bool Tablebases::probe(Position& pos, TablebaseResult& result) const {
+    int pieces = popCount(pos.occupied());
+    if (pieces == 2) {
+        result = TablebaseResult();
+        return true;
+    }
+    if (pieces > largest || pos.castlingRights()) return false;
+    if (pos.epSquare() == -1) return probeTable(pos, result);
+
+    // The en passant capture is one more move than the table knows about
+    MoveList moves;
+    pos.generateLegal(moves);
+    TablebaseResult best;
+    best.wdl = -2;
+    for (PackedMove move : moves) {
+        TablebaseResult child;
+        pos.makeMove(move);
+        bool found = probe(pos, child);
+        pos.unmakeMove(move);
+        if (!found) return false;
+        TablebaseResult ours;
+        ours.wdl = -child.wdl;
+        ours.dtm = child.wdl ? child.dtm + 1 : 0;
+        if (best.wdl == -2 || betterResult(ours, best)) best = ours;
+    }
+    if (best.wdl == -2) {
+        best.wdl = pos.inCheck() ? -1 : 0;
+        best.dtm = 0;
+    }
+    result = best;
+    return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "Position.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Endgame tablebases made by TablebaseGenerator: one file per material
+// signature ("KQvKR": the stronger side is White) holding, for both sides to
+// move, a 2-bit win/draw/loss array and a bit-packed distance-to-mate array.
+// Files are memory-mapped read-only, so any number of search threads can probe.
+//
+// Results ignore the fifty-move rule. En passant rights are not part of the
+// index: a double push is generated as leading to the position without them,
+// and probe() resolves a position that has an en passant square by looking
+// one ply ahead.
+
+const int MaxTablebasePieces = 5;      // kings included
+
+struct TablebaseResult {
+    int wdl = 0;                        // side to move: 1 win, 0 draw, -1 loss
+    int dtm = 0;                        // plies to mate with best play, 0 for draws
+};
+
+// Piece counts of one side, Queen..Pawn; 3 bits each in a material key
+struct TablebaseMaterial {
+    int counts[2][7] = {};              // [colour][PieceType]
+
+    int pieceCount() const;
+    uint32_t key() const;
+    bool stronger(Color color) const;   // the side that is White in the table's file
+    std::string name() const;           // "KQvKR"
+    bool parse(const std::string& name);
+};
+
+// Gap-free index of the placements of one signature. Kings come first, as
+// a pair under the board's symmetries: 462 placements without pawns (White's
+// king in the a1-d1-d4 triangle), 1806 with them (White's king on files a-d).
+// Each group of identical pieces, pawns first, is then ranked as a
+// combination of the squares still free, so identical pieces are counted once.
+// Placements with both kings on the long diagonal appear twice, mirrored;
+// index() always picks the smaller one.
+class TablebaseLayout {
+public:
+    struct Group {
+        Color color;
+        PieceType type;
+        int count;
+        int first;                      // offset in a squares array
+    };
+
+    bool setMaterial(const TablebaseMaterial& material);
+    const TablebaseMaterial& material() const { return pieces; }
+    uint64_t size() const { return offsets.back(); }    // positions per side to move
+    int pieceCount() const { return 2 + others; }
+    bool hasPawns() const { return pawns; }
+    const std::vector<Group>& groups() const { return pieceGroups; }
+
+    // squares: White king, Black king, then each group in order, any order
+    // inside a group. index() applies the symmetries, decode() returns the
+    // stored placement with every group sorted.
+    uint64_t index(const int* squares) const;
+    void decode(uint64_t index, int* squares) const;
+
+private:
+    uint64_t rawIndex(const int* squares) const;
+
+    TablebaseMaterial pieces;
+    std::vector<Group> pieceGroups;
+    std::vector<uint64_t> offsets;      // first index of each king pair, then the total
+    int others = 0;
+    bool pawns = false;
+};
+
+// File header; the arrays follow at the given offsets, 64-byte aligned
+const char TablebaseMagic[8] = { 'C', 'H', 'E', 'S', 'S', 'T', 'B', 1 };
+
+struct TablebaseHeader {
+    char magic[8];                      // "CHESSTB" + format version
+    char signature[16];                 // zero padded
+    uint64_t positions;                 // per side to move
+    uint32_t dtmBits;
+    uint32_t maxDtm;
+    uint64_t wdlOffset[2];              // by side to move
+    uint64_t dtmOffset[2];
+};
+
+// WDL codes of the packed array
+enum TablebaseWdlCode {
+    WdlDraw = 0, WdlWin = 1, WdlLoss = 2, WdlInvalid = 3
+};
+
+// Packed arrays are padded by 8 bytes so an entry is one unaligned 64-bit read
+inline uint32_t readPacked(const uint8_t* data, uint64_t index, int bits) {
+    uint64_t bit = index * bits;
+    uint64_t word;
+    std::memcpy(&word, data + bit / 8, 8);
+    return uint32_t(word >> (bit & 7)) & ((1u << bits) - 1);
+}
+
+inline uint64_t packedBytes(uint64_t entries, int bits) {
+    return (entries * bits + 63) / 64 * 8 + 8;
+}
+
+class Tablebases {
+public:
+    Tablebases();
+    ~Tablebases();
+    Tablebases(const Tablebases&) = delete;
+    Tablebases& operator=(const Tablebases&) = delete;
+
+    // Maps every .ctb file of the directory; returns how many tables were added
+    int load(const std::string& directory);
+    bool add(const std::string& path);
+    void clear();
+    size_t tableCount() const { return tables.size(); }
+    int maxPieces() const { return largest; }
+    bool has(const TablebaseMaterial& material) const;
+
+    // False when the position is not covered: too many pieces, castling rights
+    // or no table. pos is left as it was; it is only changed to look past an
+    // en passant square.
+    bool probe(Position& pos, TablebaseResult& result) const;
+
+private:
+    struct Table;
+
+    bool probeTable(const Position& pos, TablebaseResult& result) const;
+
+    std::unordered_map<uint32_t, std::unique_ptr<Table>> tables;
+    int largest = 0;
+};
+
+// The table file name of a signature inside a directory
+std::string tablebasePath(const std::string& directory, const TablebaseMaterial& material);
@@ -0,0 +1,497 @@
+#include "TablebaseGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+static const uint64_t ChunkSize = 4096;    // a multiple of 64: threads never share a packed word
+
+// Working values: below WinFlag a position is undecided and the value is the
+// longest loss among its captures and promotions (the least its own loss can take)
+static const uint16_t WinFlag = 0x4000;
+static const uint16_t LossFlag = 0x8000;
+static const uint16_t DtmMask = 0x3FFF;
+static const uint16_t Stalemate = 0xFFFE;
+static const uint16_t Invalid = 0xFFFF;
+
+static bool undecided(uint16_t value) { return value < WinFlag; }
+static bool isWin(uint16_t value) { return (value & 0xC000) == WinFlag; }
+static bool isLoss(uint16_t value) { return (value & 0xC000) == LossFlag; }
+
+static int64_t elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+// A double push after which the opponent wins by capturing en passant: the
+// move loses in `plies` at the latest, sooner only if the successor without
+// the en passant right is a faster win for the opponent
+struct DelayedLoss {
+    int side;
+    uint64_t index;
+    uint64_t successor;
+    int plies;
+};
+
+struct TablebaseGenerator::Work {
+    TablebaseLayout layout;
+    std::unique_ptr<std::atomic<uint16_t>[]> values[2];     // by side to move
+    std::unique_ptr<std::atomic<uint8_t>[]> undecidedMoves[2];
+    std::atomic<int> deepest{ 0 };                          // longest distance assigned so far
+    std::atomic<uint64_t> legal[2];
+    std::atomic<bool> missingTable{ false };
+    std::mutex delayedMutex;
+    std::vector<DelayedLoss> delayed;
+
+    void reached(int plies) {
+        int seen = deepest.load(std::memory_order_relaxed);
+        while (plies > seen && !deepest.compare_exchange_weak(seen, plies, std::memory_order_relaxed)) {}
+    }
+
+    // A move to a loss for the opponent; a shorter win replaces one found through a capture
+    void win(int side, uint64_t index, int plies) {
+        std::atomic<uint16_t>& target = values[side][index];
+        uint16_t current = target.load(std::memory_order_relaxed);
+        while ((undecided(current) || (isWin(current) && (current & DtmMask) > plies))
+               && !target.compare_exchange_weak(current, uint16_t(WinFlag | plies), std::memory_order_relaxed)) {}
+        if (target.load(std::memory_order_relaxed) == (WinFlag | plies)) reached(plies);
+    }
+
+    // A move to a win for the opponent; the last undecided one makes a loss
+    void refute(int side, uint64_t index, int plies) {
+        std::atomic<uint16_t>& target = values[side][index];
+        uint16_t current = target.load(std::memory_order_relaxed);
+        if (!undecided(current)) return;
+        if (undecidedMoves[side][index].fetch_sub(1, std::memory_order_relaxed) != 1) return;
+        while (undecided(current)) {
+            uint16_t loss = uint16_t(LossFlag | std::max<int>(plies, current));
+            if (target.compare_exchange_weak(current, loss, std::memory_order_relaxed)) {
+                reached(loss & DtmMask);
+                break;
+            }
+        }
+    }
+};
+
+static void setUp(Position& pos, const TablebaseLayout& layout, const int* squares, int side) {
+    PositionSnapshot snapshot = {};
+    auto place = [&](int sq, PieceType type, Color color) {
+        snapshot.squares[sq / 2] |= uint8_t(((color == Color::Black ? 8 : 0) | int(type)) << (sq & 1) * 4);
+    };
+    place(squares[0], PieceType::King, Color::White);
+    place(squares[1], PieceType::King, Color::Black);
+    for (const TablebaseLayout::Group& group : layout.groups()) {
+        for (int i = 0; i < group.count; i++) place(squares[group.first + i], group.type, group.color);
+    }
+    snapshot.side = uint8_t(side);
+    snapshot.epSquare = -1;
+    snapshot.fullmoveNumber = 1;
+    pos.restore(snapshot);
+}
+
+TablebaseMaterial canonicalMaterial(const TablebaseMaterial& material) {
+    if (material.stronger(Color::White)) return material;
+    TablebaseMaterial flipped;
+    for (int type = 0; type < 7; type++) {
+        flipped.counts[0][type] = material.counts[1][type];
+        flipped.counts[1][type] = material.counts[0][type];
+    }
+    return flipped;
+}
+
+// Promotion with capture is a capture of the promoted material, so one step of each is enough
+std::vector<TablebaseMaterial> tablebaseSuccessors(const TablebaseMaterial& material) {
+    std::vector<TablebaseMaterial> successors;
+    auto addUnique = [&](const TablebaseMaterial& next) {
+        TablebaseMaterial canonical = canonicalMaterial(next);
+        if (canonical.pieceCount() == 2) return;
+        for (const TablebaseMaterial& known : successors) {
+            if (known.key() == canonical.key()) return;
+        }
+        successors.push_back(canonical);
+    };
+    for (int color = 0; color < 2; color++) {
+        for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) {
+            if (!material.counts[color][type]) continue;
+            TablebaseMaterial captured = material;
+            captured.counts[color][type]--;
+            addUnique(captured);
+        }
+        if (!material.counts[color][int(PieceType::Pawn)]) continue;
+        for (int type = int(PieceType::Queen); type <= int(PieceType::Knight); type++) {
+            TablebaseMaterial promoted = material;
+            promoted.counts[color][int(PieceType::Pawn)]--;
+            promoted.counts[color][type]++;
+            addUnique(promoted);
+        }
+    }
+    return successors;
+}
+
+TablebaseGenerator::TablebaseGenerator(const std::string& directory, int threads, Tablebases& tables)
+    : directory(directory), threads(std::max(1, threads)), tables(tables) {
+}
+
+template <typename Range>
+void TablebaseGenerator::parallelFor(uint64_t count, Range range) {
+    std::atomic<uint64_t> next{ 0 };
+    auto run = [&] {
+        while (true) {
+            uint64_t begin = next.fetch_add(ChunkSize, std::memory_order_relaxed);
+            if (begin >= count) break;
+            range(begin, std::min(count, begin + ChunkSize));
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (int t = 1; t < threads; t++) helpers.emplace_back(run);
+    run();
+    for (std::thread& helper : helpers) helper.join();
+}
+
+bool TablebaseGenerator::generate(const TablebaseMaterial& material, std::vector<TablebaseGenStats>& generated) {
+    TablebaseMaterial canonical = canonicalMaterial(material);
+    if (canonical.pieceCount() == 2 || tables.has(canonical)) return true;
+    for (const TablebaseMaterial& successor : tablebaseSuccessors(canonical)) {
+        if (!generate(successor, generated)) return false;
+    }
+    TablebaseGenStats stats;
+    if (!generateOne(canonical, stats)) return false;
+    generated.push_back(stats);
+    return true;
+}
+
+bool TablebaseGenerator::generateOne(const TablebaseMaterial& material, TablebaseGenStats& stats) {
+    Work work;
+    if (!work.layout.setMaterial(material)) return false;
+    uint64_t size = work.layout.size();
+    stats.name = material.name();
+    stats.positions = size;
+    for (int side = 0; side < 2; side++) {
+        work.values[side].reset(new std::atomic<uint16_t>[size]);
+        work.undecidedMoves[side].reset(new std::atomic<uint8_t>[size]);
+        work.legal[side] = 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int side = 0; side < 2; side++) {
+        parallelFor(size, [&](uint64_t begin, uint64_t end) { initialize(work, side, begin, end); });
+    }
+    if (work.missingTable) {
+        std::cerr << stats.name << ": a capture or promotion leads to a table that is not loaded" << std::endl;
+        return false;
+    }
+    stats.initMs = elapsedMs(start);
+    for (int side = 0; side < 2; side++) stats.legal[side] = work.legal[side];
+
+    // Everything decided at plies - 1 is final before iteration `plies` reads it
+    start = std::chrono::steady_clock::now();
+    for (int plies = 1; plies <= work.deepest.load() + 1; plies++) {
+        for (int side = 0; side < 2; side++) {
+            parallelFor(size, [&](uint64_t begin, uint64_t end) { retract(work, side, begin, end, plies); });
+        }
+        for (const DelayedLoss& delayed : work.delayed) {
+            if (delayed.plies != plies) continue;
+            uint16_t reply = work.values[delayed.side ^ 1][delayed.successor].load(std::memory_order_relaxed);
+            if (!isWin(reply) || (reply & DtmMask) >= plies) work.refute(delayed.side, delayed.index, plies);
+        }
+        stats.iterations++;
+    }
+    stats.retroMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    bool written = write(work, stats);
+    stats.writeMs = elapsedMs(start);
+    return written;
+}
+
+void TablebaseGenerator::initialize(Work& work, int side, uint64_t begin, uint64_t end) {
+    const TablebaseLayout& layout = work.layout;
+    Color us = side == 0 ? Color::White : Color::Black;
+    Position pos;
+    pos.reserveHistory(4);
+    uint64_t legal = 0;
+    std::vector<DelayedLoss> delayed;
+
+    for (uint64_t index = begin; index < end; index++) {
+        std::atomic<uint16_t>& value = work.values[side][index];
+        work.undecidedMoves[side][index].store(0, std::memory_order_relaxed);
+        int squares[MaxTablebasePieces];
+        layout.decode(index, squares);
+        if (layout.index(squares) != index) {
+            value.store(Invalid, std::memory_order_relaxed);     // the mirrored twin is the one used
+            continue;
+        }
+
+        setUp(pos, layout, squares, side);
+        if (pos.isSquareAttacked(pos.kingSquare(~us), us)) {
+            value.store(Invalid, std::memory_order_relaxed);
+            continue;
+        }
+        legal++;
+
+        MoveList moves;
+        pos.generateLegal(moves);
+        if (moves.empty()) {
+            value.store(pos.inCheck() ? LossFlag : Stalemate, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Moves inside the table are counted once per distinct successor: two
+        // moves to mirror images of one position are retracted as one
+        uint64_t successors[256];
+        int successorCount = 0;
+        int drawingExits = 0;
+        int fastestWin = -1;
+        int longestLoss = 0;
+        for (PackedMove move : moves) {
+            if (isCaptureMove(move) || isPromotionMove(move)) {
+                TablebaseResult result;
+                pos.makeMove(move);
+                bool found = tables.probe(pos, result);
+                pos.unmakeMove(move);
+                if (!found) {
+                    work.missingTable = true;
+                    return;
+                }
+                if (result.wdl < 0 && (fastestWin == -1 || result.dtm + 1 < fastestWin)) fastestWin = result.dtm + 1;
+                else if (result.wdl == 0) drawingExits++;
+                else if (result.wdl > 0) longestLoss = std::max(longestLoss, result.dtm + 1);
+                continue;
+            }
+            int next[MaxTablebasePieces];
+            std::copy(squares, squares + layout.pieceCount(), next);
+            for (int i = 0; i < layout.pieceCount(); i++) {
+                if (next[i] == moveFrom(move)) next[i] = moveTo(move);
+            }
+            successors[successorCount++] = layout.index(next);
+            if (moveFlag(move) == FlagDoublePush) {
+                TablebaseResult reply;
+                pos.makeMove(move);
+                if (bestEnPassant(work, pos, reply) && reply.wdl > 0) {
+                    delayed.push_back({ side, index, successors[successorCount - 1], reply.dtm + 1 });
+                    work.reached(reply.dtm + 1);
+                }
+                pos.unmakeMove(move);
+            }
+        }
+        std::sort(successors, successors + successorCount);
+        int distinct = int(std::unique(successors, successors + successorCount) - successors);
+        work.undecidedMoves[side][index].store(uint8_t(distinct + drawingExits), std::memory_order_relaxed);
+
+        if (fastestWin != -1) {
+            value.store(uint16_t(WinFlag | fastestWin), std::memory_order_relaxed);
+            work.reached(fastestWin);
+        }
+        else if (distinct + drawingExits == 0) {
+            value.store(uint16_t(LossFlag | longestLoss), std::memory_order_relaxed);
+            work.reached(longestLoss);
+        }
+        else {
+            value.store(uint16_t(longestLoss), std::memory_order_relaxed);
+        }
+    }
+    work.legal[side] += legal;
+    if (!delayed.empty()) {
+        std::lock_guard<std::mutex> lock(work.delayedMutex);
+        work.delayed.insert(work.delayed.end(), delayed.begin(), delayed.end());
+    }
+}
+
+// The best en passant capture for the side to move right after a double
+// push; false when there is none
+bool TablebaseGenerator::bestEnPassant(Work& work, Position& pos, TablebaseResult& best) {
+    if (pos.epSquare() == -1) return false;
+    MoveList moves;
+    pos.generateLegal(moves);
+    bool found = false;
+    for (PackedMove move : moves) {
+        if (moveFlag(move) != FlagEnPassant) continue;
+        TablebaseResult child;
+        pos.makeMove(move);
+        bool probed = tables.probe(pos, child);
+        pos.unmakeMove(move);
+        if (!probed) {
+            work.missingTable = true;
+            continue;
+        }
+        TablebaseResult ours;
+        ours.wdl = -child.wdl;
+        ours.dtm = child.wdl ? child.dtm + 1 : 0;
+        if (!found || ours.wdl > best.wdl || (ours.wdl == best.wdl && (ours.wdl > 0 ? ours.dtm < best.dtm : ours.dtm > best.dtm))) {
+            best = ours;
+        }
+        found = true;
+    }
+    return found;
+}
+
+// Positions of `side` decided at plies - 1 make their predecessors (the
+// other side to move, one reverse move earlier) wins or, with their last
+// undecided move gone, losses at `plies`
+void TablebaseGenerator::retract(Work& work, int side, uint64_t begin, uint64_t end, int plies) {
+    const TablebaseLayout& layout = work.layout;
+    const auto& groups = layout.groups();
+    int mover = side ^ 1;
+    Color moverColor = mover == 0 ? Color::White : Color::Black;
+    Position pos;
+    pos.reserveHistory(4);
+
+    for (uint64_t index = begin; index < end; index++) {
+        uint16_t value = work.values[side][index].load(std::memory_order_relaxed);
+        bool lost = value == (LossFlag | (plies - 1));
+        if (!lost && value != (WinFlag | (plies - 1))) continue;
+
+        int squares[MaxTablebasePieces];
+        layout.decode(index, squares);
+        Bitboard occupied = 0;
+        for (int i = 0; i < layout.pieceCount(); i++) occupied |= squareBB(squares[i]);
+
+        uint64_t predecessors[256];
+        int count = 0;
+        int pushes[MaxTablebasePieces][2];      // piece, origin
+        int pushCount = 0;
+        auto retreat = [&](int piece, Bitboard origins) {
+            int target = squares[piece];
+            while (origins) {
+                squares[piece] = popLsb(origins);
+                predecessors[count++] = layout.index(squares);
+            }
+            squares[piece] = target;
+        };
+        retreat(mover, kingAttacks[squares[mover]] & ~kingAttacks[squares[side]] & ~occupied);
+        for (const TablebaseLayout::Group& group : groups) {
+            if (group.color != moverColor) continue;
+            for (int i = group.first; i < group.first + group.count; i++) {
+                int sq = squares[i];
+                Bitboard origins = 0;
+                switch (group.type) {
+                case PieceType::Queen: origins = queenAttacks(sq, occupied); break;
+                case PieceType::Rook: origins = rookAttacks(sq, occupied); break;
+                case PieceType::Bishop: origins = bishopAttacks(sq, occupied); break;
+                case PieceType::Knight: origins = knightAttacks[sq]; break;
+                case PieceType::Pawn: {
+                    // Never from the first rank; a double push needs both squares behind empty
+                    int back = moverColor == Color::White ? -8 : 8;
+                    int startRow = moverColor == Color::White ? 1 : 6;
+                    int row = squareRow(sq + back);
+                    if (row == 0 || row == 7 || (occupied & squareBB(sq + back))) break;
+                    origins = squareBB(sq + back);
+                    if (row + (moverColor == Color::White ? -1 : 1) == startRow && !(occupied & squareBB(sq + 2 * back))) {
+                        pushes[pushCount][0] = i;
+                        pushes[pushCount++][1] = sq + 2 * back;
+                    }
+                    break;
+                }
+                default: break;
+                }
+                retreat(i, origins & ~occupied);
+            }
+        }
+
+        // After a double push that allows an en passant capture the opponent
+        // has the better of this position and the capture. Pawn tables have
+        // no mirror-symmetric positions, so these need no deduplication.
+        for (int i = 0; i < pushCount; i++) {
+            int piece = pushes[i][0];
+            int target = squares[piece];
+            squares[piece] = pushes[i][1];
+            uint64_t predecessor = layout.index(squares);
+            if (work.values[mover][predecessor].load(std::memory_order_relaxed) == Invalid) {
+                squares[piece] = target;
+                continue;
+            }
+            setUp(pos, layout, squares, mover);
+            squares[piece] = target;
+            TablebaseResult reply;
+            pos.makeMove(packMove(pushes[i][1], target, FlagDoublePush));
+            bool capture = bestEnPassant(work, pos, reply);
+            if (!capture) predecessors[count++] = predecessor;
+            else if (lost && reply.wdl < 0) work.win(mover, predecessor, std::max(plies, reply.dtm + 1));
+            else if (!lost && (reply.wdl <= 0 || reply.dtm + 1 >= plies)) work.refute(mover, predecessor, plies);
+        }
+
+        std::sort(predecessors, predecessors + count);
+        count = int(std::unique(predecessors, predecessors + count) - predecessors);
+        for (int i = 0; i < count; i++) {
+            if (lost) work.win(mover, predecessors[i], plies);
+            else work.refute(mover, predecessors[i], plies);
+        }
+    }
+}
+
+bool TablebaseGenerator::write(Work& work, TablebaseGenStats& stats) {
+    uint64_t size = work.layout.size();
+    int maxDtm = 0;
+    for (int side = 0; side < 2; side++) {
+        for (uint64_t index = 0; index < size; index++) {
+            uint16_t value = work.values[side][index].load(std::memory_order_relaxed);
+            if (value == Invalid) continue;
+            if (isWin(value)) stats.wins[side]++;
+            else if (isLoss(value)) stats.losses[side]++;
+            else stats.draws[side]++;
+            if (isWin(value) || isLoss(value)) maxDtm = std::max(maxDtm, value & DtmMask);
+        }
+    }
+    int dtmBits = 1;
+    while ((1 << dtmBits) <= maxDtm) dtmBits++;
+    stats.maxDtm = maxDtm;
+    stats.dtmBits = dtmBits;
+
+    std::vector<uint64_t> wdl[2], dtm[2];
+    for (int side = 0; side < 2; side++) {
+        wdl[side].assign(packedBytes(size, 2) / 8, 0);
+        dtm[side].assign(packedBytes(size, dtmBits) / 8, 0);
+        auto put = [](std::vector<uint64_t>& words, uint64_t index, int bits, uint64_t value) {
+            uint64_t bit = index * bits;
+            words[bit / 64] |= value << (bit & 63);
+            if ((bit & 63) + bits > 64) words[bit / 64 + 1] |= value >> (64 - (bit & 63));
+        };
+        parallelFor(size, [&](uint64_t begin, uint64_t end) {
+            for (uint64_t index = begin; index < end; index++) {
+                uint16_t value = work.values[side][index].load(std::memory_order_relaxed);
+                uint64_t code = value == Invalid ? WdlInvalid : isWin(value) ? WdlWin : isLoss(value) ? WdlLoss : WdlDraw;
+                put(wdl[side], index, 2, code);
+                if (isWin(value) || isLoss(value)) put(dtm[side], index, dtmBits, value & DtmMask);
+            }
+        });
+    }
+
+    TablebaseHeader header = {};
+    std::memcpy(header.magic, TablebaseMagic, sizeof(TablebaseMagic));
+    std::strncpy(header.signature, stats.name.c_str(), sizeof(header.signature) - 1);
+    header.positions = size;
+    header.dtmBits = uint32_t(dtmBits);
+    header.maxDtm = uint32_t(maxDtm);
+    uint64_t offset = 64 * ((sizeof(header) + 63) / 64);
+    for (int side = 0; side < 2; side++) {
+        header.wdlOffset[side] = offset;
+        offset += (wdl[side].size() * 8 + 63) / 64 * 64;
+        header.dtmOffset[side] = offset;
+        offset += (dtm[side].size() * 8 + 63) / 64 * 64;
+    }
+
+    std::string path = tablebasePath(directory, work.layout.material());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    auto writeAt = [&](uint64_t position, const void* data, size_t bytes) {
+        static const char zeros[64] = {};
+        while (uint64_t(file.tellp()) < position) file.write(zeros, std::min<uint64_t>(64, position - file.tellp()));
+        file.write((const char*)data, bytes);
+    };
+    writeAt(0, &header, sizeof(header));
+    for (int side = 0; side < 2; side++) {
+        writeAt(header.wdlOffset[side], wdl[side].data(), wdl[side].size() * 8);
+        writeAt(header.dtmOffset[side], dtm[side].data(), dtm[side].size() * 8);
+    }
+    file.close();
+    if (!file) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    stats.fileBytes = offset;
+    return tables.add(path);
+}
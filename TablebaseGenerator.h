@@ -0,0 +1,62 @@
+#pragma once
+#include "Tablebase.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct TablebaseGenStats {
+    std::string name;
+    uint64_t positions = 0;            // index size, per side to move
+    uint64_t legal[2] = {};            // by side to move
+    uint64_t wins[2] = {};
+    uint64_t draws[2] = {};
+    uint64_t losses[2] = {};
+    int maxDtm = 0;                    // plies
+    int dtmBits = 0;
+    int iterations = 0;
+    uint64_t fileBytes = 0;
+    int64_t initMs = 0;                // move generation and probes of smaller tables
+    int64_t retroMs = 0;               // retrograde iterations
+    int64_t writeMs = 0;               // packing and writing
+};
+
+// Retrograde generator. Every position of a signature is first classified by
+// its own moves: mate, stalemate, or a count of the moves that stay in the
+// table, with captures and promotions resolved by probing the smaller tables.
+// Iteration n then walks back from the positions decided at n - 1 plies with
+// reverse moves: a predecessor of a loss wins in n, a predecessor of a win
+// loses in n once none of its moves is left undecided. Whatever is left
+// undecided at the end is a draw. A double push that allows an en passant
+// capture leads to the better of the table value and the capture for the
+// opponent. Both passes split the index into ranges that the threads take in
+// turn; updates are lock-free atomics.
+class TablebaseGenerator {
+public:
+    TablebaseGenerator(const std::string& directory, int threads, Tablebases& tables);
+
+    // Generates the table and first every smaller one its captures and
+    // promotions lead to that is not loaded yet; each new table is written to
+    // the directory and added to `tables`. Stats come smallest table first.
+    bool generate(const TablebaseMaterial& material, std::vector<TablebaseGenStats>& generated);
+
+private:
+    struct Work;
+
+    bool generateOne(const TablebaseMaterial& material, TablebaseGenStats& stats);
+    void initialize(Work& work, int side, uint64_t begin, uint64_t end);
+    void retract(Work& work, int side, uint64_t begin, uint64_t end, int plies);
+    bool bestEnPassant(Work& work, Position& pos, TablebaseResult& best);
+    bool write(Work& work, TablebaseGenStats& stats);
+    template <typename Range> void parallelFor(uint64_t count, Range range);
+
+    std::string directory;
+    int threads;
+    Tablebases& tables;
+};
+
+// Signatures reached by one capture or promotion, stronger side first; bare kings are left out
+std::vector<TablebaseMaterial> tablebaseSuccessors(const TablebaseMaterial& material);
+// The same material with the stronger side as White
+TablebaseMaterial canonicalMaterial(const TablebaseMaterial& material);
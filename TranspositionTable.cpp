@@ -0,0 +1,63 @@
+#include "TranspositionTable.h"
+#include <algorithm>
+
+// data layout: move (16) | score (16) | depth (8) | bound (8)
+static uint64_t packEntry(PackedMove move, int score, int depth, Bound bound) {
+    return uint64_t(move) | (uint64_t(uint16_t(int16_t(score))) << 16)
+         | (uint64_t(uint8_t(depth)) << 32) | (uint64_t(bound) << 40);
+}
+
+TranspositionTable::TranspositionTable() {
+    resize(16);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024) count *= 2;
+    std::vector<Slot> fresh(count);
+    slots.swap(fresh);
+    mask = count - 1;
+}
+
+void TranspositionTable::clear() {
+    for (Slot& slot : slots) {
+        slot.check.store(0, std::memory_order_relaxed);
+        slot.data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    const Slot& slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || data == 0) return false;
+
+    entry.move = PackedMove(data & 0xFFFF);
+    entry.score = int16_t(uint16_t(data >> 16));
+    entry.depth = int8_t(uint8_t(data >> 32));
+    entry.bound = Bound((data >> 40) & 3);
+    return true;
+}
+
+// Depth-preferred, but always replace entries for a different position
+void TranspositionTable::store(uint64_t key, PackedMove move, int score, int depth, Bound bound) {
+    Slot& slot = slots[key & mask];
+    uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+    uint64_t oldKey = slot.check.load(std::memory_order_relaxed) ^ oldData;
+    if (oldKey == key && oldData != 0) {
+        if (bound != BoundExact && depth < int8_t(uint8_t(oldData >> 32)) - 2) return;
+        if (move == NullMove) move = PackedMove(oldData & 0xFFFF);
+    }
+    uint64_t data = packEntry(move, score, depth, bound);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(1000, slots.size());
+    int used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        if (slots[i].data.load(std::memory_order_relaxed) != 0) used++;
+    }
+    return int(used * 1000 / sample);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Position.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum Bound : uint8_t {
+    BoundNone = 0, BoundUpper = 1, BoundLower = 2, BoundExact = 3
+};
+
+struct TTEntry {
+    PackedMove move = NullMove;
+    int score = 0;
+    int depth = 0;
+    Bound bound = BoundNone;
+};
+
+// Shared hash table for all search threads. Each slot stores key ^ data next
+// to data, so a torn write from another thread is detected as a miss instead
+// of returning a corrupted entry.
+class TranspositionTable {
+public:
+    TranspositionTable();
+    void resize(size_t megabytes);
+    void clear();
+
+    bool probe(uint64_t key, TTEntry& entry) const;
+    void store(uint64_t key, PackedMove move, int score, int depth, Bound bound);
+    int hashfull() const;   // permille of sampled slots in use
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{ 0 };
+        std::atomic<uint64_t> data{ 0 };
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+};
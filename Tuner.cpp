@@ -0,0 +1,333 @@
+#include "Tuner.h"
+#include "EvalParams.h"
+#include "Pgn.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+static int materialIndex(int type) { return type; }
+static int pstIndex(int type, int square) { return 7 + type * 64 + square; }
+
+size_t TuningSet::bytes() const {
+    return result.size() * sizeof(float) + phase.size() * sizeof(float) + blockSlot.size() * sizeof(uint32_t)
+         + index.size() * sizeof(uint16_t) + coefficient.size() * sizeof(int8_t);
+}
+
+// Same terms as evaluate(): kings' material cancels and a White and a Black
+// piece on mirrored squares cancel in the tables, so neither is stored
+void TuningSet::add(const Position& pos, float whiteResult) {
+    int coefficients[MgParameterCount] = {};
+    int phaseSum = 0;
+    for (int c = 0; c < 2; c++) {
+        Color color = c == 0 ? Color::White : Color::Black;
+        int sign = c == 0 ? 1 : -1;
+        for (int t = (int)PieceType::King; t <= (int)PieceType::Pawn; t++) {
+            Bitboard bb = pos.pieces(color, (PieceType)t);
+            while (bb) {
+                int sq = popLsb(bb);
+                coefficients[materialIndex(t)] += sign;
+                coefficients[pstIndex(t, c == 0 ? sq ^ 56 : sq)] += sign;
+                phaseSum += PhaseWeight[t];
+            }
+        }
+    }
+
+    std::vector<std::pair<uint16_t, int8_t>> features;
+    for (int i = 0; i < MgParameterCount; i++) {
+        if (coefficients[i] != 0) features.emplace_back(uint16_t(i), int8_t(coefficients[i]));
+    }
+    pending.push_back(std::move(features));
+    pendingResult.push_back(whiteResult);
+    pendingPhase.push_back(float(std::min(phaseSum, MaxPhase)) / MaxPhase);
+    count++;
+    if (int(pending.size()) == TuneLanes) finish();
+}
+
+void TuningSet::finish() {
+    if (pending.empty()) return;
+    if (blockSlot.empty()) blockSlot.push_back(0);
+    // Padding lanes repeat lane 0's phase with result 0.5 and no features
+    while (int(pending.size()) < TuneLanes) {
+        pending.emplace_back();
+        pendingResult.push_back(0.5f);
+        pendingPhase.push_back(pendingPhase[0]);
+    }
+    size_t slots = 0;
+    for (const auto& features : pending) slots = std::max(slots, features.size());
+    size_t first = index.size();
+    index.resize(first + slots * TuneLanes, 0);
+    coefficient.resize(first + slots * TuneLanes, 0);
+    for (int lane = 0; lane < TuneLanes; lane++) {
+        for (size_t s = 0; s < pending[lane].size(); s++) {
+            index[first + s * TuneLanes + lane] = pending[lane][s].first;
+            coefficient[first + s * TuneLanes + lane] = pending[lane][s].second;
+        }
+    }
+    blockSlot.push_back(uint32_t(blockSlot.back() + slots));
+    result.insert(result.end(), pendingResult.begin(), pendingResult.end());
+    phase.insert(phase.end(), pendingPhase.begin(), pendingPhase.end());
+    pending.clear();
+    pendingResult.clear();
+    pendingPhase.clear();
+}
+
+static float parseResult(const std::string& text, bool& found) {
+    found = true;
+    if (text.find("1/2-1/2") != std::string::npos || text.find("[0.5]") != std::string::npos) return 0.5f;
+    if (text.find("1-0") != std::string::npos || text.find("[1.0]") != std::string::npos) return 1.0f;
+    if (text.find("0-1") != std::string::npos || text.find("[0.0]") != std::string::npos) return 0.0f;
+    found = false;
+    return 0.5f;
+}
+
+bool loadTuningData(const std::string& path, TuningSet& set, int skipPlies, size_t maxPositions) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    Position pos;
+    bool pgn = path.size() >= 4 && path.compare(path.size() - 4, 4, ".pgn") == 0;
+    if (pgn) {
+        // Positions before a capture, a promotion or out of check are not
+        // quiet: their static evaluation says little about the result
+        PgnGame game;
+        while (set.count < maxPositions && readPgnGame(file, game)) {
+            bool found;
+            float whiteResult = parseResult(game.tag("Result"), found);
+            if (!found || !pos.setFromFen(game.fen)) continue;
+            for (size_t ply = 0; ply < game.moves.size() && set.count < maxPositions; ply++) {
+                PackedMove move = game.moves[ply];
+                if (int(ply) >= skipPlies && !pos.inCheck() && !isCaptureMove(move) && !isPromotionMove(move)) {
+                    set.add(pos, whiteResult);
+                }
+                pos.makeMove(move);
+            }
+        }
+    }
+    else {
+        std::string line;
+        while (set.count < maxPositions && std::getline(file, line)) {
+            std::istringstream in(line);
+            std::string fields[4];
+            if (!(in >> fields[0] >> fields[1] >> fields[2] >> fields[3])) continue;
+            bool found;
+            float whiteResult = parseResult(line.substr(line.find(fields[3]) + fields[3].size()), found);
+            if (found && pos.setFromFen(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1")) {
+                set.add(pos, whiteResult);
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<double> currentEvalParameters() {
+    std::vector<double> parameters(ParameterCount);
+    for (int t = 0; t < 7; t++) {
+        parameters[materialIndex(t)] = PieceValueMg[t];
+        parameters[MgParameterCount + materialIndex(t)] = PieceValueEg[t];
+        for (int sq = 0; sq < 64; sq++) {
+            parameters[pstIndex(t, sq)] = PstMg[t][sq];
+            parameters[MgParameterCount + pstIndex(t, sq)] = PstEg[t][sq];
+        }
+    }
+    return parameters;
+}
+
+static void writeTable(std::ostream& out, const char* name, const std::vector<double>& parameters, int offset) {
+    static const char* names[7] = { "None", "King", "Queen", "Rook", "Bishop", "Knight", "Pawn" };
+    out << "const int " << name << "[7][64] = {\n";
+    for (int t = 0; t < 7; t++) {
+        out << "    { // " << names[t] << "\n";
+        for (int row = 0; row < 8; row++) {
+            out << "       ";
+            for (int col = 0; col < 8; col++) {
+                char cell[8];
+                std::snprintf(cell, sizeof(cell), "%5d", int(std::lround(parameters[offset + pstIndex(t, row * 8 + col)])));
+                out << cell << (row == 7 && col == 7 ? "" : ",");
+            }
+            out << "\n";
+        }
+        out << (t == 6 ? "    }\n" : "    },\n");
+    }
+    out << "};\n";
+}
+
+bool writeEvalParams(const std::string& path, const std::vector<double>& parameters) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    auto values = [&](int offset) {
+        std::string text;
+        for (int t = 0; t < 7; t++) {
+            text += std::to_string(std::lround(parameters[offset + materialIndex(t)]));
+            if (t < 6) text += ", ";
+        }
+        return text;
+    };
+    out << "#pragma once\n\n"
+        << "// Evaluation parameters in centipawns, indexed by PieceType.\n"
+        << "// Piece-square tables are written from White's point of view with rank 8 in\n"
+        << "// the first row; Evaluate.cpp mirrors them for Black.\n"
+        << "// This file can be regenerated by the tuner.\n\n"
+        << "const int PieceValueMg[7] = { " << values(0) << " };\n"
+        << "const int PieceValueEg[7] = { " << values(MgParameterCount) << " };\n\n"
+        << "// Game phase weight per piece; 24 = full middlegame\n"
+        << "const int PhaseWeight[7] = { ";
+    for (int t = 0; t < 7; t++) out << PhaseWeight[t] << (t < 6 ? ", " : " };\n");
+    out << "const int MaxPhase = " << MaxPhase << ";\n\n"
+        << "// Middlegame piece-square tables\n";
+    writeTable(out, "PstMg", parameters, 0);
+    out << "\n// Endgame piece-square tables\n";
+    writeTable(out, "PstEg", parameters, MgParameterCount);
+    return bool(out);
+}
+
+Tuner::Tuner(const TuningSet& set, int threads) : set(set), threads(std::max(1, threads)) {
+}
+
+// exp, log and clamping in plain arithmetic (no library calls, no float
+// compares), so the loops using them vectorize.
+// exp: |x| <= 80, within 1e-5 relative error; log: within 2e-6 absolute.
+static inline float vectorExp(float x) {
+    float t = x * 1.44269504f;
+    int32_t whole = int32_t(t + 128.0f) - 128;     // floor, t > -128
+    float f = t - float(whole);
+    float power = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f
+                + f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+    int32_t bits = (whole + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return power * scale;
+}
+
+static inline float vectorLog(float x) {
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    float exponent = float((bits >> 23) - 127);
+    bits = (bits & 0x007FFFFF) | 0x3F800000;      // mantissa in [1, 2)
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    float s = (m - 1.0f) / (m + 1.0f), s2 = s * s;
+    float logM = 2.0f * s * (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7 + s2 * (1.0f / 9)))));
+    return exponent * 0.693147181f + logM;
+}
+
+// Clamps to [-80, 80] on the bit pattern: magnitudes order like integers
+static inline float limitMagnitude(float x) {
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = (bits & int32_t(0x80000000)) | std::min(bits & 0x7FFFFFFF, 0x42A00000);
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// The kernels: every inner loop runs over the TuneLanes positions of a block
+// on contiguous arrays, which the compiler turns into vector code. The
+// indexed parameter loads and the gradient scatter stay scalar; lanes may
+// hit the same parameter.
+void Tuner::lossRange(const float* theta, float k, size_t firstBlock, size_t lastBlock,
+                      double& lossSum, std::vector<double>* gradient) const {
+    const float* thetaEg = theta + MgParameterCount;
+    double* grad = gradient ? gradient->data() : nullptr;
+    for (size_t block = firstBlock; block < lastBlock; block++) {
+        const float* phase = &set.phase[block * TuneLanes];
+        const float* result = &set.result[block * TuneLanes];
+        size_t firstSlot = set.blockSlot[block], lastSlot = set.blockSlot[block + 1];
+
+        float mg[TuneLanes] = {}, eg[TuneLanes] = {};
+        for (size_t slot = firstSlot; slot < lastSlot; slot++) {
+            const uint16_t* index = &set.index[slot * TuneLanes];
+            const int8_t* coefficient = &set.coefficient[slot * TuneLanes];
+            for (int lane = 0; lane < TuneLanes; lane++) {
+                mg[lane] += coefficient[lane] * theta[index[lane]];
+                eg[lane] += coefficient[lane] * thetaEg[index[lane]];
+            }
+        }
+
+        // Logistic loss of p = sigmoid(z), z = k * eval, written as
+        // log(1 + e^-z) + (1 - result) * z; d loss / d eval = k * (p - result)
+        size_t valid = std::min<size_t>(TuneLanes, set.count - block * TuneLanes);
+        float losses[TuneLanes], gradMg[TuneLanes], gradEg[TuneLanes];
+        for (int lane = 0; lane < TuneLanes; lane++) {
+            float eval = mg[lane] * phase[lane] + eg[lane] * (1.0f - phase[lane]);
+            float z = limitMagnitude(k * eval);
+            float expMinusZ = vectorExp(-z);
+            float p = 1.0f / (1.0f + expMinusZ);
+            float weight = float(size_t(lane) < valid);
+            losses[lane] = weight * (vectorLog(1.0f + expMinusZ) + (1.0f - result[lane]) * z);
+            float delta = weight * k * (p - result[lane]);
+            gradMg[lane] = delta * phase[lane];
+            gradEg[lane] = delta * (1.0f - phase[lane]);
+        }
+        for (int lane = 0; lane < TuneLanes; lane++) lossSum += losses[lane];
+        if (!grad) continue;
+        for (size_t slot = firstSlot; slot < lastSlot; slot++) {
+            const uint16_t* index = &set.index[slot * TuneLanes];
+            const int8_t* coefficient = &set.coefficient[slot * TuneLanes];
+            for (int lane = 0; lane < TuneLanes; lane++) {
+                grad[index[lane]] += coefficient[lane] * gradMg[lane];
+                grad[MgParameterCount + index[lane]] += coefficient[lane] * gradEg[lane];
+            }
+        }
+    }
+}
+
+double Tuner::loss(const std::vector<double>& parameters, double k, std::vector<double>* gradient) {
+    std::vector<float> theta(parameters.begin(), parameters.end());
+    size_t blocks = set.blocks();
+    int threadCount = int(std::min<size_t>(threads, std::max<size_t>(1, blocks)));
+    std::vector<double> lossSums(threadCount, 0.0);
+    std::vector<std::vector<double>> gradients(gradient ? threadCount : 0, std::vector<double>(ParameterCount, 0.0));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) {
+        size_t first = blocks * t / threadCount, last = blocks * (t + 1) / threadCount;
+        workers.emplace_back([&, t, first, last] {
+            lossRange(theta.data(), float(k), first, last, lossSums[t], gradient ? &gradients[t] : nullptr);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    double lossSum = 0;
+    for (double sum : lossSums) lossSum += sum;
+    double scale = 1.0 / std::max<size_t>(1, set.count);
+    if (gradient) {
+        gradient->assign(ParameterCount, 0.0);
+        for (const auto& partial : gradients) {
+            for (int i = 0; i < ParameterCount; i++) (*gradient)[i] += partial[i] * scale;
+        }
+    }
+    return lossSum * scale;
+}
+
+// Golden-section search: the loss is unimodal in k for fixed parameters
+double Tuner::fitScale(const std::vector<double>& parameters) {
+    const double ratio = 0.6180339887;
+    double low = 0.0005, high = 0.02;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double lossA = loss(parameters, a, nullptr), lossB = loss(parameters, b, nullptr);
+    for (int i = 0; i < 30; i++) {
+        if (lossA < lossB) {
+            high = b;
+            b = a;
+            lossB = lossA;
+            a = high - ratio * (high - low);
+            lossA = loss(parameters, a, nullptr);
+        }
+        else {
+            low = a;
+            a = b;
+            lossA = lossB;
+            b = low + ratio * (high - low);
+            lossB = loss(parameters, b, nullptr);
+        }
+    }
+    return (low + high) / 2;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Position.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texel-style tuning of the parameters in EvalParams.h. The evaluation is
+// linear in them: every position becomes a sparse list of (parameter,
+// coefficient) features plus its game phase, and the tuner fits the
+// parameters to game results by minimising the logistic loss of
+// sigmoid(k * eval) against the result.
+
+const int TuneLanes = 8;                       // positions evaluated side by side
+const int MgParameterCount = 7 + 7 * 64;       // material then piece-square tables, by PieceType
+const int ParameterCount = 2 * MgParameterCount;   // middlegame block, then the same for the endgame
+
+// Structure-of-arrays training set. Positions are grouped in blocks of
+// TuneLanes; a block's features are stored slot-major and lane-minor (slot s
+// of all lanes, then slot s + 1), padded with zero coefficients to the
+// block's longest list, so the kernels run straight loops over whole lanes.
+struct TuningSet {
+    std::vector<float> result;                 // [position] 1 / 0.5 / 0 from White's side
+    std::vector<float> phase;                  // [position] middlegame weight 0..1
+    std::vector<uint32_t> blockSlot;           // [block] first feature slot, one extra at the end
+    std::vector<uint16_t> index;               // [slot * TuneLanes + lane] middlegame parameter
+    std::vector<int8_t> coefficient;           // [slot * TuneLanes + lane] White minus Black count
+    size_t count = 0;
+
+    size_t blocks() const { return blockSlot.empty() ? 0 : blockSlot.size() - 1; }
+    size_t bytes() const;
+    void add(const Position& pos, float whiteResult);
+    void finish();                             // pads and stores the last partial block
+
+private:
+    std::vector<std::vector<std::pair<uint16_t, int8_t>>> pending;
+    std::vector<float> pendingResult;
+    std::vector<float> pendingPhase;
+};
+
+// Fills the set from EPD / FEN lines that carry a result ("1-0", "0-1",
+// "1/2-1/2", or [1.0] / [0.5] / [0.0]), or from PGN games, keeping quiet
+// positions after skipPlies. False if the file cannot be read.
+bool loadTuningData(const std::string& path, TuningSet& set, int skipPlies, size_t maxPositions);
+
+// Starting point: the values compiled in from EvalParams.h
+std::vector<double> currentEvalParameters();
+bool writeEvalParams(const std::string& path, const std::vector<double>& parameters);
+
+class Tuner {
+public:
+    Tuner(const TuningSet& set, int threads);
+
+    // Mean loss; gradient (same length as parameters) is filled when given
+    double loss(const std::vector<double>& parameters, double k, std::vector<double>* gradient);
+    // Scale of the sigmoid that fits the current parameters best
+    double fitScale(const std::vector<double>& parameters);
+
+private:
+    void lossRange(const float* theta, float k, size_t firstBlock, size_t lastBlock,
+                   double& lossSum, std::vector<double>* gradient) const;
+
+    const TuningSet& set;
+    int threads;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+enum class PieceType {
+    None, King, Queen, Rook, Bishop, Knight, Pawn
+};
+
+enum class Color {
+    White, Black
+};
+
+enum class GameState {
+    Playing, Check, Checkmate, Stalemate,
+    ThreefoldRepetition, FivefoldRepetition,
+    FiftyMoveRule, SeventyFiveMoveRule,
+    InsufficientMaterial
+};
+
+constexpr Color operator~(Color color) {
+    return color == Color::White ? Color::Black : Color::White;
+}
+
+inline bool isDraw(GameState state) {
+    return state != GameState::Playing && state != GameState::Check && state != GameState::Checkmate;
+}
@@ -0,0 +1,96 @@
+#include "ClusterWorker.h"
+#include "Coordinator.h"
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <string>
+
+// Distributed analysis of a PGN or EPD workload
+//   analyze --input FILE [--log FILE] [--port N | --unix PATH] [--depth N] [--nodes N]
+//           [--every N] [--skip N] [--lease MS] [--attempts N] [--report MS]
+//           [--local-workers N] [--worker-threads N] [--worker-hash MB] [--crash-after N]
+//           [--worker-stats DIR]
+//   analyze --worker HOST:PORT|unix:PATH [--threads N] [--hash MB] [--slots N] [--crash-after N]
+//           [--stats-json FILE] [--prometheus FILE]
+// The first form coordinates and can start its own workers; workers on other
+// machines join with the second. Restarting the first form with the same
+// --log resumes where the previous run stopped. A worker's search statistics
+// go to its own files; --worker-stats DIR gives local worker N the files
+// DIR/workerN.json and DIR/workerN.prom.
+
+static Coordinator* activeCoordinator = nullptr;
+
+static void onSignal(int) {
+    if (activeCoordinator) activeCoordinator->requestStop();
+}
+
+static int runWorker(int argc, char* argv[]) {
+    ClusterWorkerConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--worker") config.endpoint = value;
+        else if (option == "--threads") config.threads = std::max(1, std::stoi(value));
+        else if (option == "--hash") config.hashMb = std::max(1, std::stoi(value));
+        else if (option == "--slots") config.slots = std::max(1, std::stoi(value));
+        else if (option == "--crash-after") config.crashAfter = std::stoi(value);
+        else if (option == "--stats-json") config.statsJsonPath = value;
+        else if (option == "--prometheus") config.prometheusPath = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    return runClusterWorker(config);
+}
+
+int main(int argc, char* argv[]) {
+    std::signal(SIGPIPE, SIG_IGN);
+    if (argc > 1 && std::string(argv[1]) == "--worker") return runWorker(argc, argv);
+
+    CoordinatorConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--input") config.inputPath = value;
+        else if (option == "--log") config.logPath = value;
+        else if (option == "--port") config.port = std::stoi(value);
+        else if (option == "--unix") config.unixPath = value;
+        else if (option == "--depth") config.depth = std::stoi(value);
+        else if (option == "--nodes") config.nodes = std::stoull(value);
+        else if (option == "--every") config.everyPly = std::max(1, std::stoi(value));
+        else if (option == "--skip") config.skipPlies = std::stoi(value);
+        else if (option == "--lease") config.leaseMs = std::stoi(value);
+        else if (option == "--attempts") config.maxAttempts = std::max(1, std::stoi(value));
+        else if (option == "--report") config.reportMs = std::stoi(value);
+        else if (option == "--local-workers") config.localWorkers = std::stoi(value);
+        else if (option == "--worker-threads") config.workerThreads = std::max(1, std::stoi(value));
+        else if (option == "--worker-hash") config.workerHashMb = std::max(1, std::stoi(value));
+        else if (option == "--crash-after") config.crashAfter = std::stoi(value);
+        else if (option == "--worker-stats") config.workerStatsDir = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (config.inputPath.empty()) {
+        std::cerr << "Usage: analyze --input FILE [options] | analyze --worker ENDPOINT [options]" << std::endl;
+        return 1;
+    }
+    // Depth 0 means no depth limit on the workers: without --nodes nothing would end the search
+    config.depth = std::max(config.nodes ? 0 : 1, std::min(config.depth, 255));
+
+    Coordinator coordinator(config);
+    if (!coordinator.load() || !coordinator.start()) return 1;
+
+    activeCoordinator = &coordinator;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::cout << "Coordinator listening on "
+              << (config.unixPath.empty() ? "port " + std::to_string(config.port) : config.unixPath)
+              << " with " << config.localWorkers << " local workers" << std::endl;
+    bool complete = coordinator.run();
+    coordinator.printSummary();
+    return complete ? 0 : 1;
+}
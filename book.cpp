@@ -0,0 +1,102 @@
+#include "BookBuilder.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Opening book builder and browser
+//   book --pgn FILE [--pgn FILE ...] [--out FILE] [--stats FILE] [--random FILE]
+//        [--threads N] [--max-ply N] [--memory MB] [--min-games N]
+//   book --query STATS [--fen FEN] [--random FILE]
+// Books are keyed with Polyglot's built-in Random64 table; --random names a text
+// file with 781 0x numbers to use instead (see Polyglot.h). --threads defaults
+// to the hardware threads.
+
+static int query(const std::string& path, const std::string& fen, const std::string& randomPath) {
+    Position pos;
+    if (!pos.setFromFen(fen)) {
+        std::cerr << "Bad FEN: " << fen << std::endl;
+        return 1;
+    }
+    BookHasher hasher;
+    if (!randomPath.empty() && !hasher.loadRandom(randomPath)) return 1;
+
+    bool polyglotKeys = false;
+    std::vector<BookStatsRecord> records;
+    if (!readBookStats(path, 0, records, &polyglotKeys)) {
+        std::cerr << "Cannot read " << path << std::endl;
+        return 1;
+    }
+    if (!polyglotKeys) {
+        std::cerr << path << " uses engine keys: build it again" << std::endl;
+        return 1;
+    }
+    readBookStats(path, hasher.key(pos), records);
+    std::sort(records.begin(), records.end(), [](const BookStatsRecord& a, const BookStatsRecord& b) {
+        return a.games() > b.games();
+    });
+
+    uint64_t total = 0;
+    for (const BookStatsRecord& record : records) total += record.games();
+    std::cout << pos.toFen() << ": " << total << " games" << std::endl;
+    if (records.empty()) return 0;
+    std::cout << "  move      games   share    win   draw   loss  score" << std::endl;
+    for (const BookStatsRecord& record : records) {
+        PackedMove move = fromPolyglotMove(pos, record.move);
+        double games = double(record.games());
+        std::cout << "  " << std::left << std::setw(7)
+                  << (move != NullMove ? pos.moveToSan(move) : polyglotMoveToUci(record.move)) << std::right
+                  << std::setw(8) << record.games()
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(7) << 100.0 * games / total << "%"
+                  << std::setw(6) << 100.0 * record.wins / games << "%"
+                  << std::setw(6) << 100.0 * record.draws / games << "%"
+                  << std::setw(6) << 100.0 * record.losses / games << "%"
+                  << std::setw(6) << 100.0 * (record.wins + 0.5 * record.draws) / games << "%" << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    BookBuildConfig config;
+    std::string queryPath;
+    std::string fen = Position::StartFen;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--pgn") config.pgnPaths.push_back(value);
+        else if (option == "--out") config.bookPath = value;
+        else if (option == "--stats") config.statsPath = value;
+        else if (option == "--random") config.randomPath = value;
+        else if (option == "--threads") config.threads = std::max(1, std::stoi(value));
+        else if (option == "--max-ply") config.maxPly = std::max(1, std::stoi(value));
+        else if (option == "--memory") config.memoryMb = std::max(1, std::stoi(value));
+        else if (option == "--min-games") config.minGames = std::max(1, std::stoi(value));
+        else if (option == "--query") queryPath = value;
+        else if (option == "--fen") fen = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (!queryPath.empty()) return query(queryPath, fen, config.randomPath);
+    if (config.pgnPaths.empty()) {
+        std::cerr << "Usage: book --pgn FILE [options] | book --query STATS [--fen FEN]" << std::endl;
+        return 1;
+    }
+
+    BookBuilder builder(config);
+    if (!builder.build()) return 1;
+    const BookBuildStats& stats = builder.statistics();
+    double seconds = std::max<int64_t>(1, stats.replayMs + stats.mergeMs) / 1000.0;
+    std::cout << "Games " << stats.games << " (" << stats.skippedGames << " skipped), "
+              << stats.positions << " moves up to ply " << config.maxPly << ", "
+              << stats.entries << " distinct position/move pairs" << std::endl;
+    std::cout << "Replay " << stats.replayMs << " ms on " << config.threads << " threads, "
+              << "merge " << stats.mergeMs << " ms of " << stats.runs << " spilled runs + " << config.threads << " in memory" << std::endl;
+    std::cout << "Book " << stats.bookEntries << " entries in " << stats.bookPositions << " positions, "
+              << "Polyglot keys" << (config.randomPath.empty() ? "" : " from " + config.randomPath) << std::endl;
+    std::cout << "Built in " << std::fixed << std::setprecision(2) << seconds << " s: "
+              << std::setprecision(0) << stats.games / seconds << " games/s" << std::endl;
+    return 0;
+}
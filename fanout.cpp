@@ -0,0 +1,371 @@
+#include "GameServer.h"
+#include "Position.h"
+#include "Protocol.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Spectator fan-out benchmark: starts a game server in a child process, has
+// two players play one game on it in front of N spectators over loopback and
+// measures the delay from a move being sent to each spectator seeing it, and
+// the server's resident memory per spectator. Slow spectators never read
+// until the game is over, to show their backlog being replaced by snapshots;
+// their receive buffers and the server's spectator send buffers are the
+// kernel minimum (--send-buffer, 0 for the kernel default) so that the backlog
+// builds up in the server, not in the kernel, and the backlog limit defaults
+// to 8 frames. The run fails if a slow spectator never got a catch-up snapshot.
+//   fanout [--spectators N] [--moves N] [--interval-ms MS] [--slow N]
+//          [--backlog FRAMES] [--send-buffer BYTES] [--workers N] [--port P | --unix PATH]
+
+using Clock = std::chrono::steady_clock;
+
+static const uint32_t GameId = 1;
+
+struct FanoutConfig {
+    int spectators = 1000;
+    int moves = 300;
+    int intervalMs = 10;
+    int slow = 0;
+    ServerConfig server;
+};
+
+struct Spectator {
+    int fd = -1;
+    bool slow = false;
+    std::vector<uint8_t> in;
+    int moves = 0;                 // MoveMade frames seen
+    int snapshots = 0;
+    int ply = 0;                   // last ply known, from MoveMade or Snapshot
+    bool over = false;
+};
+
+static int connectTo(const ServerConfig& config, int receiveBuffer) {
+    int fd;
+    int result;
+    if (!config.unixPath.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (receiveBuffer) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, config.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        result = connect(fd, (sockaddr*)&addr, sizeof(addr));
+    }
+    else {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (receiveBuffer) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(config.port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = connect(fd, (sockaddr*)&addr, sizeof(addr));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    if (result == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sendFrame(int fd, const Frame& frame) {
+    return ::send(fd, frame.data, frame.size, MSG_NOSIGNAL) == (ssize_t)frame.size;
+}
+
+// Blocking read of the next frame of the given type, skipping the others
+static bool readFrame(int fd, std::vector<uint8_t>& in, MessageType type, std::vector<uint8_t>& frame) {
+    uint8_t buffer[4096];
+    while (true) {
+        size_t offset = 0;
+        while (size_t size = completeFrameSize(in.data() + offset, in.size() - offset)) {
+            bool match = MessageType(in[offset]) == type;
+            if (match) frame.assign(in.begin() + offset, in.begin() + offset + size);
+            offset += size;
+            if (match) {
+                in.erase(in.begin(), in.begin() + offset);
+                return true;
+            }
+        }
+        in.erase(in.begin(), in.begin() + offset);
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        in.insert(in.end(), buffer, buffer + received);
+    }
+}
+
+// Reads what a spectator has received; returns the number of MoveMade frames
+static int drainSpectator(Spectator& spectator, Clock::time_point sentAt, std::vector<uint32_t>& latencyUs) {
+    uint8_t buffer[16384];
+    int moves = 0;
+    while (true) {
+        ssize_t received = recv(spectator.fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        spectator.in.insert(spectator.in.end(), buffer, buffer + received);
+    }
+    auto now = Clock::now();
+    size_t offset = 0;
+    while (size_t size = completeFrameSize(spectator.in.data() + offset, spectator.in.size() - offset)) {
+        const uint8_t* payload = spectator.in.data() + offset + FrameHeaderSize;
+        switch (MessageType(spectator.in[offset])) {
+        case MessageType::MoveMade:
+            spectator.moves++;
+            spectator.ply++;
+            moves++;
+            latencyUs.push_back(uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(now - sentAt).count()));
+            break;
+        case MessageType::Snapshot:
+            spectator.snapshots++;
+            spectator.ply = getU16(payload + 4);
+            break;
+        case MessageType::GameOver:
+            spectator.over = true;
+            break;
+        default:
+            break;
+        }
+        offset += size;
+    }
+    spectator.in.erase(spectator.in.begin(), spectator.in.begin() + offset);
+    return moves;
+}
+
+static size_t residentBytes(pid_t pid) {
+    std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+// A random legal move that keeps the game going
+static PackedMove pickMove(Position& position, std::mt19937& rng) {
+    MoveList moves;
+    position.generateLegal(moves);
+    int start = moves.empty() ? 0 : int(rng() % moves.size());
+    for (int i = 0; i < moves.size(); i++) {
+        PackedMove move = moves[(start + i) % moves.size()];
+        position.makeMove(move);
+        MoveList replies;
+        position.generateLegal(replies);
+        bool playing = !replies.empty() && position.drawState() == GameState::Playing;
+        position.unmakeMove(move);
+        if (playing) return move;
+    }
+    return NullMove;
+}
+
+int main(int argc, char* argv[]) {
+    FanoutConfig config;
+    config.server.port = 5556;
+    config.server.workers = 1;
+    config.server.spectatorSendBuffer = 1;      // raised to the kernel minimum
+    config.server.spectatorBacklog = 8;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--spectators") config.spectators = std::stoi(value);
+        else if (option == "--moves") config.moves = std::stoi(value);
+        else if (option == "--interval-ms") config.intervalMs = std::stoi(value);
+        else if (option == "--slow") config.slow = std::stoi(value);
+        else if (option == "--backlog") config.server.spectatorBacklog = std::stoul(value);
+        else if (option == "--send-buffer") config.server.spectatorSendBuffer = std::stoi(value);
+        else if (option == "--workers") config.server.workers = std::stoi(value);
+        else if (option == "--port") config.server.port = std::stoi(value);
+        else if (option == "--unix") config.server.unixPath = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    config.spectators = std::max(0, config.spectators);
+    config.slow = std::min(std::max(0, config.slow), config.spectators);
+    config.server.workers = std::max(1, config.server.workers);
+
+    rlimit files;
+    getrlimit(RLIMIT_NOFILE, &files);
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+
+    pid_t child = fork();
+    if (child == 0) {
+        GameServer server(config.server);
+        if (!server.start()) _exit(1);
+        server.run();
+        _exit(0);
+    }
+
+    // Players: white creates the game, the spectators join it, black starts it
+    int white = -1;
+    for (int attempt = 0; attempt < 200 && white == -1; attempt++) {
+        white = connectTo(config.server, 0);
+        if (white == -1) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (white == -1) {
+        std::cerr << "Cannot reach the server: " << strerror(errno) << std::endl;
+        kill(child, SIGKILL);
+        return 1;
+    }
+    std::vector<uint8_t> whiteIn, blackIn, frame;
+    sendFrame(white, Frame(MessageType::Join).u32(GameId));
+    readFrame(white, whiteIn, MessageType::Joined, frame);
+
+    size_t residentBefore = residentBytes(child);
+    int epollFd = epoll_create1(0);
+    std::vector<Spectator> spectators(config.spectators);
+    std::vector<uint32_t> latencyUs;
+    for (int i = 0; i < config.spectators; i++) {
+        Spectator& spectator = spectators[i];
+        spectator.slow = i < config.slow;
+        // The kernel raises 1 to its minimum receive buffer
+        spectator.fd = connectTo(config.server, spectator.slow ? 1 : 0);
+        if (spectator.fd == -1) {
+            std::cerr << "Spectator " << i << " failed: " << strerror(errno) << std::endl;
+            kill(child, SIGKILL);
+            return 1;
+        }
+        sendFrame(spectator.fd, Frame(MessageType::Spectate).u32(GameId));
+        std::vector<uint8_t> snapshot;
+        if (!readFrame(spectator.fd, spectator.in, MessageType::Snapshot, snapshot)) {
+            std::cerr << "Spectator " << i << " got no snapshot" << std::endl;
+            kill(child, SIGKILL);
+            return 1;
+        }
+        spectator.snapshots++;
+        fcntl(spectator.fd, F_SETFL, fcntl(spectator.fd, F_GETFL) | O_NONBLOCK);
+        if (!spectator.slow) {
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.ptr = &spectator;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, spectator.fd, &ev);
+        }
+    }
+    size_t residentAfter = residentBytes(child);
+
+    int black = connectTo(config.server, 0);
+    sendFrame(black, Frame(MessageType::Join).u32(GameId));
+    readFrame(white, whiteIn, MessageType::Start, frame);
+    readFrame(black, blackIn, MessageType::Start, frame);
+
+    int fast = config.spectators - config.slow;
+    std::vector<uint32_t> fanoutUs;
+    std::mt19937 rng(1234);
+    Position position;
+    position.setStartPosition();
+    epoll_event events[256];
+    int played = 0;
+    int64_t errors = 0;
+    auto start = Clock::now();
+    for (; played < config.moves; played++) {
+        PackedMove move = pickMove(position, rng);
+        if (move == NullMove) break;
+        int player = position.sideToMove() == Color::White ? white : black;
+        auto sentAt = Clock::now();
+        if (!sendFrame(player, Frame(MessageType::Move).u16(move))) errors++;
+
+        int waiting = fast;
+        while (waiting > 0) {
+            int count = epoll_wait(epollFd, events, 256, 2000);
+            if (count <= 0) {
+                std::cerr << "Timed out waiting for " << waiting << " spectators" << std::endl;
+                errors++;
+                break;
+            }
+            for (int i = 0; i < count; i++) {
+                Spectator& spectator = *static_cast<Spectator*>(events[i].data.ptr);
+                waiting -= drainSpectator(spectator, sentAt, latencyUs);
+            }
+        }
+        fanoutUs.push_back(uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sentAt).count()));
+
+        if (!readFrame(white, whiteIn, MessageType::MoveMade, frame) ||
+            !readFrame(black, blackIn, MessageType::MoveMade, frame)) {
+            errors++;
+            break;
+        }
+        position.makeMove(move);
+        if (config.intervalMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(config.intervalMs));
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // End the game; every spectator, slow or not, should end on GameOver at the final ply
+    sendFrame(position.sideToMove() == Color::White ? white : black, Frame(MessageType::Resign));
+    std::vector<uint32_t> ignored;
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    int finished = 0;
+    while (finished < config.spectators && Clock::now() < deadline) {
+        finished = 0;
+        for (Spectator& spectator : spectators) {
+            if (!spectator.over) drainSpectator(spectator, start, ignored);
+            if (spectator.over) finished++;
+        }
+        if (finished < config.spectators) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int behind = 0;
+    int64_t slowMoves = 0, slowSnapshots = 0;
+    int notReplaced = 0;           // slow spectators that only got the snapshot sent on joining
+    for (Spectator& spectator : spectators) {
+        if (!spectator.over || spectator.ply != played) behind++;
+        if (spectator.slow) {
+            slowMoves += spectator.moves;
+            slowSnapshots += spectator.snapshots;
+            if (spectator.snapshots < 2) notReplaced++;
+        }
+    }
+
+    std::sort(latencyUs.begin(), latencyUs.end());
+    std::sort(fanoutUs.begin(), fanoutUs.end());
+    std::cout << std::fixed << std::setprecision(0)
+              << "Spectators:      " << config.spectators << " (" << config.slow << " slow), "
+              << config.server.workers << " server workers\n"
+              << "Moves:           " << played << " in " << std::setprecision(2) << elapsed << " s\n"
+              << std::setprecision(0)
+              << "Server memory:   " << (config.spectators ? double(residentAfter - residentBefore) / config.spectators : 0)
+              << " bytes/spectator resident\n"
+              << "Delivery p50:    " << percentile(latencyUs, 0.50) << " us\n"
+              << "Delivery p99:    " << percentile(latencyUs, 0.99) << " us\n"
+              << "Delivery max:    " << (latencyUs.empty() ? 0 : latencyUs.back()) << " us\n"
+              << "Fan-out p50:     " << percentile(fanoutUs, 0.50) << " us to the last spectator\n"
+              << "Fan-out max:     " << (fanoutUs.empty() ? 0 : fanoutUs.back()) << " us\n";
+    if (config.slow) {
+        std::cout << std::setprecision(1)
+                  << "Slow spectators: " << double(slowMoves) / config.slow << " moves and "
+                  << double(slowSnapshots) / config.slow << " snapshots each for " << played << " moves\n"
+                  << "Not replaced:    " << notReplaced << " slow spectators without a catch-up snapshot\n";
+    }
+    std::cout << "Out of sync:     " << behind << "\n"
+              << "Errors:          " << errors << std::endl;
+
+    for (Spectator& spectator : spectators) close(spectator.fd);
+    close(white);
+    close(black);
+    close(epollFd);
+    kill(child, SIGTERM);
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    return errors || behind || notReplaced ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+#include "Position.h"
+#include "Protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load generator for the game server: N simulated clients over loopback play
+// random legal moves in pairs and measure move round-trip latency
+//   loadgen [--clients N] [--seconds S] [--threads T] [--port P | --unix PATH]
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadConfig {
+    int clients = 1000;
+    int seconds = 10;
+    int threads = 2;
+    int port = 5555;
+    std::string unixPath;
+    int maxPlies = 300;            // resign after this many plies to keep games turning over
+};
+
+struct SimClient {
+    int fd = -1;
+    int pairIndex = 0;
+    uint32_t gameId = 0;
+    int color = -1;
+    Position position;
+    std::vector<uint8_t> in;
+    Clock::time_point sentAt;
+    bool awaitingEcho = false;
+};
+
+struct DriverStats {
+    uint64_t moves = 0;
+    uint64_t games = 0;
+    uint64_t errors = 0;
+    std::vector<uint32_t> latencyUs;
+};
+
+static int connectClient(const LoadConfig& config) {
+    int fd;
+    if (!config.unixPath.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, config.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            close(fd);
+            return -1;
+        }
+    }
+    else {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(config.port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static void sendFrame(SimClient& client, const Frame& frame, DriverStats& stats) {
+    if (::send(client.fd, frame.data, frame.size, MSG_NOSIGNAL) != (ssize_t)frame.size) {
+        stats.errors++;
+    }
+}
+
+static void playRandomMove(SimClient& client, std::mt19937& rng, const LoadConfig& config, DriverStats& stats) {
+    if (client.position.gamePly() >= config.maxPlies) {
+        sendFrame(client, Frame(MessageType::Resign), stats);
+        return;
+    }
+    MoveList moves;
+    client.position.generateLegal(moves);
+    if (moves.empty()) return;
+    PackedMove move = moves[int(rng() % moves.size())];
+    client.sentAt = Clock::now();
+    client.awaitingEcho = true;
+    sendFrame(client, Frame(MessageType::Move).u16(move), stats);
+}
+
+static bool ourTurn(const SimClient& client) {
+    return (client.position.sideToMove() == Color::White ? 0 : 1) == client.color;
+}
+
+static void handleFrame(SimClient& client, const uint8_t* frame, int pairs, std::mt19937& rng,
+                        const LoadConfig& config, DriverStats& stats) {
+    const uint8_t* payload = frame + FrameHeaderSize;
+    switch (MessageType(frame[0])) {
+    case MessageType::Joined:
+        client.color = payload[4];
+        client.position.setStartPosition();
+        break;
+    case MessageType::Start:
+        if (ourTurn(client)) playRandomMove(client, rng, config, stats);
+        break;
+    case MessageType::MoveMade: {
+        PackedMove move = getU16(payload);
+        if (client.awaitingEcho && ourTurn(client)) {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - client.sentAt).count();
+            stats.latencyUs.push_back(uint32_t(latency));
+            stats.moves++;
+            client.awaitingEcho = false;
+        }
+        client.position.makeMove(move);
+        if (ourTurn(client)) {
+            MoveList moves;
+            client.position.generateLegal(moves);
+            if (!moves.empty() && client.position.drawState() == GameState::Playing) {
+                playRandomMove(client, rng, config, stats);
+            }
+        }
+        break;
+    }
+    case MessageType::GameOver:
+        if (client.color == 0) stats.games++;
+        client.awaitingEcho = false;
+        client.gameId += pairs;
+        sendFrame(client, Frame(MessageType::Join).u32(client.gameId), stats);
+        break;
+    case MessageType::Error:
+        stats.errors++;
+        break;
+    default:
+        break;
+    }
+}
+
+static void runDriver(std::vector<std::unique_ptr<SimClient>>& clients, int pairs, const LoadConfig& config,
+                      std::atomic<bool>& running, DriverStats& stats, unsigned seed) {
+    std::mt19937 rng(seed);
+    int epollFd = epoll_create1(0);
+    for (auto& client : clients) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = client.get();
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, client->fd, &ev);
+        sendFrame(*client, Frame(MessageType::Join).u32(client->gameId), stats);
+    }
+
+    epoll_event events[256];
+    uint8_t buffer[16384];
+    while (running) {
+        int count = epoll_wait(epollFd, events, 256, 50);
+        for (int i = 0; i < count; i++) {
+            SimClient& client = *static_cast<SimClient*>(events[i].data.ptr);
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                if (received == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+                    stats.errors++;
+                }
+                continue;
+            }
+            client.in.insert(client.in.end(), buffer, buffer + received);
+            size_t offset = 0;
+            while (size_t size = completeFrameSize(client.in.data() + offset, client.in.size() - offset)) {
+                handleFrame(client, client.in.data() + offset, pairs, rng, config, stats);
+                offset += size;
+            }
+            client.in.erase(client.in.begin(), client.in.begin() + offset);
+        }
+    }
+    close(epollFd);
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--clients") config.clients = std::stoi(value);
+        else if (option == "--seconds") config.seconds = std::stoi(value);
+        else if (option == "--threads") config.threads = std::stoi(value);
+        else if (option == "--port") config.port = std::stoi(value);
+        else if (option == "--unix") config.unixPath = value;
+        else if (option == "--max-plies") config.maxPlies = std::stoi(value);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    config.clients = std::max(2, config.clients & ~1);
+    config.threads = std::max(1, config.threads);
+    int pairs = config.clients / 2;
+
+    // Both players of a pair live on the same driver thread
+    std::vector<std::vector<std::unique_ptr<SimClient>>> groups(config.threads);
+    for (int i = 0; i < config.clients; i++) {
+        auto client = std::make_unique<SimClient>();
+        client->pairIndex = i / 2;
+        client->gameId = uint32_t(client->pairIndex);
+        client->fd = connectClient(config);
+        if (client->fd == -1) {
+            std::cerr << "Connection " << i << " failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        groups[client->pairIndex % config.threads].push_back(std::move(client));
+    }
+    std::cout << "Connected " << config.clients << " clients (" << pairs << " concurrent games)" << std::endl;
+
+    std::atomic<bool> running{ true };
+    std::vector<DriverStats> stats(config.threads);
+    std::vector<std::thread> drivers;
+    auto start = Clock::now();
+    for (int t = 0; t < config.threads; t++) {
+        drivers.emplace_back(runDriver, std::ref(groups[t]), pairs, std::cref(config),
+                             std::ref(running), std::ref(stats[t]), 1234u + t);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    running = false;
+    for (auto& driver : drivers) driver.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    DriverStats total;
+    for (auto& s : stats) {
+        total.moves += s.moves;
+        total.games += s.games;
+        total.errors += s.errors;
+        total.latencyUs.insert(total.latencyUs.end(), s.latencyUs.begin(), s.latencyUs.end());
+    }
+    std::sort(total.latencyUs.begin(), total.latencyUs.end());
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "Moves:        " << total.moves << " in " << std::setprecision(2) << elapsed << " s\n"
+              << std::setprecision(0)
+              << "Moves/sec:    " << total.moves / elapsed << "\n"
+              << "Games done:   " << total.games << "\n"
+              << "Latency p50:  " << percentile(total.latencyUs, 0.50) << " us\n"
+              << "Latency p99:  " << percentile(total.latencyUs, 0.99) << " us\n"
+              << "Latency max:  " << (total.latencyUs.empty() ? 0 : total.latencyUs.back()) << " us\n"
+              << "Errors:       " << total.errors << std::endl;
+
+    for (auto& group : groups) {
+        for (auto& client : group) close(client->fd);
+    }
+    return total.errors ? 1 : 0;
+}
@@ -1,7 +1,62 @@
 #include "ChessGame.h"
+#include <iostream>
+#include <string>
 
-int main() {
+// A whole decimal number in [min, max]; false for anything else
+static bool parseNumber(const std::string& value, unsigned long min, unsigned long max, unsigned long& number) {
+    try {
+        size_t used = 0;
+        number = std::stoul(value, &used);
+        return used == value.size() && value[0] != '-' && number >= min && number <= max;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
     ChessGame game;
+
+    // Optional online settings: --server host:port --game id
+    // and a PGN archive to review: --pgn file
+    // and endgame tables made by tbgen: --tablebases dir
+    std::string host = "127.0.0.1";
+    unsigned short port = 5555;
+    uint32_t gameId = 1;
+    std::string archivePath;
+    std::string tablebasePath;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--server") {
+            size_t colon = value.find(':');
+            host = value.substr(0, colon);
+            unsigned long number = 0;
+            if (colon != std::string::npos) {
+                if (parseNumber(value.substr(colon + 1), 1, 65535, number)) port = (unsigned short)number;
+                else std::cerr << "Invalid port in " << value << ", using " << port << std::endl;
+            }
+        }
+        else if (option == "--game") {
+            unsigned long number = 0;
+            if (parseNumber(value, 0, 0xFFFFFFFFul, number)) gameId = (uint32_t)number;
+            else std::cerr << "Invalid game id " << value << ", using " << gameId << std::endl;
+        }
+        else if (option == "--pgn") {
+            archivePath = value;
+        }
+        else if (option == "--tablebases") {
+            tablebasePath = value;
+        }
+    }
+    game.setServer(host, port, gameId);
+    if (!tablebasePath.empty()) {
+        game.setTablebasePath(tablebasePath);
+    }
+    if (!archivePath.empty()) {
+        game.loadArchive(archivePath);
+    }
+
     game.run();
     return 0;
-}
\ No newline at end of file
+}
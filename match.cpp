@@ -0,0 +1,620 @@
+#include "Pgn.h"
+#include "Search.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Engine-vs-engine match runner for regression testing: games run concurrently
+// (one per core by default), each engine either in-process or a UCI subprocess
+//   match --engine1 internal|PATH --engine2 internal|PATH [--games N] [--concurrency C]
+//         [--nodes N | --tc BASE+INC] [--openings FILE.epd|FILE.pgn] [--opening-plies N]
+//         [--pgn FILE] [--hash MB] [--max-plies N] [--sprt ELO0,ELO1] [--alpha A] [--beta B]
+//         [--stats-json FILE] [--prometheus FILE]
+// The statistics files cover the searches of the internal engines; the
+// Prometheus file is rewritten after every game.
+
+using Clock = std::chrono::steady_clock;
+
+struct MatchConfig {
+    std::string engines[2] = { "internal", "internal" };
+    int games = 100;
+    int concurrency = 0;               // 0 = one game per core
+    uint64_t nodes = 0;
+    int64_t baseMs = 10000;
+    int64_t incrementMs = 100;
+    std::string openings;
+    int openingPlies = 16;
+    std::string pgnPath;
+    int hashMb = 16;
+    int maxPlies = 400;                // adjudicated as a draw
+    bool sprt = false;
+    double elo0 = 0, elo1 = 5;
+    double alpha = 0.05, beta = 0.05;
+    std::string statsJsonPath;
+    std::string prometheusPath;
+};
+
+// One player of a game; reused across games by the thread that owns it
+class MatchEngine {
+public:
+    virtual ~MatchEngine() {}
+    virtual bool start() = 0;
+    virtual void newGame() = 0;
+    // NullMove when the engine failed to answer with a legal move in time
+    virtual PackedMove go(const std::string& fen, const std::vector<PackedMove>& moves,
+                          const Position& current, const SearchLimits& limits) = 0;
+    // Adds the search statistics gathered since the last call
+    virtual void takeStats(SearchStats&) {}
+    std::string name;
+};
+
+class InternalEngine : public MatchEngine {
+public:
+    InternalEngine(int hashMb, bool collectStats) : hashMb(hashMb) {
+        name = "internal";
+        search.setCollectStats(collectStats);
+    }
+
+    bool start() override {
+        search.setHashSize(hashMb);
+        search.onBestMove = [this](PackedMove best, PackedMove) { bestMove = best; };
+        return true;
+    }
+
+    void newGame() override {
+        search.clear();
+    }
+
+    PackedMove go(const std::string&, const std::vector<PackedMove>&,
+                  const Position& current, const SearchLimits& limits) override {
+        bestMove = NullMove;
+        search.start(current, limits);
+        search.wait();
+        if (search.collectingStats()) stats.add(search.statistics());
+        return bestMove;
+    }
+
+    void takeStats(SearchStats& into) override {
+        into.add(stats);
+        stats = SearchStats();
+    }
+
+private:
+    Search search;
+    SearchStats stats;
+    int hashMb;
+    PackedMove bestMove = NullMove;
+};
+
+class UciEngine : public MatchEngine {
+public:
+    UciEngine(const std::string& path, int hashMb) : path(path), hashMb(hashMb) {
+        name = path;
+    }
+
+    ~UciEngine() override {
+        if (pid > 0) {
+            send("quit");
+            close(toEngine);
+            close(fromEngine);
+            // Give it a moment to exit cleanly before killing it
+            for (int i = 0; i < 50 && waitpid(pid, nullptr, WNOHANG) == 0; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            if (waitpid(pid, nullptr, WNOHANG) == 0) {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+            }
+        }
+    }
+
+    bool start() override {
+        int input[2], output[2];
+        if (pipe(input) == -1 || pipe(output) == -1) return false;
+        pid = fork();
+        if (pid == -1) return false;
+        if (pid == 0) {
+            dup2(input[0], STDIN_FILENO);
+            dup2(output[1], STDOUT_FILENO);
+            close(input[0]);
+            close(input[1]);
+            close(output[0]);
+            close(output[1]);
+            execl(path.c_str(), path.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        close(input[0]);
+        close(output[1]);
+        toEngine = input[1];
+        fromEngine = output[0];
+        fcntl(toEngine, F_SETFD, FD_CLOEXEC);
+        fcntl(fromEngine, F_SETFD, FD_CLOEXEC);
+
+        send("uci");
+        std::string line;
+        while (readLine(line, 5000)) {
+            if (line.compare(0, 8, "id name ") == 0) name = line.substr(8);
+            if (line == "uciok") {
+                send("setoption name Hash value " + std::to_string(hashMb));
+                send("setoption name Threads value 1");
+                return isReady();
+            }
+        }
+        std::cerr << "Engine " << path << " did not answer uci" << std::endl;
+        return false;
+    }
+
+    void newGame() override {
+        send("ucinewgame");
+        isReady();
+    }
+
+    PackedMove go(const std::string& fen, const std::vector<PackedMove>& moves,
+                  const Position& current, const SearchLimits& limits) override {
+        std::string command = "position fen " + fen;
+        if (!moves.empty()) {
+            command += " moves";
+            for (PackedMove move : moves) command += " " + Position::moveToUci(move);
+        }
+        send(command);
+
+        std::ostringstream go;
+        go << "go";
+        if (limits.nodes) go << " nodes " << limits.nodes;
+        if (limits.time[0] >= 0) {
+            go << " wtime " << limits.time[0] << " btime " << limits.time[1]
+               << " winc " << limits.increment[0] << " binc " << limits.increment[1];
+        }
+        send(go.str());
+
+        // The caller flags overstepping the clock; this only guards against hangs
+        int side = current.sideToMove() == Color::White ? 0 : 1;
+        int timeoutMs = limits.time[side] >= 0 ? int(limits.time[side]) + 5000 : 60000;
+        std::string line;
+        while (readLine(line, timeoutMs)) {
+            if (line.compare(0, 9, "bestmove ") == 0) {
+                std::istringstream in(line.substr(9));
+                std::string text;
+                in >> text;
+                return current.parseUciMove(text);
+            }
+        }
+        return NullMove;
+    }
+
+private:
+    void send(const std::string& line) {
+        std::string data = line + "\n";
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = write(toEngine, data.data() + written, data.size() - written);
+            if (n <= 0) return;
+            written += size_t(n);
+        }
+    }
+
+    bool isReady() {
+        send("isready");
+        std::string line;
+        while (readLine(line, 10000)) {
+            if (line == "readyok") return true;
+        }
+        return false;
+    }
+
+    bool readLine(std::string& line, int timeoutMs) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true) {
+            size_t newline = buffer.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer.substr(0, newline);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                buffer.erase(0, newline + 1);
+                return true;
+            }
+            int remaining = int(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+            if (remaining <= 0) return false;
+            pollfd pfd = { fromEngine, POLLIN, 0 };
+            if (poll(&pfd, 1, remaining) <= 0) return false;
+            char chunk[4096];
+            ssize_t n = read(fromEngine, chunk, sizeof(chunk));
+            if (n <= 0) return false;
+            buffer.append(chunk, size_t(n));
+        }
+    }
+
+    std::string path;
+    int hashMb;
+    pid_t pid = -1;
+    int toEngine = -1;
+    int fromEngine = -1;
+    std::string buffer;
+};
+
+static std::unique_ptr<MatchEngine> createEngine(const std::string& spec, const MatchConfig& config) {
+    if (spec == "internal") {
+        return std::make_unique<InternalEngine>(config.hashMb, !config.statsJsonPath.empty() || !config.prometheusPath.empty());
+    }
+    return std::make_unique<UciEngine>(spec, config.hashMb);
+}
+
+struct Opening {
+    std::string fen;
+    std::vector<PackedMove> moves;
+};
+
+// EPD: one position per line (the first four fields). PGN: the first
+// openingPlies moves of every game.
+static std::vector<Opening> loadOpenings(const MatchConfig& config) {
+    std::vector<Opening> openings;
+    if (config.openings.empty()) {
+        openings.push_back({ Position::StartFen, {} });
+        return openings;
+    }
+    std::ifstream file(config.openings);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << config.openings << std::endl;
+        return openings;
+    }
+
+    bool pgn = config.openings.size() >= 4 && config.openings.compare(config.openings.size() - 4, 4, ".pgn") == 0;
+    if (pgn) {
+        PgnGame game;
+        while (readPgnGame(file, game)) {
+            if (game.moves.size() > size_t(config.openingPlies)) game.moves.resize(config.openingPlies);
+            openings.push_back({ game.fen, game.moves });
+        }
+        return openings;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string fields[4];
+        if (!(in >> fields[0] >> fields[1] >> fields[2] >> fields[3])) continue;
+        std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1";
+        Position pos;
+        if (pos.setFromFen(fen)) openings.push_back({ fen, {} });
+    }
+    return openings;
+}
+
+// Win / draw / loss counts from engine 1's point of view
+struct MatchScore {
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+
+    double variance() const {
+        double n = games(), mean = score();
+        if (n == 0) return 0;
+        return (wins * (1 - mean) * (1 - mean) + draws * (0.5 - mean) * (0.5 - mean)
+                + losses * mean * mean) / n;
+    }
+};
+
+static double eloFromScore(double score) {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+static double scoreFromElo(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// Log-likelihood ratio of elo1 against elo0, normal approximation of the trinomial model
+static double sprtLlr(const MatchScore& s, double elo0, double elo1) {
+    double variance = s.variance();
+    if (s.games() == 0 || variance <= 0) return 0;
+    double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+    return (s1 - s0) * (2 * s.score() - s0 - s1) / (2 * variance / s.games());
+}
+
+enum class GameOutcome { WhiteWins, BlackWins, Draw };
+
+struct GameRecord {
+    PgnGame pgn;
+    GameOutcome outcome = GameOutcome::Draw;
+};
+
+static GameRecord playGame(MatchEngine* white, MatchEngine* black, const Opening& opening, const MatchConfig& config) {
+    GameRecord record;
+    record.pgn.fen = opening.fen;
+    record.pgn.moves = opening.moves;
+
+    Position pos;
+    pos.setFromFen(opening.fen);
+    for (PackedMove move : opening.moves) pos.makeMove(move);
+
+    MatchEngine* players[2] = { white, black };
+    white->newGame();
+    black->newGame();
+    int64_t clockMs[2] = { config.baseMs, config.baseMs };
+    std::string termination;
+    std::string result;
+
+    while (true) {
+        MoveList legal;
+        pos.generateLegal(legal);
+        if (legal.empty()) {
+            if (pos.inCheck()) {
+                result = pos.sideToMove() == Color::White ? "0-1" : "1-0";
+                termination = "checkmate";
+            }
+            else {
+                result = "1/2-1/2";
+                termination = "stalemate";
+            }
+            break;
+        }
+        GameState draw = pos.drawState();
+        if (isDraw(draw)) {
+            result = "1/2-1/2";
+            termination = draw == GameState::InsufficientMaterial ? "insufficient material"
+                        : draw == GameState::FiftyMoveRule || draw == GameState::SeventyFiveMoveRule ? "fifty-move rule"
+                        : "repetition";
+            break;
+        }
+        if (int(record.pgn.moves.size()) >= config.maxPlies) {
+            result = "1/2-1/2";
+            termination = "adjudication: move limit";
+            break;
+        }
+
+        int side = pos.sideToMove() == Color::White ? 0 : 1;
+        SearchLimits limits;
+        if (config.nodes) {
+            limits.nodes = config.nodes;
+        }
+        else {
+            limits.time[0] = clockMs[0];
+            limits.time[1] = clockMs[1];
+            limits.increment[0] = limits.increment[1] = config.incrementMs;
+        }
+
+        auto started = Clock::now();
+        PackedMove move = players[side]->go(opening.fen, record.pgn.moves, pos, limits);
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started).count();
+
+        if (move == NullMove) {
+            result = side == 0 ? "0-1" : "1-0";
+            termination = "illegal move or engine failure";
+            break;
+        }
+        if (!config.nodes) {
+            if (elapsed > clockMs[side]) {
+                result = side == 0 ? "0-1" : "1-0";
+                termination = "time forfeit";
+                break;
+            }
+            clockMs[side] += config.incrementMs - elapsed;
+        }
+        pos.makeMove(move);
+        record.pgn.moves.push_back(move);
+    }
+
+    record.pgn.result = result;
+    record.pgn.setTag("Termination", termination);
+    record.outcome = result == "1-0" ? GameOutcome::WhiteWins
+                   : result == "0-1" ? GameOutcome::BlackWins : GameOutcome::Draw;
+    return record;
+}
+
+// Shared between the game threads: scheduling, score, PGN output and the live summary
+class MatchState {
+public:
+    MatchState(const MatchConfig& config, const std::vector<Opening>& openings)
+        : config(config), openings(openings), start(Clock::now()) {
+        if (!config.pgnPath.empty()) pgnFile.open(config.pgnPath);
+        lowerBound = std::log(config.beta / (1 - config.alpha));
+        upperBound = std::log((1 - config.beta) / config.alpha);
+    }
+
+    // Game index to play next, -1 when the match is over
+    int nextGame() {
+        if (finished) return -1;
+        int index = scheduled.fetch_add(1);
+        return index < config.games ? index : -1;
+    }
+
+    void report(int index, const GameRecord& game, const std::string names[2], bool engine1White) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (game.outcome == GameOutcome::Draw) score.draws++;
+        else if ((game.outcome == GameOutcome::WhiteWins) == engine1White) score.wins++;
+        else score.losses++;
+
+        if (pgnFile.is_open()) {
+            PgnGame pgn = game.pgn;
+            pgn.tags.clear();
+            pgn.setTag("Event", "Engine match");
+            pgn.setTag("Site", "local");
+            pgn.setTag("Round", std::to_string(index + 1));
+            pgn.setTag("White", engine1White ? names[0] : names[1]);
+            pgn.setTag("Black", engine1White ? names[1] : names[0]);
+            pgn.setTag("Result", game.pgn.result);
+            if (game.pgn.fen != Position::StartFen) {
+                pgn.setTag("SetUp", "1");
+                pgn.setTag("FEN", game.pgn.fen);
+            }
+            pgn.setTag("PlyCount", std::to_string(game.pgn.moves.size()));
+            pgn.setTag("Termination", game.pgn.tag("Termination"));
+            writePgnGame(pgnFile, pgn);
+            pgnFile.flush();
+        }
+
+        double llr = config.sprt ? sprtLlr(score, config.elo0, config.elo1) : 0;
+        printSummary(llr);
+        if (config.sprt && (llr <= lowerBound || llr >= upperBound)) {
+            std::cout << "SPRT: " << (llr >= upperBound ? "H1 accepted" : "H0 accepted")
+                      << " after " << score.games() << " games" << std::endl;
+            finished = true;
+        }
+    }
+
+    void addStats(const SearchStats& gameStats) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.add(gameStats);
+        if (!config.prometheusPath.empty() && !saveStatsPrometheus(config.prometheusPath, stats)) {
+            std::cerr << "Cannot write " << config.prometheusPath << std::endl;
+        }
+    }
+
+    SearchStats statistics() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void printSummary(double llr) {
+        double minutes = std::chrono::duration<double>(Clock::now() - start).count() / 60.0;
+        double elo = eloFromScore(score.score());
+        double margin = 0;
+        if (score.games() > 1) {
+            double deviation = std::sqrt(score.variance() / score.games());
+            margin = (eloFromScore(score.score() + 1.96 * deviation) - eloFromScore(score.score() - 1.96 * deviation)) / 2;
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Games " << score.games() << ": +" << score.wins << " -" << score.losses << " =" << score.draws
+                  << "  Elo " << elo << " +/- " << margin;
+        if (config.sprt) {
+            std::cout << std::setprecision(2) << "  LLR " << llr
+                      << " [" << lowerBound << ", " << upperBound << "]";
+        }
+        std::cout << std::setprecision(1) << "  " << score.games() / std::max(minutes, 1e-9) << " games/min" << std::endl;
+    }
+
+    const MatchConfig& config;
+    const std::vector<Opening>& openings;
+
+private:
+    std::mutex mutex;
+    std::atomic<int> scheduled{ 0 };
+    std::atomic<bool> finished{ false };
+    MatchScore score;
+    SearchStats stats;
+    std::ofstream pgnFile;
+    Clock::time_point start;
+    double lowerBound, upperBound;
+};
+
+// Each game thread owns one instance of each engine and plays games until the match ends.
+// Games come in pairs on the same opening with colours reversed.
+static void runGames(MatchState& state, std::unique_ptr<MatchEngine> engine1, std::unique_ptr<MatchEngine> engine2) {
+    std::string names[2] = { engine1->name, engine2->name };
+    int index;
+    while ((index = state.nextGame()) != -1) {
+        const Opening& opening = state.openings[(index / 2) % state.openings.size()];
+        bool engine1White = index % 2 == 0;
+        GameRecord game = engine1White ? playGame(engine1.get(), engine2.get(), opening, state.config)
+                                       : playGame(engine2.get(), engine1.get(), opening, state.config);
+        SearchStats gameStats;
+        engine1->takeStats(gameStats);
+        engine2->takeStats(gameStats);
+        state.addStats(gameStats);
+        state.report(index, game, names, engine1White);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    MatchConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--engine1") config.engines[0] = value;
+        else if (option == "--engine2") config.engines[1] = value;
+        else if (option == "--games") config.games = std::stoi(value);
+        else if (option == "--concurrency") config.concurrency = std::stoi(value);
+        else if (option == "--nodes") config.nodes = std::stoull(value);
+        else if (option == "--tc") {
+            size_t plus = value.find('+');
+            config.baseMs = std::stoll(value.substr(0, plus));
+            config.incrementMs = plus == std::string::npos ? 0 : std::stoll(value.substr(plus + 1));
+        }
+        else if (option == "--openings") config.openings = value;
+        else if (option == "--opening-plies") config.openingPlies = std::stoi(value);
+        else if (option == "--pgn") config.pgnPath = value;
+        else if (option == "--hash") config.hashMb = std::stoi(value);
+        else if (option == "--max-plies") config.maxPlies = std::stoi(value);
+        else if (option == "--sprt") {
+            size_t comma = value.find(',');
+            config.sprt = true;
+            config.elo0 = std::stod(value.substr(0, comma));
+            config.elo1 = comma == std::string::npos ? config.elo0 + 5 : std::stod(value.substr(comma + 1));
+        }
+        else if (option == "--alpha") config.alpha = std::stod(value);
+        else if (option == "--beta") config.beta = std::stod(value);
+        else if (option == "--stats-json") config.statsJsonPath = value;
+        else if (option == "--prometheus") config.prometheusPath = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (config.concurrency <= 0) config.concurrency = std::max(1u, std::thread::hardware_concurrency());
+    config.concurrency = std::min(config.concurrency, std::max(1, config.games));
+
+    // A crashed UCI engine must not take the runner down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<Opening> openings = loadOpenings(config);
+    if (openings.empty()) {
+        std::cerr << "No openings loaded" << std::endl;
+        return 1;
+    }
+
+    // Engines are started up front so no fork happens while games are running
+    std::vector<std::unique_ptr<MatchEngine>> engines;
+    for (int i = 0; i < config.concurrency * 2; i++) {
+        auto engine = createEngine(config.engines[i % 2], config);
+        if (!engine->start()) {
+            std::cerr << "Cannot start " << config.engines[i % 2] << std::endl;
+            return 1;
+        }
+        engines.push_back(std::move(engine));
+    }
+
+    std::cout << "Match " << engines[0]->name << " vs " << engines[1]->name << ": "
+              << config.games << " games, " << config.concurrency << " concurrent, "
+              << (config.nodes ? std::to_string(config.nodes) + " nodes/move"
+                               : std::to_string(config.baseMs) + "+" + std::to_string(config.incrementMs) + " ms")
+              << ", " << openings.size() << " openings" << std::endl;
+
+    MatchState state(config, openings);
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.concurrency; i++) {
+        threads.emplace_back(runGames, std::ref(state), std::move(engines[i * 2]), std::move(engines[i * 2 + 1]));
+    }
+    for (auto& thread : threads) thread.join();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Finished in " << std::fixed << std::setprecision(1) << seconds << " s" << std::endl;
+    if (!config.statsJsonPath.empty()) {
+        std::ofstream file(config.statsJsonPath);
+        writeStatsJson(file, state.statistics());
+        if (!file) {
+            std::cerr << "Cannot write " << config.statsJsonPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
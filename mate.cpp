@@ -0,0 +1,181 @@
+#include "MateSolver.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Mate puzzle solver: proves or refutes "mate in N" for every position of an
+// EPD file, one df-pn solver per thread, and reports nodes and time per proof
+//   mate --epd FILE [--threads N] [--hash MB] [--nodes N] [--time MS] [--max-moves N]
+// N comes from the record's "dm N;" operation, --max-moves when it has none.
+// --hash is the total, split evenly between the threads.
+
+struct MatePuzzle {
+    std::string id;
+    std::string fen;
+    int expected = 0;                  // dm operation, 0 when absent
+    MateSolution solution;
+};
+
+static std::string operationValue(const std::string& operations, const std::string& opcode) {
+    size_t at = 0;
+    while ((at = operations.find(opcode + " ", at)) != std::string::npos) {
+        if (at == 0 || operations[at - 1] == ' ' || operations[at - 1] == ';') {
+            size_t start = at + opcode.size() + 1;
+            size_t end = operations.find(';', start);
+            std::string value = operations.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+            return value;
+        }
+        at += opcode.size();
+    }
+    return "";
+}
+
+static std::vector<MatePuzzle> loadPuzzles(const std::string& path) {
+    std::vector<MatePuzzle> puzzles;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return puzzles;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string fields[4];
+        if (!(in >> fields[0] >> fields[1] >> fields[2] >> fields[3])) continue;
+        std::string operations;
+        std::getline(in, operations);
+
+        MatePuzzle puzzle;
+        puzzle.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1";
+        Position pos;
+        if (!pos.setFromFen(puzzle.fen)) continue;
+        puzzle.id = operationValue(operations, "id");
+        if (puzzle.id.empty()) puzzle.id = "#" + std::to_string(puzzles.size() + 1);
+        std::string dm = operationValue(operations, "dm");
+        if (!dm.empty()) puzzle.expected = std::stoi(dm);
+        puzzles.push_back(puzzle);
+    }
+    return puzzles;
+}
+
+static std::string lineToSan(const std::string& fen, const std::vector<PackedMove>& line) {
+    Position pos;
+    pos.setFromFen(fen);
+    std::string text;
+    for (PackedMove move : line) {
+        if (!text.empty()) text += " ";
+        text += pos.moveToSan(move);
+        pos.makeMove(move);
+    }
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    std::string epdPath;
+    int threads = 0;
+    int hashMb = 256;
+    uint64_t nodeLimit = 0;
+    int64_t timeLimitMs = 0;
+    int maxMoves = 5;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--epd") epdPath = value;
+        else if (option == "--threads") threads = std::stoi(value);
+        else if (option == "--hash") hashMb = std::stoi(value);
+        else if (option == "--nodes") nodeLimit = std::stoull(value);
+        else if (option == "--time") timeLimitMs = std::stoll(value);
+        else if (option == "--max-moves") maxMoves = std::stoi(value);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (epdPath.empty()) {
+        std::cerr << "Usage: mate --epd FILE [--threads N] [--hash MB] [--nodes N] [--time MS] [--max-moves N]" << std::endl;
+        return 1;
+    }
+
+    std::vector<MatePuzzle> puzzles = loadPuzzles(epdPath);
+    if (puzzles.empty()) {
+        std::cerr << "No positions loaded" << std::endl;
+        return 1;
+    }
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, int(puzzles.size()));
+    std::cout << "Solving " << puzzles.size() << " positions on " << threads << " threads, "
+              << hashMb / threads << " MB per solver" << std::endl;
+
+    // Puzzles are handed out one at a time so a hard one does not hold up a whole share
+    std::atomic<size_t> next{ 0 };
+    std::mutex outputMutex;
+    auto start = std::chrono::steady_clock::now();
+    auto worker = [&]() {
+        MateSolver solver(std::max(1, hashMb / threads));
+        solver.setNodeLimit(nodeLimit);
+        solver.setTimeLimit(timeLimitMs);
+        size_t index;
+        while ((index = next.fetch_add(1)) < puzzles.size()) {
+            MatePuzzle& puzzle = puzzles[index];
+            Position pos;
+            pos.setFromFen(puzzle.fen);
+            // Entries of the previous puzzle would only crowd out this one's
+            solver.clear();
+            puzzle.solution = solver.solve(pos, puzzle.expected > 0 ? puzzle.expected : maxMoves);
+
+            const MateSolution& solution = puzzle.solution;
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << std::left << std::setw(12) << puzzle.id << std::right;
+            if (solution.result == MateResult::Proven) {
+                std::cout << " mate in " << (solution.line.size() + 1) / 2;
+            }
+            else if (solution.result == MateResult::Disproven) {
+                std::cout << " no mate";
+            }
+            else {
+                std::cout << " unknown";
+            }
+            std::cout << "  nodes " << solution.nodes << "  time " << solution.timeMs << " ms"
+                      << "  nps " << solution.nodes * 1000000 / std::max<int64_t>(1, solution.timeUs);
+            if (!solution.line.empty()) std::cout << "  " << lineToSan(puzzle.fen, solution.line);
+            std::cout << std::endl;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int proven = 0, disproven = 0, unknown = 0, wrong = 0;
+    uint64_t nodes = 0;
+    int64_t solverMs = 0;
+    for (const MatePuzzle& puzzle : puzzles) {
+        const MateSolution& solution = puzzle.solution;
+        nodes += solution.nodes;
+        solverMs += solution.timeMs;
+        if (solution.result == MateResult::Proven) proven++;
+        else if (solution.result == MateResult::Disproven) disproven++;
+        else unknown++;
+        // A dm record promises a mate in exactly that many moves
+        bool shorter = solution.result == MateResult::Proven && int(solution.line.size() + 1) / 2 < puzzle.expected;
+        if (puzzle.expected > 0 && (solution.result == MateResult::Disproven || shorter)) wrong++;
+    }
+    std::cout << "Proven " << proven << ", disproven " << disproven << ", unknown " << unknown
+              << ", disagreeing with dm " << wrong << std::endl;
+    std::cout << "Nodes " << nodes << " in " << std::fixed << std::setprecision(2) << seconds << " s wall, "
+              << solverMs << " ms solver time, " << uint64_t(nodes / std::max(0.001, seconds)) << " nodes/s" << std::endl;
+    return 0;
+}
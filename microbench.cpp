@@ -0,0 +1,550 @@
+#include "AllocationCounter.h"
+#include "ChessGame.h"
+#include "Pgn.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks for the rule, logging, rendering and replay hot paths of ChessGame
+// next to their replacements, over fixed opening / middlegame / endgame sets
+//   microbench [--filter TEXT] [--min-time MS] [--json FILE] [--baseline FILE] [--threshold PCT]
+// With --baseline the exit code is 1 when a benchmark got slower than the threshold
+// or allocates more than before. Allocations are counted per thread by
+// AllocationCounter. The logging
+// benchmarks write moves.txt, game.pgn and microbench.pgn into the working
+// directory, like the game does.
+
+using Clock = std::chrono::steady_clock;
+
+struct PositionSet {
+    const char* name;
+    std::vector<const char*> fens;
+};
+
+static const std::vector<PositionSet> PositionSets = {
+    { "opening", {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+        "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+    } },
+    { "middlegame", {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r2q1rk1/pp2ppbp/2np1np1/2p5/4P3/2NP1NP1/PPP2PBP/R1BQ1RK1 w - - 0 9",
+        "2rq1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1PN1PN2/PB2BPPP/2RQ1RK1 w - - 0 11",
+    } },
+    { "endgame", {
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "6k1/5pp1/7p/8/8/7P/5PP1/3R2K1 w - - 0 1",
+        "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    } },
+};
+
+// Ruy Lopez main line, replayed by the logging benchmarks
+static const char* SampleGame =
+    "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7 f1e1 b7b5 a4b3 d7d6 c2c3 e8g8 "
+    "h2h3 c6b8 d2d4 b8d7 c3c4 c7c6 c4b5 a6b5 b1c3 c8b7 c1g5 b5b4 c3b1 h7h6 g5h4 c6c5 "
+    "d4e5 f6e4 h4e7 d8e7 e5d6 e7f6 b1d2 e4d6 d2c4 d6c4 b3c4 d7b6 f3e5 a8e8 c4f7 f8f7";
+
+struct BenchResult {
+    std::string name;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    uint64_t ops = 0;
+};
+
+// Runs `pass` (which returns the number of operations it performed) until minTimeMs has elapsed
+template <class Pass>
+static BenchResult measure(const std::string& name, int minTimeMs, Pass&& pass) {
+    pass();   // warm-up: caches, lazily grown buffers, file handles
+    uint64_t ops = 0;
+    uint64_t allocationsBefore = threadAllocationCount();
+    auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        ops += pass();
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(minTimeMs));
+    uint64_t allocations = threadAllocationCount() - allocationsBefore;
+
+    BenchResult result;
+    result.name = name;
+    result.ops = ops;
+    result.nsPerOp = std::chrono::duration<double, std::nano>(elapsed).count() / std::max<uint64_t>(ops, 1);
+    result.allocsPerOp = double(allocations) / std::max<uint64_t>(ops, 1);
+    return result;
+}
+
+// Friend of ChessGame: drives the private hot paths directly
+class ChessGameBench {
+public:
+    static void run(const std::string& filter, int minTimeMs, std::vector<BenchResult>& results);
+
+private:
+    struct Candidate {
+        sf::Vector2i from, to;
+    };
+
+    static std::vector<Candidate> ownPieceTargets(const ChessGame& game);
+    static std::vector<Candidate> validMoves(const ChessGame& game);
+    static void benchRules(const PositionSet& set, std::vector<std::unique_ptr<ChessGame>>& games,
+                           const std::string& filter, int minTimeMs, std::vector<BenchResult>& results);
+    static void benchLogging(const std::string& filter, int minTimeMs, std::vector<BenchResult>& results);
+    static void benchReplay(const std::string& filter, int minTimeMs, std::vector<BenchResult>& results);
+    static void benchRendering(const PositionSet& set, std::vector<std::unique_ptr<ChessGame>>& games,
+                               const std::string& filter, int minTimeMs, std::vector<BenchResult>& results);
+};
+
+static bool selected(const std::string& name, const std::string& filter) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+// Every (own piece, other square) pair: what a click-driven validator has to answer
+std::vector<ChessGameBench::Candidate> ChessGameBench::ownPieceTargets(const ChessGame& game) {
+    std::vector<Candidate> candidates;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            const Piece& piece = game.board[y][x];
+            if (piece.type == PieceType::None || piece.color != game.currentTurn) continue;
+            for (int ty = 0; ty < 8; ty++) {
+                for (int tx = 0; tx < 8; tx++) {
+                    if (tx != x || ty != y) candidates.push_back({ { x, y }, { tx, ty } });
+                }
+            }
+        }
+    }
+    return candidates;
+}
+
+// Pairs that pass the geometric checks, i.e. the moves wouldBeInCheck is asked about
+std::vector<ChessGameBench::Candidate> ChessGameBench::validMoves(const ChessGame& game) {
+    std::vector<Candidate> moves;
+    for (const Candidate& c : ownPieceTargets(game)) {
+        if (game.isValidMove(c.from, c.to)) moves.push_back(c);
+    }
+    return moves;
+}
+
+void ChessGameBench::benchRules(const PositionSet& set, std::vector<std::unique_ptr<ChessGame>>& games,
+                                const std::string& filter, int minTimeMs, std::vector<BenchResult>& results) {
+    std::string suffix = std::string("/") + set.name;
+    std::vector<std::vector<Candidate>> targets, moves;
+    std::vector<MoveList> pseudoLegal(games.size());
+    for (size_t i = 0; i < games.size(); i++) {
+        targets.push_back(ownPieceTargets(*games[i]));
+        moves.push_back(validMoves(*games[i]));
+        games[i]->position.generatePseudoLegal(pseudoLegal[i]);
+    }
+
+    std::string name = "rules/isValidMove" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            uint64_t ops = 0;
+            volatile bool sink = false;
+            for (size_t i = 0; i < games.size(); i++) {
+                for (const Candidate& c : targets[i]) sink = games[i]->isValidMove(c.from, c.to);
+                ops += targets[i].size();
+            }
+            (void)sink;
+            return ops;
+        }));
+    }
+    // Replacement: answered from the per-position legal move cache (rebuilt once per position here)
+    name = "rules/isLegalMove" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            uint64_t ops = 0;
+            volatile bool sink = false;
+            for (size_t i = 0; i < games.size(); i++) {
+                games[i]->invalidateLegalMoves();
+                for (const Candidate& c : targets[i]) sink = games[i]->isLegalMove(c.from, c.to);
+                ops += targets[i].size();
+            }
+            (void)sink;
+            return ops;
+        }));
+    }
+
+    name = "rules/isSquareAttacked" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            volatile bool sink = false;
+            for (auto& game : games) {
+                for (int y = 0; y < 8; y++) {
+                    for (int x = 0; x < 8; x++) {
+                        sink = game->isSquareAttacked({ x, y }, Color::White);
+                        sink = game->isSquareAttacked({ x, y }, Color::Black);
+                    }
+                }
+            }
+            (void)sink;
+            return uint64_t(games.size() * 128);
+        }));
+    }
+    name = "rules/Position::isSquareAttacked" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            volatile bool sink = false;
+            for (auto& game : games) {
+                for (int sq = 0; sq < 64; sq++) {
+                    sink = game->position.isSquareAttacked(sq, Color::White);
+                    sink = game->position.isSquareAttacked(sq, Color::Black);
+                }
+            }
+            (void)sink;
+            return uint64_t(games.size() * 128);
+        }));
+    }
+
+    name = "rules/wouldBeInCheck" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            uint64_t ops = 0;
+            volatile bool sink = false;
+            for (size_t i = 0; i < games.size(); i++) {
+                for (const Candidate& c : moves[i]) sink = games[i]->wouldBeInCheck(c.from, c.to, games[i]->currentTurn);
+                ops += moves[i].size();
+            }
+            (void)sink;
+            return ops;
+        }));
+    }
+    // Replacement: make / test / unmake on the bitboard core
+    name = "rules/Position::isLegal" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            uint64_t ops = 0;
+            volatile bool sink = false;
+            for (size_t i = 0; i < games.size(); i++) {
+                for (PackedMove move : pseudoLegal[i]) sink = games[i]->position.isLegal(move);
+                ops += pseudoLegal[i].size();
+            }
+            (void)sink;
+            return ops;
+        }));
+    }
+
+    name = "rules/getAllValidMoves" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            volatile size_t sink = 0;
+            for (auto& game : games) sink = game->getAllValidMoves(game->currentTurn).size();
+            (void)sink;
+            return uint64_t(games.size());
+        }));
+    }
+    name = "rules/buildLegalMoveCache" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            for (auto& game : games) game->buildLegalMoveCache();
+            return uint64_t(games.size());
+        }));
+    }
+    name = "rules/Position::generateLegal" + suffix;
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            volatile int sink = 0;
+            for (auto& game : games) {
+                MoveList list;
+                game->position.generateLegal(list);
+                sink = list.size();
+            }
+            (void)sink;
+            return uint64_t(games.size());
+        }));
+    }
+}
+
+void ChessGameBench::benchLogging(const std::string& filter, int minTimeMs, std::vector<BenchResult>& results) {
+    // Replay the sample game once to get what logMove is called with
+    struct LoggedMove {
+        char piece;
+        sf::Vector2i from, to;
+        bool capture;
+    };
+    std::vector<LoggedMove> logged;
+    PgnGame pgn;
+    Position pos;
+    std::istringstream in(SampleGame);
+    std::string text;
+    while (in >> text) {
+        PackedMove move = pos.parseUciMove(text);
+        if (move == NullMove) break;
+        int from = moveFrom(move), to = moveTo(move);
+        logged.push_back({ " KQRBNP"[(int)pos.pieceAt(from)], { squareCol(from), squareRow(from) },
+                           { squareCol(to), squareRow(to) }, isCaptureMove(move) });
+        pgn.moves.push_back(move);
+        pos.makeMove(move);
+    }
+    pgn.setTag("Event", "microbench");
+    pgn.setTag("Result", "*");
+
+    ChessGame game(false);
+    std::string name = "log/logMove";
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            game.moveLog.clear();
+            game.moveNumber = 1;
+            game.whiteToMove = true;
+            for (const LoggedMove& m : logged) game.logMove(m.piece, m.from, m.to, m.capture);
+            return uint64_t(logged.size());
+        }));
+    }
+    // Replacement: SAN from the rules core, no file rewrite per move
+    name = "log/Position::moveToSan";
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            Position replay;
+            volatile size_t sink = 0;
+            for (PackedMove move : pgn.moves) {
+                sink = replay.moveToSan(move).size();
+                replay.makeMove(move);
+            }
+            (void)sink;
+            return uint64_t(pgn.moves.size());
+        }));
+    }
+
+    name = "log/savePGN";
+    if (selected(name, filter)) {
+        game.moveLog.clear();
+        game.moveNumber = 1;
+        game.whiteToMove = true;
+        for (const LoggedMove& m : logged) game.logMove(m.piece, m.from, m.to, m.capture);
+        results.push_back(measure(name, minTimeMs, [&] {
+            game.savePGN();
+            return uint64_t(1);
+        }));
+    }
+    name = "log/writePgnGame";
+    if (selected(name, filter)) {
+        results.push_back(measure(name, minTimeMs, [&] {
+            std::ofstream file("microbench.pgn");
+            writePgnGame(file, pgn);
+            return uint64_t(1);
+        }));
+    }
+}
+
+// Reaching a ply of a long game: through playMove from the start, as the game
+// had to, against the snapshots of GameReplay
+void ChessGameBench::benchReplay(const std::string& filter, int minTimeMs, std::vector<BenchResult>& results) {
+    std::string names[2] = { "replay/playMove to the middle", "replay/GameReplay::seek" };
+    if (!selected(names[0], filter) && !selected(names[1], filter)) return;
+
+    // A fixed legal game of up to 300 plies
+    GameReplay replay;
+    Position pos;
+    for (int ply = 0; ply < 300; ply++) {
+        MoveList moves;
+        pos.generateLegal(moves);
+        if (moves.empty() || pos.drawState() != GameState::Playing) break;
+        PackedMove move = moves[(ply * 37 + 11) % moves.size()];
+        pos.makeMove(move);
+        replay.push(move);
+    }
+
+    if (selected(names[0], filter)) {
+        ChessGame game(false);
+        int target = replay.length() / 2;
+        results.push_back(measure(names[0], minTimeMs, [&] {
+            game.loadFen(Position::StartFen);
+            for (int ply = 0; ply < target; ply++) {
+                PackedMove move = replay.move(ply);
+                game.playMove({ squareCol(moveFrom(move)), squareRow(moveFrom(move)) },
+                              { squareCol(moveTo(move)), squareRow(moveTo(move)) });
+            }
+            return uint64_t(1);
+        }));
+    }
+    if (selected(names[1], filter)) {
+        Position shown;
+        results.push_back(measure(names[1], minTimeMs, [&] {
+            volatile uint64_t sink = 0;
+            for (int ply = 0; ply <= replay.length(); ply++) {
+                replay.seek(ply, shown);
+                sink = shown.key();
+            }
+            (void)sink;
+            return uint64_t(replay.length() + 1);
+        }));
+    }
+}
+
+void ChessGameBench::benchRendering(const PositionSet& set, std::vector<std::unique_ptr<ChessGame>>& games,
+                                    const std::string& filter, int minTimeMs, std::vector<BenchResult>& results) {
+    std::string suffix = std::string("/") + set.name;
+    std::string names[3] = { "render/drawPieces" + suffix, "render/drawPiecesBatched" + suffix, "render/frame" + suffix };
+    if (!selected(names[0], filter) && !selected(names[1], filter) && !selected(names[2], filter)) return;
+
+    // Offscreen: the same draw calls as the window, without needing one
+    static sf::RenderTexture target;
+    static bool created = target.create(800, 800);
+    if (!created) {
+        results.push_back({ names[0] + " (skipped: no offscreen render target)", 0, 0, 0 });
+        return;
+    }
+
+    if (selected(names[0], filter)) {
+        results.push_back(measure(names[0], minTimeMs, [&] {
+            for (auto& game : games) {
+                target.clear();
+                game->drawPieces(target);
+                target.display();
+            }
+            return uint64_t(games.size());
+        }));
+    }
+    if (selected(names[1], filter)) {
+        results.push_back(measure(names[1], minTimeMs, [&] {
+            for (auto& game : games) {
+                target.clear();
+                game->drawPiecesBatched(target);
+                target.display();
+            }
+            return uint64_t(games.size());
+        }));
+    }
+    // Everything the game loop draws for one in-game frame, with a piece selected
+    if (selected(names[2], filter)) {
+        for (auto& game : games) {
+            game->selectedPosition = game->findKing(game->currentTurn);
+            game->isPieceSelected = true;
+        }
+        results.push_back(measure(names[2], minTimeMs, [&] {
+            for (auto& game : games) {
+                target.clear();
+                game->drawBoard(target);
+                game->drawSelection(target);
+                game->drawPiecesBatched(target);
+                target.display();
+            }
+            return uint64_t(games.size());
+        }));
+        for (auto& game : games) game->isPieceSelected = false;
+    }
+}
+
+// Accepts and drops everything: console messages from the game still cost their
+// formatting inside the measured code, but never reach the terminal
+class DiscardBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+void ChessGameBench::run(const std::string& filter, int minTimeMs, std::vector<BenchResult>& results) {
+    DiscardBuffer discard;
+    std::streambuf* out = std::cout.rdbuf(&discard);
+    std::streambuf* err = std::cerr.rdbuf(&discard);
+
+    for (const PositionSet& set : PositionSets) {
+        std::vector<std::unique_ptr<ChessGame>> games;
+        for (const char* fen : set.fens) {
+            games.push_back(std::make_unique<ChessGame>(false));
+            games.back()->loadFen(fen);
+        }
+        benchRules(set, games, filter, minTimeMs, results);
+        benchRendering(set, games, filter, minTimeMs, results);
+    }
+    benchLogging(filter, minTimeMs, results);
+    benchReplay(filter, minTimeMs, results);
+
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(err);
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << std::fixed << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ns_per_op\": " << std::setprecision(2) << r.nsPerOp
+            << ", \"allocs_per_op\": " << std::setprecision(3) << r.allocsPerOp
+            << ", \"ops\": " << r.ops << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+static double numberAfter(const std::string& line, const std::string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    return at == std::string::npos ? -1 : std::atof(line.c_str() + at + key.size() + 3);
+}
+
+// Reads the format written by writeJson: one benchmark object per line
+static std::map<std::string, BenchResult> readBaseline(const std::string& path) {
+    std::map<std::string, BenchResult> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t at = line.find("\"name\": \"");
+        if (at == std::string::npos) continue;
+        at += 9;
+        BenchResult r;
+        r.name = line.substr(at, line.find('"', at) - at);
+        r.nsPerOp = numberAfter(line, "ns_per_op");
+        r.allocsPerOp = numberAfter(line, "allocs_per_op");
+        baseline[r.name] = r;
+    }
+    return baseline;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter, jsonPath, baselinePath;
+    int minTimeMs = 200;
+    double threshold = 10.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--filter") filter = value;
+        else if (option == "--min-time") minTimeMs = std::stoi(value);
+        else if (option == "--json") jsonPath = value;
+        else if (option == "--baseline") baselinePath = value;
+        else if (option == "--threshold") threshold = std::stod(value);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::map<std::string, BenchResult> baseline;
+    if (!baselinePath.empty()) {
+        baseline = readBaseline(baselinePath);
+        if (baseline.empty()) std::cerr << "Warning: no benchmarks in " << baselinePath << std::endl;
+    }
+
+    std::vector<BenchResult> results;
+    ChessGameBench::run(filter, minTimeMs, results);
+
+    bool regression = false;
+    std::cout << std::left << std::setw(46) << "benchmark" << std::right << std::setw(12) << "ns/op"
+              << std::setw(12) << "allocs/op" << std::setw(12) << "ops";
+    if (!baseline.empty()) std::cout << std::setw(12) << "base ns/op" << std::setw(10) << "change";
+    std::cout << "\n";
+    for (const BenchResult& r : results) {
+        std::cout << std::left << std::setw(46) << r.name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << r.nsPerOp
+                  << std::setprecision(2) << std::setw(12) << r.allocsPerOp << std::setw(12) << r.ops;
+        auto found = baseline.find(r.name);
+        if (found != baseline.end() && found->second.nsPerOp > 0) {
+            double change = (r.nsPerOp / found->second.nsPerOp - 1.0) * 100.0;
+            bool slower = change > threshold;
+            bool moreAllocations = r.allocsPerOp > found->second.allocsPerOp + 0.005;
+            regression = regression || slower || moreAllocations;
+            std::cout << std::setprecision(1) << std::setw(12) << found->second.nsPerOp
+                      << std::setw(9) << std::showpos << change << "%" << std::noshowpos
+                      << (slower ? "  SLOWER" : "") << (moreAllocations ? "  MORE ALLOCS" : "");
+        }
+        std::cout << "\n";
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream file(jsonPath);
+        writeJson(file, results);
+    }
+    return regression ? 1 : 0;
+}
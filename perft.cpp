@@ -0,0 +1,127 @@
+#include "Position.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+// Move path counter. Validates the pin/check-mask generator against the
+// pseudo-legal + make/unmake reference and reports the speedup.
+//   perft                  run the standard suite with both generators
+//   perft <depth> [fen]    divide: per-move counts for one position
+
+struct PerftCase {
+    const char* name;
+    const char* fen;
+    int depth;
+    uint64_t expected;
+};
+
+static const PerftCase perftSuite[] = {
+    { "startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+    { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+    { "promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333 },
+    { "talkchess", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+    { "middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+    { "ep-pin", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467 },
+    { "ep-rank-pin", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888 },
+};
+
+template <bool Reference>
+static uint64_t perft(Position& pos, int depth) {
+    MoveList moves;
+    if (Reference) {
+        pos.generateLegalReference(moves);
+    }
+    else {
+        pos.generateLegal(moves);
+    }
+    if (depth == 1) return moves.size();
+
+    uint64_t nodes = 0;
+    for (PackedMove move : moves) {
+        pos.makeMove(move);
+        nodes += perft<Reference>(pos, depth - 1);
+        pos.unmakeMove(move);
+    }
+    return nodes;
+}
+
+template <bool Reference>
+static double timedPerft(Position& pos, int depth, uint64_t& nodes) {
+    auto start = std::chrono::steady_clock::now();
+    nodes = perft<Reference>(pos, depth);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int runSuite() {
+    int failures = 0;
+    double legalTotal = 0, referenceTotal = 0;
+
+    std::cout << std::left << std::setw(13) << "position" << std::right
+              << std::setw(6) << "depth" << std::setw(12) << "nodes"
+              << std::setw(12) << "legal ms" << std::setw(12) << "ref ms"
+              << std::setw(10) << "speedup" << "\n";
+
+    for (const PerftCase& test : perftSuite) {
+        Position pos;
+        pos.setFromFen(test.fen);
+
+        uint64_t legalNodes = 0, referenceNodes = 0;
+        double legalTime = timedPerft<false>(pos, test.depth, legalNodes);
+        double referenceTime = timedPerft<true>(pos, test.depth, referenceNodes);
+        legalTotal += legalTime;
+        referenceTotal += referenceTime;
+
+        bool ok = legalNodes == test.expected && referenceNodes == test.expected;
+        if (!ok) failures++;
+
+        std::cout << std::left << std::setw(13) << test.name << std::right
+                  << std::setw(6) << test.depth << std::setw(12) << legalNodes
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << legalTime * 1000 << std::setw(12) << referenceTime * 1000
+                  << std::setw(9) << referenceTime / legalTime << "x";
+        if (!ok) {
+            std::cout << "  MISMATCH (expected " << test.expected << ", reference " << referenceNodes << ")";
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << "\nTotal: legal " << legalTotal * 1000 << " ms, reference " << referenceTotal * 1000
+              << " ms, speedup " << referenceTotal / legalTotal << "x\n";
+    std::cout << (failures ? "FAILED" : "All counts match") << std::endl;
+    return failures ? 1 : 0;
+}
+
+static void divide(Position& pos, int depth) {
+    MoveList moves;
+    pos.generateLegal(moves);
+    uint64_t total = 0;
+    for (PackedMove move : moves) {
+        pos.makeMove(move);
+        uint64_t nodes = depth > 1 ? perft<false>(pos, depth - 1) : 1;
+        pos.unmakeMove(move);
+        std::cout << Position::moveToUci(move) << ": " << nodes << "\n";
+        total += nodes;
+    }
+    std::cout << "\nNodes searched: " << total << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        return runSuite();
+    }
+
+    int depth = std::stoi(argv[1]);
+    Position pos;
+    if (argc > 2) {
+        std::string fen = argv[2];
+        for (int i = 3; i < argc; i++) fen += std::string(" ") + argv[i];
+        if (!pos.setFromFen(fen)) {
+            std::cerr << "Invalid FEN: " << fen << std::endl;
+            return 1;
+        }
+    }
+    divide(pos, depth);
+    return 0;
+}
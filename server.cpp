@@ -0,0 +1,49 @@
+#include "GameServer.h"
+#include <csignal>
+#include <iostream>
+#include <string>
+
+// Headless multiplayer server
+//   server [--port N] [--unix PATH] [--workers N] [--base MS] [--inc MS] [--backlog FRAMES]
+//          [--send-buffer BYTES]
+
+static GameServer* activeServer = nullptr;
+
+static void onSignal(int) {
+    if (activeServer) activeServer->requestStop();
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--port") config.port = std::stoi(value);
+        else if (option == "--unix") config.unixPath = value;
+        else if (option == "--workers") config.workers = std::stoi(value);
+        else if (option == "--base") config.baseMs = std::stoul(value);
+        else if (option == "--inc") config.incrementMs = std::stoul(value);
+        else if (option == "--backlog") config.spectatorBacklog = std::stoul(value);
+        else if (option == "--send-buffer") config.spectatorSendBuffer = std::stoi(value);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (config.workers < 1) config.workers = 1;
+
+    GameServer server(config);
+    if (!server.start()) return 1;
+
+    activeServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::cout << "Chess server listening on "
+              << (config.unixPath.empty() ? "port " + std::to_string(config.port) : config.unixPath)
+              << " with " << config.workers << " workers" << std::endl;
+    server.run();
+    server.stop();
+    std::cout << "Server stopped" << std::endl;
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "TablebaseGenerator.h"
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Endgame tablebase generator and prober
+//   tbgen --tables KQvK,KRvKP [--dir DIR] [--threads N]
+//   tbgen --pieces N [--dir DIR] [--threads N]    every signature of up to N pieces
+//   tbgen --probe FEN [--dir DIR]
+// Tables already in DIR are loaded and not generated again; the smaller
+// tables a signature needs are generated first.
+
+static std::string describe(const TablebaseResult& result) {
+    if (result.wdl == 0) return "draw";
+    return std::string(result.wdl > 0 ? "win" : "loss") + " (mate in " + std::to_string(result.dtm) + " plies)";
+}
+
+static int probe(Tablebases& tables, const std::string& fen) {
+    Position pos;
+    if (!pos.setFromFen(fen)) {
+        std::cerr << "Bad FEN: " << fen << std::endl;
+        return 1;
+    }
+    TablebaseResult result;
+    if (!tables.probe(pos, result)) {
+        std::cout << pos.toFen() << ": not in the loaded tables" << std::endl;
+        return 1;
+    }
+    std::cout << pos.toFen() << ": " << (pos.sideToMove() == Color::White ? "White" : "Black")
+              << " to move, " << describe(result) << std::endl;
+
+    // Each move from the mover's point of view, best first
+    MoveList moves;
+    pos.generateLegal(moves);
+    std::vector<std::pair<int, std::string>> lines;
+    for (PackedMove move : moves) {
+        std::string san = pos.moveToSan(move);
+        pos.makeMove(move);
+        TablebaseResult child;
+        bool found = tables.probe(pos, child);
+        pos.unmakeMove(move);
+        if (!found) continue;
+        TablebaseResult ours;
+        ours.wdl = -child.wdl;
+        ours.dtm = child.wdl ? child.dtm + 1 : 0;
+        int order = ours.wdl > 0 ? ours.dtm : ours.wdl == 0 ? 100000 : 200000 - ours.dtm;
+        lines.push_back({ order, "  " + san + std::string(san.size() < 8 ? 8 - san.size() : 1, ' ') + describe(ours) });
+    }
+    std::sort(lines.begin(), lines.end());
+    for (const auto& line : lines) std::cout << line.second << std::endl;
+    return 0;
+}
+
+static std::string formatCount(uint64_t value) {
+    std::string digits = std::to_string(value);
+    for (int i = int(digits.size()) - 3; i > 0; i -= 3) digits.insert(size_t(i), ",");
+    return digits;
+}
+
+static void report(const TablebaseGenStats& stats) {
+    uint64_t legal = stats.legal[0] + stats.legal[1];
+    double share = legal ? 100.0 / legal : 0;
+    std::cout << std::left << std::setw(8) << stats.name << std::right
+              << std::setw(14) << formatCount(2 * stats.positions) << " positions"
+              << std::setw(14) << formatCount(legal) << " legal"
+              << std::fixed << std::setprecision(1)
+              << "  W/D/L " << (stats.wins[0] + stats.wins[1]) * share << "/"
+              << (stats.draws[0] + stats.draws[1]) * share << "/"
+              << (stats.losses[0] + stats.losses[1]) * share << "%"
+              << "  max DTM " << std::setw(3) << stats.maxDtm << " plies (" << stats.dtmBits << " bits)"
+              << std::setprecision(1) << std::setw(10) << stats.fileBytes / 1024.0 << " KB"
+              << std::setprecision(2) << std::setw(9) << (stats.initMs + stats.retroMs + stats.writeMs) / 1000.0 << " s"
+              << "  (init " << stats.initMs << " ms, " << stats.iterations << " iterations " << stats.retroMs
+              << " ms, write " << stats.writeMs << " ms)" << std::endl;
+}
+
+// Every signature of up to `pieces` pieces, stronger side White, fewest pieces first
+static std::vector<TablebaseMaterial> allSignatures(int pieces) {
+    std::vector<TablebaseMaterial> found;
+    std::vector<TablebaseMaterial> frontier(1);
+    for (int count = 3; count <= pieces; count++) {
+        std::vector<TablebaseMaterial> next;
+        for (const TablebaseMaterial& base : frontier) {
+            for (int color = 0; color < 2; color++) {
+                for (int type = int(PieceType::Queen); type <= int(PieceType::Pawn); type++) {
+                    TablebaseMaterial grown = base;
+                    grown.counts[color][type]++;
+                    grown = canonicalMaterial(grown);
+                    bool known = false;
+                    for (const TablebaseMaterial& other : next) known = known || other.key() == grown.key();
+                    if (!known) next.push_back(grown);
+                }
+            }
+        }
+        found.insert(found.end(), next.begin(), next.end());
+        frontier = next;
+    }
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    std::string directory = "tablebases";
+    std::string tableList;
+    std::string fen;
+    int pieces = 0;
+    int threads = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--tables") tableList = value;
+        else if (option == "--pieces") pieces = std::min(MaxTablebasePieces, std::stoi(value));
+        else if (option == "--dir") directory = value;
+        else if (option == "--threads") threads = std::max(1, std::stoi(value));
+        else if (option == "--probe") fen = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    Tablebases tables;
+    int loaded = std::filesystem::exists(directory) ? tables.load(directory) : 0;
+    if (!fen.empty()) return probe(tables, fen);
+
+    std::vector<TablebaseMaterial> wanted;
+    if (pieces >= 3) wanted = allSignatures(pieces);
+    std::istringstream names(tableList);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        TablebaseMaterial material;
+        if (!material.parse(name)) {
+            std::cerr << "Bad signature " << name << " (like KQvKR, up to " << MaxTablebasePieces << " pieces)" << std::endl;
+            return 1;
+        }
+        wanted.push_back(material);
+    }
+    if (wanted.empty()) {
+        std::cerr << "Nothing to do: give --tables, --pieces or --probe" << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::cout << "Loaded " << loaded << " tables from " << directory << ", generating with "
+              << threads << (threads == 1 ? " thread" : " threads") << std::endl;
+    TablebaseGenerator generator(directory, threads, tables);
+    std::vector<TablebaseGenStats> generated;
+    for (const TablebaseMaterial& material : wanted) {
+        size_t before = generated.size();
+        bool ok = generator.generate(material, generated);
+        for (size_t i = before; i < generated.size(); i++) report(generated[i]);
+        if (!ok) return 1;
+    }
+
+    uint64_t bytes = 0;
+    int64_t ms = 0;
+    for (const TablebaseGenStats& stats : generated) {
+        bytes += stats.fileBytes;
+        ms += stats.initMs + stats.retroMs + stats.writeMs;
+    }
+    std::cout << "Generated " << generated.size() << " tables, " << std::fixed << std::setprecision(1)
+              << bytes / 1024.0 << " KB in " << std::setprecision(2) << ms / 1000.0 << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "Tuner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Texel-style evaluation tuner: fits material and piece-square tables to game
+// results and writes them as a new EvalParams.h
+//   tune --data FILE [--data FILE ...] [--out FILE] [--threads N] [--epochs N]
+//        [--optimizer adam|gd] [--rate R] [--k K] [--skip N] [--max N] [--report N]
+// Data: EPD / FEN lines with a result ("1-0", "1/2-1/2", "0-1" or [1.0] ...)
+// or PGN games (quiet positions after --skip plies). Without --k the sigmoid
+// scale is fitted to the current parameters first; --epochs 0 only measures
+// and writes them unchanged. Build with -O3 and the
+// target's vector extensions (e.g. -march=native) for the vectorized kernels.
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> dataPaths;
+    std::string outPath = "EvalParams.tuned.h";
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int epochs = 200;
+    std::string optimizer = "adam";
+    double rate = -1;
+    double k = 0;
+    int skipPlies = 8;
+    size_t maxPositions = SIZE_MAX;
+    int reportEvery = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--data") dataPaths.push_back(value);
+        else if (option == "--out") outPath = value;
+        else if (option == "--threads") threads = std::max(1, std::stoi(value));
+        else if (option == "--epochs") epochs = std::max(0, std::stoi(value));
+        else if (option == "--optimizer") optimizer = value;
+        else if (option == "--rate") rate = std::stod(value);
+        else if (option == "--k") k = std::stod(value);
+        else if (option == "--skip") skipPlies = std::stoi(value);
+        else if (option == "--max") maxPositions = std::stoull(value);
+        else if (option == "--report") reportEvery = std::max(1, std::stoi(value));
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (dataPaths.empty() || (optimizer != "adam" && optimizer != "gd")) {
+        std::cerr << "Usage: tune --data FILE [--out FILE] [--optimizer adam|gd] [options]" << std::endl;
+        return 1;
+    }
+    // Adam moves every parameter about `rate` centipawns per epoch; plain
+    // gradient descent needs a large step because the gradients are tiny
+    if (rate < 0) rate = optimizer == "adam" ? 1.0 : 50000.0;
+
+    auto loadStart = Clock::now();
+    TuningSet set;
+    for (const std::string& path : dataPaths) {
+        if (!loadTuningData(path, set, skipPlies, maxPositions)) return 1;
+    }
+    set.finish();
+    if (set.count == 0) {
+        std::cerr << "No labelled positions found" << std::endl;
+        return 1;
+    }
+    std::cout << "Loaded " << set.count << " positions in " << std::fixed << std::setprecision(2)
+              << secondsSince(loadStart) << " s, " << set.bytes() / set.count << " bytes per position" << std::endl;
+
+    Tuner tuner(set, threads);
+    std::vector<double> parameters = currentEvalParameters();
+    if (k <= 0) {
+        k = tuner.fitScale(parameters);
+        std::cout << "Fitted sigmoid scale k = " << std::setprecision(6) << k << " per centipawn" << std::endl;
+    }
+    double initialLoss = tuner.loss(parameters, k, nullptr);
+    std::cout << "Initial loss " << std::setprecision(6) << initialLoss << std::endl;
+
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    std::vector<double> gradient, moment(parameters.size(), 0.0), velocity(parameters.size(), 0.0);
+    auto tuneStart = Clock::now();
+    double loss = initialLoss;
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        loss = tuner.loss(parameters, k, &gradient);
+        for (size_t i = 0; i < parameters.size(); i++) {
+            if (optimizer == "gd") {
+                parameters[i] -= rate * gradient[i];
+                continue;
+            }
+            moment[i] = beta1 * moment[i] + (1 - beta1) * gradient[i];
+            velocity[i] = beta2 * velocity[i] + (1 - beta2) * gradient[i] * gradient[i];
+            double correctedMoment = moment[i] / (1 - std::pow(beta1, epoch));
+            double correctedVelocity = velocity[i] / (1 - std::pow(beta2, epoch));
+            parameters[i] -= rate * correctedMoment / (std::sqrt(correctedVelocity) + epsilon);
+        }
+        if (epoch % reportEvery == 0 || epoch == epochs) {
+            std::cout << "epoch " << std::setw(5) << epoch << "  loss " << std::setprecision(6) << loss
+                      << "  " << std::setprecision(1) << epoch / secondsSince(tuneStart) << " epochs/s" << std::endl;
+        }
+    }
+
+    double finalLoss = tuner.loss(parameters, k, nullptr);
+    double seconds = secondsSince(tuneStart);
+    std::cout << "Loss " << std::setprecision(6) << initialLoss << " -> " << finalLoss << " after " << epochs << " epochs";
+    if (epochs > 0) {
+        std::cout << " in " << std::setprecision(2) << seconds << " s (" << std::setprecision(1) << epochs / seconds
+                  << " epochs/s, " << epochs * double(set.count) / seconds / 1e6 << " M positions/s on " << threads << " threads)";
+    }
+    std::cout << std::endl;
+    if (!writeEvalParams(outPath, parameters)) return 1;
+    std::cout << "Wrote " << outPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include "Position.h"
+#include "Search.h"
+#include "Tablebase.h"
+#include "BenchPositions.h"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// UCI front-end on the rules core. stdin is read on a dedicated thread that
+// handles stop / ponderhit immediately; everything is queued for the main
+// thread so a long command never delays an interrupt. stop and ponderhit are
+// queued as well, so they also reach a go that was still waiting in the queue.
+
+static std::mutex outputMutex;
+
+static void send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
+
+static std::string formatScore(int score) {
+    if (std::abs(score) >= MateInMaxPly) {
+        int plies = MateScore - std::abs(score);
+        int moves = (plies + 1) / 2;
+        return "mate " + std::to_string(score > 0 ? moves : -moves);
+    }
+    return "cp " + std::to_string(score);
+}
+
+static void printInfo(const SearchInfo& info) {
+    std::ostringstream out;
+    uint64_t nps = info.timeMs > 0 ? info.nodes * 1000 / info.timeMs : info.nodes;
+    out << "info depth " << info.depth << " seldepth " << info.selDepth << " multipv " << info.multiPv
+        << " score " << formatScore(info.score) << " nodes " << info.nodes
+        << " nps " << nps << " hashfull " << info.hashfull << " time " << info.timeMs << " pv";
+    for (PackedMove move : info.pv) out << " " << Position::moveToUci(move);
+    send(out.str());
+    if (info.hasStats) send("info string " + statsSummary(info.stats));
+}
+
+static void printBestMove(PackedMove best, PackedMove ponder) {
+    std::string line = "bestmove " + Position::moveToUci(best);
+    if (ponder != NullMove) line += " ponder " + Position::moveToUci(ponder);
+    send(line);
+}
+
+class CommandQueue {
+public:
+    void push(const std::string& line) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            lines.push_back(line);
+        }
+        condition.notify_one();
+    }
+    std::string pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !lines.empty(); });
+        std::string line = lines.front();
+        lines.pop_front();
+        return line;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::string> lines;
+};
+
+static void setPosition(Position& pos, std::istringstream& in) {
+    std::string token, fen;
+    in >> token;
+    if (token == "startpos") {
+        pos.setStartPosition();
+        in >> token;
+    }
+    else if (token == "fen") {
+        while (in >> token && token != "moves") fen += token + " ";
+        if (!pos.setFromFen(fen)) {
+            send("info string invalid fen");
+            pos.setStartPosition();
+        }
+    }
+    if (token != "moves") return;
+    while (in >> token) {
+        PackedMove move = pos.parseUciMove(token);
+        if (move == NullMove) {
+            send("info string illegal move " + token);
+            return;
+        }
+        pos.makeMove(move);
+    }
+}
+
+static SearchLimits parseGo(std::istringstream& in) {
+    SearchLimits limits;
+    std::string token;
+    while (in >> token) {
+        if (token == "wtime") in >> limits.time[0];
+        else if (token == "btime") in >> limits.time[1];
+        else if (token == "winc") in >> limits.increment[0];
+        else if (token == "binc") in >> limits.increment[1];
+        else if (token == "movestogo") in >> limits.movesToGo;
+        else if (token == "movetime") in >> limits.moveTime;
+        else if (token == "depth") in >> limits.depth;
+        else if (token == "nodes") in >> limits.nodes;
+        else if (token == "infinite") limits.infinite = true;
+        else if (token == "ponder") limits.ponder = true;
+    }
+    return limits;
+}
+
+// A whole non-negative number; a malformed value must not take the engine down
+static bool parseSpin(const std::string& value, int& number) {
+    try {
+        size_t used = 0;
+        number = std::stoi(value, &used);
+        return used == value.size() && number >= 0;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+static void setOption(Search& search, Tablebases& tablebases, std::istringstream& in) {
+    std::string token, name, value;
+    in >> token;   // "name"
+    while (in >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    while (in >> token) value += (value.empty() ? "" : " ") + token;
+
+    bool spin = name == "Hash" || name == "Threads" || name == "Move Overhead" || name == "MultiPV";
+    int number = 0;
+    if (spin && !parseSpin(value, number)) {
+        send("info string invalid value " + value + " for " + name);
+        return;
+    }
+
+    if (name == "Hash") search.setHashSize(size_t(number));
+    else if (name == "Threads") search.setThreads(number);
+    else if (name == "Move Overhead") search.setMoveOverhead(number);
+    else if (name == "MultiPV") search.setMultiPv(number);
+    else if (name == "Stats") search.setCollectStats(value == "true");
+    else if (name == "Ponder") { }
+    else if (name == "TablebasePath") {
+        tablebases.clear();
+        int count = value.empty() || value == "<empty>" ? 0 : tablebases.load(value);
+        search.setTablebases(count ? &tablebases : nullptr);
+        send("info string " + std::to_string(count) + " tablebases loaded, up to "
+             + std::to_string(tablebases.maxPieces()) + " pieces");
+    }
+    else send("info string unknown option " + name);
+}
+
+// Fixed-depth search over the bench positions: a node count signature plus speed.
+// `json FILE` / `prometheus FILE` also dump the search statistics of the run.
+static void bench(Search& search, int depth, std::istringstream& in) {
+    std::string jsonPath, prometheusPath, token;
+    while (in >> token) {
+        if (token == "json") in >> jsonPath;
+        else if (token == "prometheus") in >> prometheusPath;
+    }
+    bool collecting = search.collectingStats();
+    bool wantStats = collecting || !jsonPath.empty() || !prometheusPath.empty();
+    search.setCollectStats(wantStats);
+
+    auto info = search.onInfo;
+    auto bestMove = search.onBestMove;
+    search.onInfo = nullptr;
+    search.onBestMove = nullptr;
+    SearchStats stats;
+    uint64_t searchAllocations = 0;
+
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BenchPositionCount; i++) {
+        Position pos;
+        pos.setFromFen(BenchPositions[i]);
+        SearchLimits limits;
+        limits.depth = depth;
+        search.clear();
+        search.start(pos, limits);
+        search.wait();
+        totalNodes += search.nodesSearched();
+        if (wantStats) stats.add(search.statistics());
+        searchAllocations += search.searchAllocations();
+        send("Position " + std::to_string(i + 1) + "/" + std::to_string(BenchPositionCount)
+             + ": " + std::to_string(search.nodesSearched()) + " nodes");
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    send("===========================");
+    send("Total time (ms) : " + std::to_string(int64_t(seconds * 1000)));
+    send("Nodes searched  : " + std::to_string(totalNodes));
+    send("Nodes/second    : " + std::to_string(int64_t(totalNodes / std::max(seconds, 1e-9))));
+    if (wantStats) {
+        send("Statistics      : " + statsSummary(stats));
+    }
+    send("Search allocs   : " + std::to_string(searchAllocations));
+    if (!jsonPath.empty()) {
+        std::ofstream file(jsonPath);
+        writeStatsJson(file, stats);
+    }
+    if (!prometheusPath.empty() && !saveStatsPrometheus(prometheusPath, stats)) {
+        send("info string cannot write " + prometheusPath);
+    }
+    search.setCollectStats(collecting);
+
+    search.onInfo = info;
+    search.onBestMove = bestMove;
+}
+
+// Node counts to a fixed depth over the bench positions with the move-ordering
+// features switched on one after another, so each one's saving is visible
+static void orderingBench(Search& search, int depth) {
+    struct Step { const char* name; int features; };
+    const Step steps[] = {
+        { "MVV-LVA only", 0 },
+        { "+ killers", OrderKillers },
+        { "+ counter moves", OrderKillers | OrderCounterMoves },
+        { "+ butterfly history", OrderKillers | OrderCounterMoves | OrderHistory },
+        { "+ continuation history", OrderKillers | OrderCounterMoves | OrderHistory | OrderContinuation },
+        { "+ SEE", OrderAll },
+    };
+
+    auto info = search.onInfo;
+    auto bestMove = search.onBestMove;
+    search.onInfo = nullptr;
+    search.onBestMove = nullptr;
+
+    uint64_t baseline = 0;
+    for (const Step& step : steps) {
+        search.setOrdering(step.features);
+        uint64_t totalNodes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BenchPositionCount; i++) {
+            Position pos;
+            pos.setFromFen(BenchPositions[i]);
+            SearchLimits limits;
+            limits.depth = depth;
+            search.clear();
+            search.start(pos, limits);
+            search.wait();
+            totalNodes += search.nodesSearched();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (baseline == 0) baseline = totalNodes;
+
+        std::ostringstream line;
+        line << std::left << std::setw(26) << step.name << std::right << std::setw(12) << totalNodes << " nodes"
+             << std::setw(8) << std::fixed << std::setprecision(1) << 100.0 * totalNodes / std::max<uint64_t>(baseline, 1) << "%"
+             << std::setw(10) << int64_t(seconds * 1000) << " ms";
+        send(line.str());
+    }
+    search.setOrdering(OrderAll);
+
+    search.onInfo = info;
+    search.onBestMove = bestMove;
+}
+
+int main(int argc, char* argv[]) {
+    Search search;
+    Tablebases tablebases;
+    search.onInfo = printInfo;
+    search.onBestMove = printBestMove;
+    Position pos;
+
+    // `uci bench [depth] [json FILE] [prometheus FILE]` runs the benchmark
+    // without entering the protocol loop
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        std::string arguments;
+        for (int i = 2; i < argc; i++) arguments += std::string(argv[i]) + " ";
+        std::istringstream in(arguments);
+        int depth = 10;
+        if (argc > 2 && isdigit((unsigned char)argv[2][0])) in >> depth;
+        bench(search, depth, in);
+        return 0;
+    }
+    // `uci orderbench [depth]`: node-count reduction of each move-ordering feature
+    if (argc > 1 && std::string(argv[1]) == "orderbench") {
+        orderingBench(search, argc > 2 ? std::stoi(argv[2]) : 8);
+        return 0;
+    }
+
+    CommandQueue queue;
+    std::thread reader([&search, &queue] {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            std::istringstream in(line);
+            std::string command;
+            in >> command;
+            if (command == "stop" || command == "quit") search.stop();
+            else if (command == "ponderhit") search.ponderHit();
+            queue.push(line);
+            if (command == "quit") return;
+        }
+        search.stop();
+        queue.push("quit");
+    });
+
+    while (true) {
+        std::string line = queue.pop();
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+
+        if (command == "uci") {
+            send("id name SFML Chess");
+            send("id author SFML Chess developers");
+            send("option name Hash type spin default 16 min 1 max 4096");
+            send("option name Threads type spin default 1 min 1 max 256");
+            send("option name Ponder type check default false");
+            send("option name Move Overhead type spin default 30 min 0 max 5000");
+            send("option name MultiPV type spin default 1 min 1 max " + std::to_string(MaxMultiPv));
+            send("option name Stats type check default false");
+            send("option name TablebasePath type string default <empty>");
+            send("uciok");
+        }
+        else if (command == "isready") {
+            send("readyok");
+        }
+        else if (command == "stop") {
+            search.stop();
+        }
+        else if (command == "ponderhit") {
+            search.ponderHit();
+        }
+        else if (command == "setoption") {
+            search.stop();
+            search.wait();
+            setOption(search, tablebases, in);
+        }
+        else if (command == "ucinewgame") {
+            search.stop();
+            search.wait();
+            search.clear();
+        }
+        else if (command == "position") {
+            search.stop();
+            search.wait();
+            setPosition(pos, in);
+        }
+        else if (command == "go") {
+            search.start(pos, parseGo(in));
+        }
+        else if (command == "bench") {
+            search.stop();
+            search.wait();
+            int depth = 10;
+            std::streampos mark = in.tellg();
+            if (!(in >> depth)) {
+                depth = 10;
+                in.clear();
+                in.seekg(mark);
+            }
+            bench(search, depth, in);
+        }
+        else if (command == "orderbench") {
+            search.stop();
+            search.wait();
+            int depth = 8;
+            if (!(in >> depth)) depth = 8;
+            orderingBench(search, depth);
+        }
+        else if (command == "d") {
+            send(pos.toFen());
+        }
+        else if (command == "quit") {
+            break;
+        }
+        else if (!command.empty()) {
+            send("info string unknown command " + command);
+        }
+    }
+
+    search.stop();
+    search.wait();
+    reader.join();
+    return 0;
+}